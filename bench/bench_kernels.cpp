@@ -0,0 +1,210 @@
+// Micro-benchmarks of the per-frame kernels that run around the model:
+// preprocessing, detection decoding and label drawing. None of them needs a
+// session, so the numbers are free of ONNX Runtime noise.
+//
+//   ./yolov10_benchmarks --benchmark_filter=Preprocess
+#include "ia/label_renderer.h"
+#include "ia/preprocess.h"
+#include <benchmark/benchmark.h>
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    const cv::Size INPUT_SIZE(640, 640);
+    const int OUTPUT_ROWS = 300;
+
+    cv::Mat syntheticFrame(int width, int height)
+    {
+        cv::Mat frame(height, width, CV_8UC3);
+        cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(255));
+        return frame;
+    }
+
+    std::vector<std::string> syntheticClassNames()
+    {
+        std::vector<std::string> names;
+        for (int i = 0; i < 80; ++i)
+        {
+            names.push_back("class " + std::to_string(i));
+        }
+        return names;
+    }
+
+    // Output tensor laid out like the model's [300, 6] rows, with `density`
+    // confident boxes and the remaining rows close to zero confidence
+    std::vector<float> syntheticOutput(int density)
+    {
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<float> position(0.0f, 600.0f);
+        std::uniform_real_distribution<float> size(8.0f, 160.0f);
+        std::uniform_real_distribution<float> confident(0.3f, 1.0f);
+        std::uniform_real_distribution<float> background(0.0f, 0.05f);
+        std::uniform_int_distribution<int> class_id(0, 79);
+
+        std::vector<float> output(OUTPUT_ROWS * 6);
+        for (int i = 0; i < OUTPUT_ROWS; ++i)
+        {
+            float left = position(rng);
+            float top = position(rng);
+            output[i * 6 + 0] = left;
+            output[i * 6 + 1] = top;
+            output[i * 6 + 2] = std::min(left + size(rng), 640.0f);
+            output[i * 6 + 3] = std::min(top + size(rng), 640.0f);
+            output[i * 6 + 4] = i < density ? confident(rng) : background(rng);
+            output[i * 6 + 5] = static_cast<float>(class_id(rng));
+        }
+        return output;
+    }
+
+    void resolutionArgs(benchmark::internal::Benchmark *benchmark)
+    {
+        benchmark->Args({640, 480})
+            ->Args({1280, 720})
+            ->Args({1920, 1080})
+            ->Args({3840, 2160});
+    }
+
+    void decodeArgs(benchmark::internal::Benchmark *benchmark)
+    {
+        for (int density : {0, 10, 100, 300})
+        {
+            for (int threshold : {25, 50, 90})
+            {
+                benchmark->Args({density, threshold});
+            }
+        }
+    }
+}
+
+static void BM_PreprocessStretch(benchmark::State &state)
+{
+    cv::Mat frame = syntheticFrame(state.range(0), state.range(1));
+
+    for (auto _ : state)
+    {
+        std::vector<float> tensor = preprocessStretch(frame, INPUT_SIZE);
+        benchmark::DoNotOptimize(tensor.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(frame.total() * frame.elemSize()));
+}
+BENCHMARK(BM_PreprocessStretch)->Apply(resolutionArgs)->Unit(benchmark::kMicrosecond);
+
+static void BM_PreprocessLetterbox(benchmark::State &state)
+{
+    cv::Mat frame = syntheticFrame(state.range(0), state.range(1));
+    cv::Rect region(0, 0, frame.cols, frame.rows);
+    LetterboxTransform transform;
+
+    for (auto _ : state)
+    {
+        std::vector<float> tensor = preprocessLetterbox(frame, region, INPUT_SIZE, transform);
+        benchmark::DoNotOptimize(tensor.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(frame.total() * frame.elemSize()));
+}
+BENCHMARK(BM_PreprocessLetterbox)->Apply(resolutionArgs)->Unit(benchmark::kMicrosecond);
+
+// NV12 as a hardware decoder hands it out, converted to BGR at full
+// resolution and then preprocessed, the path before preprocessYuv existed
+static void BM_PreprocessNv12Convert(benchmark::State &state)
+{
+    cv::Mat i420;
+    cv::cvtColor(syntheticFrame(state.range(0), state.range(1)), i420, cv::COLOR_BGR2YUV_I420);
+    const int width = state.range(0);
+    const int height = state.range(1);
+    // The chroma planes are read as one interleaved plane of the same size, values do not matter here
+    cv::Mat y_plane(height, width, CV_8UC1, i420.data);
+    cv::Mat uv_plane(height / 2, width / 2, CV_8UC2, i420.data + width * height);
+    cv::Mat bgr;
+    std::vector<float> tensor;
+
+    for (auto _ : state)
+    {
+        cv::cvtColorTwoPlane(y_plane, uv_plane, bgr, cv::COLOR_YUV2BGR_NV12);
+        preprocessStretch(bgr, INPUT_SIZE, tensor);
+        benchmark::DoNotOptimize(tensor.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PreprocessNv12Convert)->Apply(resolutionArgs)->Unit(benchmark::kMicrosecond);
+
+static void BM_PreprocessNv12Fused(benchmark::State &state)
+{
+    cv::Mat i420;
+    cv::cvtColor(syntheticFrame(state.range(0), state.range(1)), i420, cv::COLOR_BGR2YUV_I420);
+    const int width = state.range(0);
+    const int height = state.range(1);
+    const YuvFrame frame{PixelFormat::NV12, width, height, {i420.data, i420.data + width * height, nullptr}, {width, width, 0}};
+    std::vector<float> tensor;
+
+    for (auto _ : state)
+    {
+        preprocessYuv(frame, INPUT_SIZE, tensor);
+        benchmark::DoNotOptimize(tensor.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PreprocessNv12Fused)->Apply(resolutionArgs)->Unit(benchmark::kMicrosecond);
+
+static void BM_DecodeStretch(benchmark::State &state)
+{
+    const std::vector<float> output = syntheticOutput(state.range(0));
+    const float threshold = state.range(1) / 100.0f;
+    const std::vector<std::string> class_names = syntheticClassNames();
+
+    size_t kept = 0;
+    for (auto _ : state)
+    {
+        std::vector<Detection> detections = decodeDetections(output, threshold, INPUT_SIZE.width, INPUT_SIZE.height, 1920, 1080, class_names);
+        kept = detections.size();
+        benchmark::DoNotOptimize(detections.data());
+    }
+    state.counters["kept"] = static_cast<double>(kept);
+    state.SetItemsProcessed(state.iterations() * OUTPUT_ROWS);
+}
+BENCHMARK(BM_DecodeStretch)->Apply(decodeArgs);
+
+static void BM_DecodeLetterbox(benchmark::State &state)
+{
+    const std::vector<float> output = syntheticOutput(state.range(0));
+    const float threshold = state.range(1) / 100.0f;
+    const std::vector<std::string> class_names = syntheticClassNames();
+    const LetterboxTransform transform{cv::Rect(0, 0, 1920, 1080), 1.0f / 3.0f, 0, 140};
+
+    size_t kept = 0;
+    for (auto _ : state)
+    {
+        std::vector<Detection> detections = decodeDetections(output, threshold, transform, class_names);
+        kept = detections.size();
+        benchmark::DoNotOptimize(detections.data());
+    }
+    state.counters["kept"] = static_cast<double>(kept);
+    state.SetItemsProcessed(state.iterations() * OUTPUT_ROWS);
+}
+BENCHMARK(BM_DecodeLetterbox)->Apply(decodeArgs);
+
+static void BM_DrawLabels(benchmark::State &state)
+{
+    cv::Mat frame = syntheticFrame(1920, 1080);
+    const std::vector<Detection> detections = decodeDetections(syntheticOutput(state.range(0)), 0.25f, INPUT_SIZE.width, INPUT_SIZE.height, frame.cols, frame.rows, syntheticClassNames());
+    LabelRenderer renderer;
+
+    // Render once so the sprite cache is warm, as it is after the first frames of a stream
+    renderer.render(frame, detections);
+
+    for (auto _ : state)
+    {
+        renderer.render(frame, detections);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(detections.size()));
+}
+BENCHMARK(BM_DrawLabels)->Arg(0)->Arg(10)->Arg(50)->Arg(100)->Arg(300)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,252 @@
+#include "yolov10_c.h"
+#include "ia/inference.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <exception>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+struct yolov10_engine
+{
+    yolov10_engine(const std::string &model_path, const EngineConfig &config)
+        : engine(model_path, config)
+    {
+    }
+
+    InferenceEngine engine;
+};
+
+namespace
+{
+    thread_local std::string last_error;
+
+    yolov10_status fail(yolov10_status status, const std::string &message)
+    {
+        last_error = message;
+        return status;
+    }
+
+    bool isYuv(yolov10_pixel_format format)
+    {
+        return format == YOLOV10_PIXEL_NV12 || format == YOLOV10_PIXEL_I420 || format == YOLOV10_PIXEL_YUYV;
+    }
+
+    YuvFrame yuvFrame(const yolov10_image &image)
+    {
+        const PixelFormat format = image.format == YOLOV10_PIXEL_NV12 ? PixelFormat::NV12 : image.format == YOLOV10_PIXEL_I420 ? PixelFormat::I420
+                                                                                                                               : PixelFormat::YUYV;
+        return {format, image.width, image.height, {image.planes[0], image.planes[1], image.planes[2]}, {image.strides[0], image.strides[1], image.strides[2]}};
+    }
+
+    // Checks the description makes sense before the caller's pixels are
+    // wrapped, so a bad stride cannot read out of bounds
+    void checkImage(const yolov10_image &image)
+    {
+        if (image.width <= 0 || image.height <= 0 || !image.planes[0])
+        {
+            throw std::runtime_error("Image has no pixels");
+        }
+        if (!isYuv(image.format) && image.format != YOLOV10_PIXEL_BGR && image.format != YOLOV10_PIXEL_RGB)
+        {
+            throw std::runtime_error("Unknown pixel format");
+        }
+        if (!isYuv(image.format) && image.strides[0] < image.width * 3)
+        {
+            throw std::runtime_error("Stride is shorter than a row of pixels");
+        }
+    }
+
+    void preprocess(InferenceEngine &engine, const yolov10_image &image, std::vector<float> &tensor)
+    {
+        if (isYuv(image.format))
+        {
+            // Converted at network resolution, the full frame is never turned into BGR
+            engine.preprocessImage(yuvFrame(image), tensor);
+            return;
+        }
+
+        engine.preprocessImage(cv::Mat(image.height, image.width, CV_8UC3, const_cast<uint8_t *>(image.planes[0]), image.strides[0]), tensor);
+        if (image.format == YOLOV10_PIXEL_RGB)
+        {
+            // The tensor planes follow the pixel order, so RGB only needs its
+            // first and last planes swapped at network resolution
+            const size_t plane_size = tensor.size() / 3;
+            std::swap_ranges(tensor.begin(), tensor.begin() + plane_size, tensor.begin() + 2 * plane_size);
+        }
+    }
+}
+
+uint32_t yolov10_abi_version(void)
+{
+    return YOLOV10_ABI_VERSION;
+}
+
+void yolov10_engine_options_init(yolov10_engine_options *options)
+{
+    if (!options)
+    {
+        return;
+    }
+
+    EngineConfig defaults;
+    options->struct_size = sizeof(yolov10_engine_options);
+    options->intra_op_threads = defaults.intra_op_threads;
+    options->warmup_iterations = defaults.warmup_iterations;
+    options->labels_path = nullptr;
+}
+
+/*
+ * Function to load a model
+ *
+ * @param model_path: path of the ONNX model
+ * @param options: engine options, or NULL for the defaults
+ * @param engine: set to the new engine, or NULL on failure
+ *
+ * @return: YOLOV10_OK, or the reason the model could not be loaded
+ */
+yolov10_status yolov10_engine_create(const char *model_path, const yolov10_engine_options *options, yolov10_engine **engine)
+{
+    if (!engine)
+    {
+        return fail(YOLOV10_ERROR_INVALID_ARGUMENT, "No engine pointer given");
+    }
+    *engine = nullptr;
+    if (!model_path)
+    {
+        return fail(YOLOV10_ERROR_INVALID_ARGUMENT, "No model path given");
+    }
+
+    // A caller built against an older header passes a shorter struct: the
+    // fields it knows are copied over the defaults, the rest keep theirs.
+    // labels_path ends the fields of the first version of the ABI.
+    yolov10_engine_options resolved;
+    yolov10_engine_options_init(&resolved);
+    if (options)
+    {
+        if (options->struct_size < offsetof(yolov10_engine_options, labels_path) + sizeof(resolved.labels_path))
+        {
+            return fail(YOLOV10_ERROR_INVALID_ARGUMENT, "Options were not set up with yolov10_engine_options_init");
+        }
+        std::memcpy(&resolved, options, std::min<size_t>(options->struct_size, sizeof(resolved)));
+        resolved.struct_size = sizeof(resolved);
+    }
+    options = &resolved;
+
+    try
+    {
+        EngineConfig config;
+        config.intra_op_threads = options->intra_op_threads;
+        config.warmup_iterations = options->warmup_iterations;
+        if (options->labels_path)
+        {
+            config.class_names = loadClassNames(options->labels_path);
+        }
+
+        *engine = new yolov10_engine(model_path, config);
+    }
+    catch (const std::exception &e)
+    {
+        return fail(YOLOV10_ERROR_MODEL, e.what());
+    }
+    catch (...)
+    {
+        return fail(YOLOV10_ERROR_MODEL, "Unknown error while loading the model");
+    }
+
+    return YOLOV10_OK;
+}
+
+void yolov10_engine_destroy(yolov10_engine *engine)
+{
+    delete engine;
+}
+
+/*
+ * Function to detect objects in a frame owned by the caller
+ *
+ * @param engine: engine from yolov10_engine_create
+ * @param image: frame to look at, only read during the call
+ * @param confidence_threshold: minimum confidence threshold
+ * @param detections: filled with up to capacity detections, may be NULL if capacity is 0
+ * @param capacity: number of entries in detections
+ * @param count: set to the number of detections found, even if they did not all fit
+ *
+ * @return: YOLOV10_OK, YOLOV10_ERROR_BUFFER_TOO_SMALL if count is above capacity, or an error
+ */
+yolov10_status yolov10_detect(yolov10_engine *engine, const yolov10_image *image, float confidence_threshold,
+                              yolov10_detection *detections, size_t capacity, size_t *count)
+{
+    if (!engine || !image || !count || (capacity && !detections))
+    {
+        return fail(YOLOV10_ERROR_INVALID_ARGUMENT, "Missing engine, image, count or detection buffer");
+    }
+    *count = 0;
+
+    // Tensors are reused from call to call by every calling thread
+    thread_local std::vector<float> input_tensor_values;
+    thread_local std::vector<float> results;
+
+    try
+    {
+        checkImage(*image);
+        if (isYuv(image->format))
+        {
+            checkYuvFrame(yuvFrame(*image));
+        }
+    }
+    catch (const std::exception &e)
+    {
+        return fail(YOLOV10_ERROR_INVALID_ARGUMENT, e.what());
+    }
+
+    std::vector<Detection> found;
+    try
+    {
+        InferenceEngine &inference = engine->engine;
+        const cv::Size input_size = inference.inputSize();
+        preprocess(inference, *image, input_tensor_values);
+        inference.runInference(input_tensor_values, results);
+        found = inference.filterDetections(results, confidence_threshold, input_size.width, input_size.height, image->width, image->height);
+    }
+    catch (const std::exception &e)
+    {
+        return fail(YOLOV10_ERROR_INFERENCE, e.what());
+    }
+    catch (...)
+    {
+        return fail(YOLOV10_ERROR_INFERENCE, "Unknown error during inference");
+    }
+
+    const size_t written = std::min(capacity, found.size());
+    for (size_t i = 0; i < written; ++i)
+    {
+        const Detection &detection = found[i];
+        detections[i] = {detection.class_id, detection.confidence, detection.bbox.x, detection.bbox.y, detection.bbox.width, detection.bbox.height};
+    }
+
+    *count = found.size();
+    if (written < found.size())
+    {
+        return fail(YOLOV10_ERROR_BUFFER_TOO_SMALL, "Detection buffer holds " + std::to_string(capacity) + " entries, " + std::to_string(found.size()) + " found");
+    }
+    return YOLOV10_OK;
+}
+
+const char *yolov10_class_name(const yolov10_engine *engine, int32_t class_id)
+{
+    if (!engine)
+    {
+        return nullptr;
+    }
+
+    const std::vector<std::string> &names = engine->engine.classNames();
+    return class_id >= 0 && static_cast<size_t>(class_id) < names.size() ? names[class_id].c_str() : nullptr;
+}
+
+const char *yolov10_last_error(void)
+{
+    return last_error.c_str();
+}
@@ -0,0 +1,117 @@
+#ifndef YOLOV10_C_H
+#define YOLOV10_C_H
+
+/*
+ * C interface of libyolov10, for services written in other languages (Go
+ * through cgo, Rust through bindgen, ...). Only plain C types cross it, so
+ * neither ONNX Runtime nor OpenCV headers are needed to use it, and the
+ * layout of every struct below is part of the ABI: fields are only ever
+ * added at the end, guarded by struct_size.
+ *
+ * Every function returning yolov10_status is safe to call from several
+ * threads on the same engine. On failure the message of the last error of
+ * the calling thread is available from yolov10_last_error.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32) && defined(YOLOV10_BUILDING_LIBRARY)
+#define YOLOV10_API __declspec(dllexport)
+#elif defined(_WIN32)
+#define YOLOV10_API __declspec(dllimport)
+#else
+#define YOLOV10_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Bumped when a struct gains a field or a function is added
+#define YOLOV10_ABI_VERSION 2
+
+typedef struct yolov10_engine yolov10_engine;
+
+typedef enum
+{
+    YOLOV10_OK = 0,
+    YOLOV10_ERROR_INVALID_ARGUMENT = 1,
+    YOLOV10_ERROR_MODEL = 2,
+    YOLOV10_ERROR_INFERENCE = 3,
+    // More detections than the caller's buffer holds; it is filled and the
+    // total count is reported
+    YOLOV10_ERROR_BUFFER_TOO_SMALL = 4
+} yolov10_status;
+
+typedef enum
+{
+    // One plane of interleaved 8-bit pixels, stride bytes per row
+    YOLOV10_PIXEL_BGR = 0,
+    YOLOV10_PIXEL_RGB = 1,
+    // BT.601 video range YUV, converted on the fly at network resolution.
+    // NV12: Y plane and half resolution interleaved UV plane, as output by
+    // most hardware decoders. I420: Y, U and V planes, U and V at half
+    // resolution. YUYV: one packed plane, Y0 U Y1 V for each pixel pair.
+    YOLOV10_PIXEL_NV12 = 2,
+    YOLOV10_PIXEL_I420 = 3,
+    YOLOV10_PIXEL_YUYV = 4
+} yolov10_pixel_format;
+
+// Frame in the caller's memory, read during the call and never copied
+typedef struct
+{
+    yolov10_pixel_format format;
+    int32_t width;
+    int32_t height;
+    // Only the planes the format uses are read
+    const uint8_t *planes[3];
+    int32_t strides[3];
+} yolov10_image;
+
+// Box in frame pixels
+typedef struct
+{
+    int32_t class_id;
+    float confidence;
+    int32_t x;
+    int32_t y;
+    int32_t width;
+    int32_t height;
+} yolov10_detection;
+
+typedef struct
+{
+    // sizeof(yolov10_engine_options) of the caller, set by yolov10_engine_options_init
+    uint32_t struct_size;
+    // ONNX Runtime intra-op threads, 0 for one per core
+    int32_t intra_op_threads;
+    // Dummy runs made by yolov10_engine_create
+    int32_t warmup_iterations;
+    // File with one class name per line, NULL for the COCO classes
+    const char *labels_path;
+} yolov10_engine_options;
+
+YOLOV10_API uint32_t yolov10_abi_version(void);
+YOLOV10_API void yolov10_engine_options_init(yolov10_engine_options *options);
+
+// options may be NULL for the defaults; *engine is NULL on failure
+YOLOV10_API yolov10_status yolov10_engine_create(const char *model_path, const yolov10_engine_options *options, yolov10_engine **engine);
+YOLOV10_API void yolov10_engine_destroy(yolov10_engine *engine);
+
+// Writes up to capacity detections, *count is the number found
+YOLOV10_API yolov10_status yolov10_detect(yolov10_engine *engine, const yolov10_image *image, float confidence_threshold,
+                                          yolov10_detection *detections, size_t capacity, size_t *count);
+
+// Name of a class id, owned by the engine; NULL for an unknown id
+YOLOV10_API const char *yolov10_class_name(const yolov10_engine *engine, int32_t class_id);
+
+// Message of the last failed call on this thread, empty if none
+YOLOV10_API const char *yolov10_last_error(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // YOLOV10_C_H
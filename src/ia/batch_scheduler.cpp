@@ -0,0 +1,414 @@
+#include "batch_scheduler.h"
+#include "metrics/metrics.h"
+#include "metrics/trace.h"
+#include "system/cpu_topology.h"
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+
+namespace
+{
+    // Weight of the newest run in the moving average of the batch latency
+    const double LATENCY_SMOOTHING = 0.2;
+
+    Counter &shedCounter(const char *reason)
+    {
+        return MetricsRegistry::global().counter("yolov10_requests_shed_total", "Requests failed because they could not meet their deadline", std::string("reason=\"") + reason + "\"");
+    }
+}
+
+BatchScheduler::BatchScheduler(InferenceEngine &engine, const BatchConfig &config)
+    : engine(engine),
+      config(config),
+      stopping(false),
+      fallback(nullptr),
+      batch_latency_us(0.0),
+      queue_depth(queueDepthGauge(config.queue_name)),
+      batch_sizes(MetricsRegistry::global().histogram("yolov10_batch_size", "Number of images per inference run", "", MetricsRegistry::linearBounds(1, 1, 32)))
+{
+    this->config.max_batch_size = engine.supportsBatching() ? std::max<size_t>(1, config.max_batch_size) : 1;
+
+    for (int i = 0; i < std::max(1, config.workers); ++i)
+    {
+        workers.emplace_back(&BatchScheduler::run, this);
+    }
+}
+
+BatchScheduler::~BatchScheduler()
+{
+    stop();
+}
+
+/*
+ * Function to queue an image for detection
+ *
+ * @param image: BGR image, only read during this call
+ * @param confidence_threshold: minimum confidence threshold
+ * @param done: called with the detections or the error, usually from a worker
+ *              thread; it must not throw
+ */
+void BatchScheduler::submit(const cv::Mat &image, float confidence_threshold, Callback done)
+{
+    submit(image, confidence_threshold, Clock::time_point::max(), std::move(done));
+}
+
+/*
+ * Function to queue an image for detection with a deadline
+ *
+ * A request that cannot be served by the deadline given the queue ahead of
+ * it goes to the fallback scheduler if there is one, and otherwise fails
+ * with DeadlineExceeded without being preprocessed.
+ *
+ * @param image: BGR image, only read during this call
+ * @param confidence_threshold: minimum confidence threshold
+ * @param deadline: time by which the detections are needed
+ * @param done: called with the detections or the error, usually from a worker
+ *              thread; it must not throw
+ */
+void BatchScheduler::submit(const cv::Mat &image, float confidence_threshold, Clock::time_point deadline, Callback done)
+{
+    static Counter &downgraded = MetricsRegistry::global().counter("yolov10_requests_downgraded_total", "Requests sent to the fallback model to meet their deadline");
+    static Counter &shed_admission = shedCounter("admission");
+
+    Request request{std::vector<float>(), image.cols, image.rows, confidence_threshold, deadline, std::move(done)};
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!canMeet(request, Clock::now(), queue.size()))
+        {
+            BatchScheduler *target = fallback.load();
+            lock.unlock();
+            if (target)
+            {
+                downgraded.increment();
+                target->submit(image, confidence_threshold, deadline, std::move(request.done));
+            }
+            else
+            {
+                shed_admission.increment();
+                request.done({}, std::make_exception_ptr(DeadlineExceeded("Request cannot meet its deadline")));
+            }
+            return;
+        }
+
+        // Reuse the tensor of an earlier request instead of allocating one
+        if (!spare_tensors.empty())
+        {
+            request.input_tensor_values = std::move(spare_tensors.back());
+            spare_tensors.pop_back();
+        }
+    }
+
+    try
+    {
+        engine.preprocessImage(image, request.input_tensor_values);
+    }
+    catch (...)
+    {
+        request.done({}, std::current_exception());
+        return;
+    }
+
+    if (!enqueue(request))
+    {
+        request.done({}, std::make_exception_ptr(std::runtime_error("Batch scheduler is stopped")));
+    }
+}
+
+/*
+ * Function to queue an image for detection and get a future for the result
+ *
+ * @param image: BGR image, only read during this call
+ * @param confidence_threshold: minimum confidence threshold
+ *
+ * @return: future holding the detections
+ */
+std::future<std::vector<Detection>> BatchScheduler::submit(const cv::Mat &image, float confidence_threshold)
+{
+    return submit(image, confidence_threshold, Clock::time_point::max());
+}
+
+/*
+ * Function to queue an image for detection with a deadline and get a future for the result
+ *
+ * @param image: BGR image, only read during this call
+ * @param confidence_threshold: minimum confidence threshold
+ * @param deadline: time by which the detections are needed
+ *
+ * @return: future holding the detections, or DeadlineExceeded if the request was shed
+ */
+std::future<std::vector<Detection>> BatchScheduler::submit(const cv::Mat &image, float confidence_threshold, Clock::time_point deadline)
+{
+    auto promise = std::make_shared<std::promise<std::vector<Detection>>>();
+    std::future<std::vector<Detection>> result = promise->get_future();
+
+    submit(image, confidence_threshold, deadline, [promise](std::vector<Detection> detections, std::exception_ptr error)
+           {
+               if (error)
+               {
+                   promise->set_exception(error);
+               }
+               else
+               {
+                   promise->set_value(std::move(detections));
+               } });
+
+    return result;
+}
+
+/*
+ * Function to set the scheduler that takes requests this one cannot serve in time
+ *
+ * It should run a smaller model or a lower resolution. Requests that expire
+ * in the queue are only moved to it when both engines take the same input.
+ *
+ * @param fallback: scheduler of the cheaper model, outliving this one
+ */
+void BatchScheduler::setFallback(BatchScheduler &fallback)
+{
+    for (BatchScheduler *next = &fallback; next; next = next->fallback.load())
+    {
+        if (next == this)
+        {
+            throw std::runtime_error("Fallback schedulers must not form a cycle");
+        }
+    }
+
+    this->fallback.store(&fallback);
+}
+
+/*
+ * Function to finish the queued requests and stop the workers
+ */
+void BatchScheduler::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    queue_cv.notify_all();
+
+    for (auto &worker : workers)
+    {
+        if (worker.joinable())
+        {
+            worker.join();
+        }
+    }
+    workers.clear();
+}
+
+size_t BatchScheduler::queueDepth()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return queue.size();
+}
+
+std::chrono::microseconds BatchScheduler::expectedBatchLatency()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return std::chrono::microseconds(static_cast<int64_t>(batch_latency_us));
+}
+
+/*
+ * Function to tell whether a request can still meet its deadline
+ *
+ * Must be called with the mutex held. Without a latency measurement yet
+ * every request is assumed to make it.
+ *
+ * @param request: request to check
+ * @param start: time the request would start waiting
+ * @param ahead: number of requests served before it
+ *
+ * @return: true if the batches ahead and its own finish by the deadline
+ */
+bool BatchScheduler::canMeet(const Request &request, Clock::time_point start, size_t ahead) const
+{
+    if (request.deadline == Clock::time_point::max() || batch_latency_us == 0.0)
+    {
+        return true;
+    }
+
+    const size_t per_round = config.max_batch_size * static_cast<size_t>(std::max(1, config.workers));
+    const auto rounds = static_cast<int64_t>(ahead / per_round + 1);
+    return start + std::chrono::microseconds(static_cast<int64_t>(batch_latency_us)) * rounds <= request.deadline;
+}
+
+/*
+ * Function to add a preprocessed request to the queue, earliest deadline first
+ *
+ * Requests with the same deadline, including those without one, keep their
+ * arrival order.
+ *
+ * @param request: request to move into the queue
+ *
+ * @return: false if the scheduler is stopped and the request was left as is
+ */
+bool BatchScheduler::enqueue(Request &request)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (stopping)
+    {
+        return false;
+    }
+
+    auto position = std::upper_bound(queue.begin(), queue.end(), request.deadline, [](Clock::time_point deadline, const Request &queued)
+                                     { return deadline < queued.deadline; });
+    queue.insert(position, std::move(request));
+    queue_depth.set(static_cast<int64_t>(queue.size()));
+    lock.unlock();
+    queue_cv.notify_one();
+    return true;
+}
+
+/*
+ * Function to take care of a request that expired in the queue
+ *
+ * Must be called without the mutex held.
+ *
+ * @param request: request that can no longer meet its deadline
+ */
+void BatchScheduler::expire(Request &request)
+{
+    static Counter &downgraded = MetricsRegistry::global().counter("yolov10_requests_downgraded_total", "Requests sent to the fallback model to meet their deadline");
+    static Counter &shed_queue = shedCounter("queue");
+
+    // The tensor is already preprocessed, so it can only move to an engine taking the same input
+    BatchScheduler *target = fallback.load();
+    if (target && target->engine.input_shape == engine.input_shape && target->enqueue(request))
+    {
+        downgraded.increment();
+        return;
+    }
+
+    shed_queue.increment();
+    request.done({}, std::make_exception_ptr(DeadlineExceeded("Request expired in the queue")));
+}
+
+void BatchScheduler::run()
+{
+    Tracer::global().setThreadName("batch scheduler");
+    pinCurrentThread(config.cpus);
+
+    std::vector<Request> batch;
+    std::vector<Request> expired;
+    std::vector<float> batch_tensor;
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true)
+    {
+        queue_cv.wait(lock, [this]
+                      { return !queue.empty() || stopping; });
+        if (queue.empty())
+        {
+            break;
+        }
+
+        // Give other clients a short window to fill the batch, but not so
+        // long that the most urgent request misses its deadline
+        if (queue.size() < config.max_batch_size && !stopping)
+        {
+            auto deadline = std::chrono::steady_clock::now() + config.max_wait;
+            auto latest_start = queue.front().deadline - std::chrono::microseconds(static_cast<int64_t>(batch_latency_us));
+            queue_cv.wait_until(lock, std::min(deadline, latest_start), [this]
+                                { return queue.size() >= config.max_batch_size || stopping; });
+            if (queue.empty())
+            {
+                continue;
+            }
+        }
+
+        // Requests that would finish too late are not worth the inference time
+        const Clock::time_point now = Clock::now();
+        while (!queue.empty() && batch.size() < config.max_batch_size)
+        {
+            (canMeet(queue.front(), now, 0) ? batch : expired).push_back(std::move(queue.front()));
+            queue.pop_front();
+        }
+        queue_depth.set(static_cast<int64_t>(queue.size()));
+        if (!batch.empty())
+        {
+            batch_sizes.observe(static_cast<double>(batch.size()));
+        }
+
+        lock.unlock();
+        if (!queue.empty())
+        {
+            queue_cv.notify_one();
+        }
+        for (auto &request : expired)
+        {
+            expire(request);
+        }
+        if (!batch.empty())
+        {
+            auto start = Clock::now();
+            process(batch, batch_tensor);
+            const double elapsed = static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count());
+            lock.lock();
+            batch_latency_us = batch_latency_us == 0.0 ? elapsed : (1.0 - LATENCY_SMOOTHING) * batch_latency_us + LATENCY_SMOOTHING * elapsed;
+        }
+        else
+        {
+            lock.lock();
+        }
+
+        for (auto *requests : {&batch, &expired})
+        {
+            for (auto &request : *requests)
+            {
+                if (spare_tensors.size() < MAX_SPARE_TENSORS && request.input_tensor_values.capacity() > 0)
+                {
+                    spare_tensors.push_back(std::move(request.input_tensor_values));
+                }
+            }
+            requests->clear();
+        }
+    }
+}
+
+void BatchScheduler::process(std::vector<Request> &batch, std::vector<float> &batch_tensor)
+{
+    std::vector<std::vector<float>> results;
+    try
+    {
+        if (batch.size() == 1)
+        {
+            results.push_back(engine.runInference(batch[0].input_tensor_values));
+        }
+        else
+        {
+            batch_tensor.clear();
+            for (const auto &request : batch)
+            {
+                batch_tensor.insert(batch_tensor.end(), request.input_tensor_values.begin(), request.input_tensor_values.end());
+            }
+            results = engine.runInferenceBatch(batch_tensor, batch.size());
+        }
+    }
+    catch (...)
+    {
+        std::exception_ptr error = std::current_exception();
+        for (auto &request : batch)
+        {
+            request.done({}, error);
+        }
+        return;
+    }
+
+    const cv::Size input_size = engine.inputSize();
+    for (size_t i = 0; i < batch.size(); ++i)
+    {
+        Request &request = batch[i];
+        std::vector<Detection> detections;
+        std::exception_ptr error;
+        try
+        {
+            detections = engine.filterDetections(results[i], request.confidence_threshold, input_size.width, input_size.height, request.orig_width, request.orig_height);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        request.done(std::move(detections), error);
+    }
+}
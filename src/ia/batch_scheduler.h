@@ -0,0 +1,105 @@
+#ifndef BATCH_SCHEDULER_H
+#define BATCH_SCHEDULER_H
+
+#include "inference.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+class Counter;
+class Gauge;
+class Histogram;
+
+// Error given to requests shed because they could not meet their deadline
+class DeadlineExceeded : public std::runtime_error
+{
+public:
+    using std::runtime_error::runtime_error;
+};
+
+struct BatchConfig
+{
+    size_t max_batch_size = 8;
+    std::chrono::microseconds max_wait{2000};
+    int workers = 1;
+    std::vector<int> cpus;
+
+    // Label of the queue depth gauge, distinct per scheduler when several run
+    std::string queue_name = "batch";
+};
+
+
+// Collects detection requests from many threads and runs them through one
+// engine in batches. Images are preprocessed on the submitting thread, so
+// only the model runs on the scheduler's workers.
+//
+// Requests may carry a deadline. They are served earliest deadline first,
+// so streams with tighter SLOs go ahead, and a request that cannot finish
+// in time given the measured batch latency is handed to the fallback
+// scheduler (a smaller model) or failed with DeadlineExceeded before any
+// inference time is spent on it. Under overload latency stays bounded and
+// the excess is shed.
+class BatchScheduler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using Callback = std::function<void(std::vector<Detection> detections, std::exception_ptr error)>;
+
+    BatchScheduler(InferenceEngine &engine, const BatchConfig &config = BatchConfig());
+    ~BatchScheduler();
+
+    void submit(const cv::Mat &image, float confidence_threshold, Callback done);
+    void submit(const cv::Mat &image, float confidence_threshold, Clock::time_point deadline, Callback done);
+    std::future<std::vector<Detection>> submit(const cv::Mat &image, float confidence_threshold);
+    std::future<std::vector<Detection>> submit(const cv::Mat &image, float confidence_threshold, Clock::time_point deadline);
+    void setFallback(BatchScheduler &fallback);
+    void stop();
+
+    size_t queueDepth();
+    std::chrono::microseconds expectedBatchLatency();
+
+private:
+    struct Request
+    {
+        std::vector<float> input_tensor_values;
+        int orig_width;
+        int orig_height;
+        float confidence_threshold;
+        Clock::time_point deadline;
+        Callback done;
+    };
+
+    static constexpr size_t MAX_SPARE_TENSORS = 64;
+
+    InferenceEngine &engine;
+    BatchConfig config;
+    std::mutex mutex;
+    std::condition_variable queue_cv;
+    std::deque<Request> queue;
+    std::vector<std::vector<float>> spare_tensors;
+    bool stopping;
+    std::atomic<BatchScheduler *> fallback;
+    // Smoothed duration of one inference run, 0 until the first one
+    double batch_latency_us;
+    Gauge &queue_depth;
+    Histogram &batch_sizes;
+    std::vector<std::thread> workers;
+
+    void run();
+    void process(std::vector<Request> &batch, std::vector<float> &batch_tensor);
+    bool canMeet(const Request &request, Clock::time_point start, size_t ahead) const;
+    bool enqueue(Request &request);
+    void expire(Request &request);
+};
+
+
+#endif // BATCH_SCHEDULER_H
@@ -0,0 +1,166 @@
+#include "cascade.h"
+#include "metrics/metrics.h"
+#include "metrics/trace.h"
+#include <algorithm>
+#include <stdexcept>
+
+CascadeDetector::CascadeDetector(InferenceEngine &small_engine, InferenceEngine &large_engine, const CascadeConfig &config)
+    : small_engine(small_engine),
+      large_engine(large_engine),
+      config(config),
+      frame_count(0),
+      escalation_count(0)
+{
+    if (config.uncertain_low > config.uncertain_high)
+    {
+        throw std::runtime_error("Cascade uncertainty band is empty: low is above high");
+    }
+}
+
+/*
+ * Function to detect objects with the cascade
+ *
+ * The small model runs on the whole frame. If none of its detections falls
+ * in the uncertainty band and the frame is not an audit frame, its
+ * detections are the result. Otherwise the large model runs on the
+ * uncertain boxes or on the full frame; its detections replace the uncertain
+ * ones and are merged with the trusted small model detections.
+ *
+ * @param image: BGR frame
+ *
+ * @return: vector of Detection objects in frame coordinates
+ */
+std::vector<Detection> CascadeDetector::detect(const cv::Mat &image)
+{
+    static Counter &frames_total = MetricsRegistry::global().counter("yolov10_cascade_frames_total", "Frames processed by the cascade");
+    static Counter &uncertain_total = MetricsRegistry::global().counter("yolov10_cascade_escalations_total", "Frames sent to the large model", "reason=\"uncertain\"");
+    static Counter &audit_total = MetricsRegistry::global().counter("yolov10_cascade_escalations_total", "Frames sent to the large model", "reason=\"audit\"");
+
+    // Tensors are reused from frame to frame by every thread running the cascade
+    thread_local std::vector<float> input_tensor_values;
+    thread_local std::vector<float> results;
+
+    const uint64_t frame = frame_count.fetch_add(1);
+    frames_total.increment();
+
+    // Keep everything down to the bottom of the band to know whether to escalate
+    const float candidate_threshold = std::min(config.uncertain_low, config.confidence_threshold);
+    small_engine.preprocessImage(image, input_tensor_values);
+    small_engine.runInference(input_tensor_values, results);
+    std::vector<Detection> candidates = small_engine.filterDetections(results, candidate_threshold, small_engine.input_shape[3], small_engine.input_shape[2], image.cols, image.rows);
+
+    std::vector<Detection> uncertain;
+    std::vector<Detection> trusted;
+    for (auto &detection : candidates)
+    {
+        if (detection.confidence >= config.uncertain_low && detection.confidence < config.uncertain_high)
+        {
+            uncertain.push_back(std::move(detection));
+        }
+        else if (detection.confidence >= config.confidence_threshold)
+        {
+            trusted.push_back(std::move(detection));
+        }
+    }
+
+    const bool audit = config.audit_period > 0 && frame % static_cast<uint64_t>(config.audit_period) == 0;
+    if (!audit && uncertain.empty())
+    {
+        return trusted;
+    }
+
+    TraceScope scope("escalate");
+    escalation_count.fetch_add(1);
+    (audit ? audit_total : uncertain_total).increment();
+
+    std::vector<Detection> large_detections;
+    if (audit || config.escalation == Escalation::FullFrame)
+    {
+        large_engine.preprocessImage(image, input_tensor_values);
+        large_engine.runInference(input_tensor_values, results);
+        large_detections = large_engine.filterDetections(results, config.confidence_threshold, large_engine.input_shape[3], large_engine.input_shape[2], image.cols, image.rows);
+    }
+    else
+    {
+        LetterboxTransform transform;
+        large_engine.preprocessRegion(image, escalationRegion(uncertain, image.size()), transform, input_tensor_values);
+        large_engine.runInference(input_tensor_values, results);
+        large_detections = large_engine.filterDetections(results, config.confidence_threshold, transform);
+    }
+
+    return merge(trusted, std::move(large_detections));
+}
+
+/*
+ * Function to get the region the large model looks at
+ *
+ * @param uncertain: small model detections in the uncertainty band
+ * @param frame_size: size of the frame
+ *
+ * @return: bounding box of the uncertain detections with the margin, inside the frame
+ */
+cv::Rect CascadeDetector::escalationRegion(const std::vector<Detection> &uncertain, const cv::Size &frame_size) const
+{
+    cv::Rect region = uncertain.front().bbox;
+    for (const auto &detection : uncertain)
+    {
+        region |= detection.bbox;
+    }
+
+    // Context around the objects helps the large model, and tiny crops would be upscaled a lot
+    const int margin_x = std::max(16, static_cast<int>(region.width * config.crop_margin));
+    const int margin_y = std::max(16, static_cast<int>(region.height * config.crop_margin));
+    region = cv::Rect(region.x - margin_x, region.y - margin_y, region.width + 2 * margin_x, region.height + 2 * margin_y);
+
+    return region & cv::Rect(cv::Point(0, 0), frame_size);
+}
+
+/*
+ * Function to merge the trusted small model detections with the large model ones
+ *
+ * The large model wins where both found the same object.
+ *
+ * @param small_detections: small model detections above the uncertainty band
+ * @param large_detections: large model detections
+ *
+ * @return: merged detections, large model ones first
+ */
+std::vector<Detection> CascadeDetector::merge(const std::vector<Detection> &small_detections, std::vector<Detection> large_detections) const
+{
+    const size_t large_count = large_detections.size();
+    for (const auto &detection : small_detections)
+    {
+        bool duplicate = false;
+        for (size_t i = 0; i < large_count && !duplicate; ++i)
+        {
+            duplicate = large_detections[i].class_id == detection.class_id && boxIou(large_detections[i].bbox, detection.bbox) >= config.merge_iou;
+        }
+        if (!duplicate)
+        {
+            large_detections.push_back(detection);
+        }
+    }
+
+    return large_detections;
+}
+
+uint64_t CascadeDetector::frames() const
+{
+    return frame_count.load();
+}
+
+uint64_t CascadeDetector::escalations() const
+{
+    return escalation_count.load();
+}
+
+/*
+ * Function to get the share of frames that needed the large model
+ *
+ * @return: escalations divided by frames, 0 before the first frame
+ */
+double CascadeDetector::escalationRate() const
+{
+    const uint64_t total = frames();
+    return total ? static_cast<double>(escalations()) / total : 0.0;
+}
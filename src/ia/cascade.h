@@ -0,0 +1,66 @@
+#ifndef CASCADE_H
+#define CASCADE_H
+
+#include "inference.h"
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+enum class Escalation
+{
+    Crop,
+    FullFrame
+};
+
+struct CascadeConfig
+{
+    float confidence_threshold = 0.5f;
+
+    // Detections of the small model in [uncertain_low, uncertain_high) send
+    // the frame to the large model; above the band they are trusted as is
+    float uncertain_low = 0.25f;
+    float uncertain_high = 0.6f;
+
+    // Every audit_period-th frame goes to the large model whatever the small
+    // one found, so objects it misses entirely are caught. 0 disables it.
+    int audit_period = 30;
+
+    // Crop runs the large model on the uncertain boxes only, enlarged by
+    // crop_margin of their size on each side; audit frames are always full
+    Escalation escalation = Escalation::Crop;
+    float crop_margin = 0.5f;
+
+    // A trusted small model box is dropped when a large model box of the
+    // same class overlaps it by at least this IoU
+    float merge_iou = 0.5f;
+};
+
+
+// Runs a small model on every frame and a large one only where the small
+// one is unsure, for close to large model accuracy at close to small model
+// cost. Both engines may be used by other callers at the same time.
+class CascadeDetector
+{
+public:
+    CascadeDetector(InferenceEngine &small_engine, InferenceEngine &large_engine, const CascadeConfig &config = CascadeConfig());
+
+    std::vector<Detection> detect(const cv::Mat &image);
+
+    uint64_t frames() const;
+    uint64_t escalations() const;
+    double escalationRate() const;
+
+private:
+    InferenceEngine &small_engine;
+    InferenceEngine &large_engine;
+    CascadeConfig config;
+    std::atomic<uint64_t> frame_count;
+    std::atomic<uint64_t> escalation_count;
+
+    cv::Rect escalationRegion(const std::vector<Detection> &uncertain, const cv::Size &frame_size) const;
+    std::vector<Detection> merge(const std::vector<Detection> &small_detections, std::vector<Detection> large_detections) const;
+};
+
+
+#endif // CASCADE_H
@@ -0,0 +1,98 @@
+#include "detect_async.h"
+#include <utility>
+
+/*
+ * Function to start a detection without waiting for it
+ *
+ * @param scheduler: scheduler whose workers run the model
+ * @param image: BGR image, only read during this call
+ * @param confidence_threshold: minimum confidence threshold
+ * @param done: called with the detections or the error; it must not throw
+ * @param deadline: time by which the detections are needed
+ * @param executor: runs done on the caller's thread, or null to run it on the worker
+ */
+void detectAsync(BatchScheduler &scheduler, const cv::Mat &image, float confidence_threshold, BatchScheduler::Callback done,
+                 BatchScheduler::Clock::time_point deadline, ResumeExecutor executor)
+{
+    if (!executor)
+    {
+        scheduler.submit(image, confidence_threshold, deadline, std::move(done));
+        return;
+    }
+
+    scheduler.submit(image, confidence_threshold, deadline, [done = std::move(done), executor = std::move(executor)](std::vector<Detection> detections, std::exception_ptr error) mutable
+                     { executor([done = std::move(done), detections = std::move(detections), error]() mutable
+                                { done(std::move(detections), error); }); });
+}
+
+#ifdef YOLOV10_HAS_COROUTINES
+
+DetectAwaitable::DetectAwaitable(BatchScheduler &scheduler, const cv::Mat &image, float confidence_threshold,
+                                 BatchScheduler::Clock::time_point deadline, ResumeExecutor executor)
+    : scheduler(scheduler),
+      image(image),
+      confidence_threshold(confidence_threshold),
+      deadline(deadline),
+      executor(std::move(executor))
+{
+}
+
+bool DetectAwaitable::await_ready() const noexcept
+{
+    return false;
+}
+
+/*
+ * Function to submit the image once the coroutine is suspended
+ *
+ * The coroutine may resume on another thread before submit returns, so
+ * nothing of the awaitable is touched after it. The executor moves into the
+ * callback for the same reason: the awaitable lives in the coroutine frame,
+ * which may be gone before the executor returns.
+ *
+ * @param handle: coroutine to resume with the result
+ */
+void DetectAwaitable::await_suspend(std::coroutine_handle<> handle)
+{
+    scheduler.submit(image, confidence_threshold, deadline, [this, handle, executor = std::move(executor)](std::vector<Detection> result, std::exception_ptr failure)
+                     {
+                         detections = std::move(result);
+                         error = failure;
+                         if (executor)
+                         {
+                             executor([handle]
+                                      { handle.resume(); });
+                         }
+                         else
+                         {
+                             handle.resume();
+                         } });
+}
+
+std::vector<Detection> DetectAwaitable::await_resume()
+{
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+    return std::move(detections);
+}
+
+/*
+ * Function to detect objects from a coroutine without blocking its thread
+ *
+ * @param scheduler: scheduler whose workers run the model
+ * @param image: BGR image, read when the result is awaited
+ * @param confidence_threshold: minimum confidence threshold
+ * @param deadline: time by which the detections are needed
+ * @param executor: resumes the coroutine on the caller's thread, or null to resume it on the worker
+ *
+ * @return: awaitable giving the vector of Detection objects
+ */
+DetectAwaitable detectAsync(BatchScheduler &scheduler, const cv::Mat &image, float confidence_threshold,
+                            BatchScheduler::Clock::time_point deadline, ResumeExecutor executor)
+{
+    return DetectAwaitable(scheduler, image, confidence_threshold, deadline, std::move(executor));
+}
+
+#endif // YOLOV10_HAS_COROUTINES
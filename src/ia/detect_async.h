@@ -0,0 +1,59 @@
+#ifndef DETECT_ASYNC_H
+#define DETECT_ASYNC_H
+
+#include "batch_scheduler.h"
+#include <opencv2/opencv.hpp>
+#include <exception>
+#include <functional>
+#include <vector>
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#define YOLOV10_HAS_COROUTINES 1
+#include <coroutine>
+#endif
+
+// Non-blocking detection for event loops. The image is preprocessed on the
+// calling thread and the model runs on the scheduler's workers, so an event
+// loop thread never waits for inference and can keep hundreds of requests
+// in flight.
+
+// Runs a completion on the thread the caller wants, usually by posting it to
+// the event loop. Without one it runs on the scheduler worker, where it must
+// be short: the next batch waits for it.
+using ResumeExecutor = std::function<void(std::function<void()> resume)>;
+
+void detectAsync(BatchScheduler &scheduler, const cv::Mat &image, float confidence_threshold, BatchScheduler::Callback done,
+                 BatchScheduler::Clock::time_point deadline = BatchScheduler::Clock::time_point::max(), ResumeExecutor executor = nullptr);
+
+#ifdef YOLOV10_HAS_COROUTINES
+
+// Awaitable returned by detectAsync in C++20 builds. co_await gives the
+// detections or rethrows the error, DeadlineExceeded for shed requests.
+class DetectAwaitable
+{
+public:
+    DetectAwaitable(BatchScheduler &scheduler, const cv::Mat &image, float confidence_threshold,
+                    BatchScheduler::Clock::time_point deadline, ResumeExecutor executor);
+
+    bool await_ready() const noexcept;
+    void await_suspend(std::coroutine_handle<> handle);
+    std::vector<Detection> await_resume();
+
+private:
+    BatchScheduler &scheduler;
+    // Shares the pixels, so the awaitable may be created before it is awaited
+    cv::Mat image;
+    float confidence_threshold;
+    BatchScheduler::Clock::time_point deadline;
+    ResumeExecutor executor;
+    std::vector<Detection> detections;
+    std::exception_ptr error;
+};
+
+DetectAwaitable detectAsync(BatchScheduler &scheduler, const cv::Mat &image, float confidence_threshold,
+                            BatchScheduler::Clock::time_point deadline = BatchScheduler::Clock::time_point::max(), ResumeExecutor executor = nullptr);
+
+#endif // YOLOV10_HAS_COROUTINES
+
+
+#endif // DETECT_ASYNC_H
@@ -0,0 +1,501 @@
+#include "detection_cache.h"
+#include "metrics/metrics.h"
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define YOLOV10_HAS_MMAP 1
+#endif
+
+namespace
+{
+    const int HASH_WIDTH = 9;
+    const int HASH_HEIGHT = 7;
+    // Brightness levels of the top byte of the hash
+    const int LUMA_LEVELS = 8;
+
+    Counter &lookupCounter(const char *result)
+    {
+        return MetricsRegistry::global().counter("yolov10_cache_lookups_total", "Detection cache lookups", std::string("result=\"") + result + "\"");
+    }
+
+    // 64-bit FNV-1a, stable from build to build unlike std::hash
+    uint64_t fnv1a(const void *data, size_t size, uint64_t hash = 0xcbf29ce484222325ULL)
+    {
+        const uint8_t *bytes = static_cast<const uint8_t *>(data);
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+        }
+        return hash;
+    }
+
+    uint64_t indexKey(uint64_t frame_hash, uint64_t context)
+    {
+        return frame_hash ^ (context * 0x9e3779b97f4a7c15ULL);
+    }
+
+    int hashDistance(uint64_t first, uint64_t second)
+    {
+        return static_cast<int>(std::bitset<64>(first ^ second).count());
+    }
+
+    uint64_t differenceHash(const cv::Mat &luma)
+    {
+        uint64_t hash = 0;
+        int sum = 0;
+        for (int y = 0; y < HASH_HEIGHT; ++y)
+        {
+            const uint8_t *row = luma.ptr<uint8_t>(y);
+            for (int x = 0; x < HASH_WIDTH; ++x)
+            {
+                sum += row[x];
+                if (x < HASH_WIDTH - 1)
+                {
+                    hash = (hash << 1) | (row[x] < row[x + 1] ? 1 : 0);
+                }
+            }
+        }
+
+        // The mean luma as a thermometer code: neighbouring levels differ in
+        // one bit, so it adds to the distance like any other bit
+        const int level = sum / (HASH_WIDTH * HASH_HEIGHT) * (LUMA_LEVELS + 1) / 256;
+        const uint64_t brightness = (uint64_t(1) << level) - 1;
+        return (brightness << (HASH_HEIGHT * (HASH_WIDTH - 1))) | hash;
+    }
+
+    std::vector<Detection> scaled(const std::vector<Detection> &detections, const cv::Size &from, const cv::Size &to)
+    {
+        if (from == to || from.width <= 0 || from.height <= 0)
+        {
+            return detections;
+        }
+
+        const double sx = static_cast<double>(to.width) / from.width;
+        const double sy = static_cast<double>(to.height) / from.height;
+        std::vector<Detection> result = detections;
+        for (Detection &detection : result)
+        {
+            const cv::Rect &box = detection.bbox;
+            detection.bbox = cv::Rect(static_cast<int>(std::round(box.x * sx)), static_cast<int>(std::round(box.y * sy)),
+                                      static_cast<int>(std::round(box.width * sx)), static_cast<int>(std::round(box.height * sy)));
+        }
+        return result;
+    }
+}
+
+/*
+ * Function to hash a BGR or grayscale frame for the detection cache
+ *
+ * @param image: frame
+ *
+ * @return: difference hash of the frame
+ */
+uint64_t frameHash(const cv::Mat &image)
+{
+    if (image.empty())
+    {
+        throw std::runtime_error("Cannot hash an empty image");
+    }
+
+    // Shrunk first, so only 63 pixels are converted to gray
+    cv::Mat small;
+    cv::resize(image, small, cv::Size(HASH_WIDTH, HASH_HEIGHT), 0, 0, cv::INTER_AREA);
+    cv::Mat luma;
+    if (small.channels() == 3)
+    {
+        cv::cvtColor(small, luma, cv::COLOR_BGR2GRAY);
+    }
+    else
+    {
+        luma = small;
+    }
+    return differenceHash(luma);
+}
+
+/*
+ * Function to hash a decoder frame for the detection cache, from its luma only
+ *
+ * @param frame: NV12, I420 or YUYV frame
+ *
+ * @return: difference hash of the frame
+ */
+uint64_t frameHash(const YuvFrame &frame)
+{
+    checkYuvFrame(frame);
+
+    cv::Mat small;
+    if (frame.format == PixelFormat::YUYV)
+    {
+        // Each Y0 U Y1 V group as one pixel, its first channel is luma enough
+        cv::Mat packed(frame.height, frame.width / 2, CV_8UC4, const_cast<uint8_t *>(frame.planes[0]), frame.strides[0]);
+        cv::Mat shrunk;
+        cv::resize(packed, shrunk, cv::Size(HASH_WIDTH, HASH_HEIGHT), 0, 0, cv::INTER_AREA);
+        cv::extractChannel(shrunk, small, 0);
+    }
+    else
+    {
+        cv::Mat luma(frame.height, frame.width, CV_8UC1, const_cast<uint8_t *>(frame.planes[0]), frame.strides[0]);
+        cv::resize(luma, small, cv::Size(HASH_WIDTH, HASH_HEIGHT), 0, 0, cv::INTER_AREA);
+    }
+    return differenceHash(small);
+}
+
+uint64_t cacheContext(const std::string &pipeline, float confidence_threshold)
+{
+    return fnv1a(&confidence_threshold, sizeof(confidence_threshold), fnv1a(pipeline.data(), pipeline.size()));
+}
+
+/*
+ * Function to identify a model file, so a retrained model written to the
+ * same path does not reuse the old model's detections
+ *
+ * @param model_path: path of the ONNX model
+ *
+ * @return: path, size and modification time as one string
+ */
+std::string modelIdentity(const std::string &model_path)
+{
+    std::error_code error;
+    const auto size = std::filesystem::file_size(model_path, error);
+    const auto modified = std::filesystem::last_write_time(model_path, error);
+    if (error)
+    {
+        return model_path;
+    }
+    return model_path + ":" + std::to_string(size) + ":" + std::to_string(modified.time_since_epoch().count());
+}
+
+// Fixed size slots in a memory mapped file, an open addressed table of
+// exact hashes. A frame with more detections than a slot holds is not
+// stored. One process writes the file at a time.
+class DetectionCache::Store
+{
+public:
+    static constexpr uint32_t MAGIC = 0x41434459; // "YDCA"
+    static constexpr uint32_t VERSION = 2;
+    static constexpr size_t DATA_OFFSET = 4096;
+    static constexpr uint32_t MAX_DETECTIONS = 32;
+    static constexpr uint32_t PROBES = 4;
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t slot_count;
+        uint32_t slot_size;
+    };
+
+    struct StoredDetection
+    {
+        int32_t class_id;
+        float confidence;
+        int32_t x;
+        int32_t y;
+        int32_t width;
+        int32_t height;
+        char class_name[24];
+    };
+
+    struct Slot
+    {
+        uint64_t frame_hash;
+        uint64_t context;
+        int32_t width;
+        int32_t height;
+        uint32_t count;
+        uint32_t used;
+        StoredDetection detections[MAX_DETECTIONS];
+    };
+
+    Store(const std::string &path, uint32_t slot_count)
+        : base(nullptr),
+          mapped_size(0),
+          slot_count(slot_count)
+    {
+#ifdef YOLOV10_HAS_MMAP
+        if (slot_count == 0)
+        {
+            throw std::runtime_error("Detection store needs at least one slot");
+        }
+
+        int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0)
+        {
+            throw std::runtime_error("Could not open the detection store " + path + ": " + std::strerror(errno));
+        }
+
+        struct stat info;
+        if (fstat(fd, &info) != 0)
+        {
+            close(fd);
+            throw std::runtime_error("Could not read the detection store " + path + ": " + std::strerror(errno));
+        }
+
+        // A new file is sized for the configured slots, an existing one keeps its own
+        const bool created = info.st_size == 0;
+        size_t size = created ? DATA_OFFSET + static_cast<size_t>(slot_count) * sizeof(Slot) : static_cast<size_t>(info.st_size);
+        if (created && ftruncate(fd, static_cast<off_t>(size)) != 0)
+        {
+            close(fd);
+            throw std::runtime_error("Could not size the detection store " + path + ": " + std::strerror(errno));
+        }
+
+        void *address = size >= DATA_OFFSET ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+        int error = errno;
+        close(fd);
+        if (address == MAP_FAILED)
+        {
+            throw std::runtime_error("Could not map the detection store " + path + (size < DATA_OFFSET ? "" : std::string(": ") + std::strerror(error)));
+        }
+        base = static_cast<uint8_t *>(address);
+        mapped_size = size;
+
+        Header *header = reinterpret_cast<Header *>(base);
+        if (created)
+        {
+            *header = {MAGIC, VERSION, slot_count, static_cast<uint32_t>(sizeof(Slot))};
+        }
+        else if (header->magic != MAGIC || header->version != VERSION || header->slot_size != sizeof(Slot) || header->slot_count == 0 ||
+                 header->slot_count > (mapped_size - DATA_OFFSET) / sizeof(Slot))
+        {
+            munmap(base, mapped_size);
+            throw std::runtime_error("File is not a detection store: " + path);
+        }
+        this->slot_count = header->slot_count;
+#else
+        (void)path;
+        throw std::runtime_error("The on-disk detection store needs mmap");
+#endif
+    }
+
+    ~Store()
+    {
+#ifdef YOLOV10_HAS_MMAP
+        munmap(base, mapped_size);
+#endif
+    }
+
+    bool lookup(uint64_t frame_hash, uint64_t context, Entry &entry) const
+    {
+        for (uint32_t probe = 0; probe < PROBES; ++probe)
+        {
+            const Slot &slot = slotFor(frame_hash, context, probe);
+            if (slot.used && slot.frame_hash == frame_hash && slot.context == context)
+            {
+                entry.frame_hash = frame_hash;
+                entry.context = context;
+                entry.frame_size = cv::Size(slot.width, slot.height);
+                entry.detections.clear();
+                for (uint32_t i = 0; i < std::min(slot.count, MAX_DETECTIONS); ++i)
+                {
+                    const StoredDetection &stored = slot.detections[i];
+                    entry.detections.push_back({stored.confidence, cv::Rect(stored.x, stored.y, stored.width, stored.height), stored.class_id,
+                                                std::string(stored.class_name, strnlen(stored.class_name, sizeof(stored.class_name)))});
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void insert(const Entry &entry)
+    {
+        if (entry.detections.size() > MAX_DETECTIONS)
+        {
+            return;
+        }
+
+        // A free or matching slot along the probe sequence, else the first one is overwritten
+        Slot *target = &slotFor(entry.frame_hash, entry.context, 0);
+        for (uint32_t probe = 0; probe < PROBES; ++probe)
+        {
+            Slot &slot = slotFor(entry.frame_hash, entry.context, probe);
+            if (!slot.used || (slot.frame_hash == entry.frame_hash && slot.context == entry.context))
+            {
+                target = &slot;
+                break;
+            }
+        }
+
+        target->used = 0;
+        target->frame_hash = entry.frame_hash;
+        target->context = entry.context;
+        target->width = entry.frame_size.width;
+        target->height = entry.frame_size.height;
+        target->count = static_cast<uint32_t>(entry.detections.size());
+        for (size_t i = 0; i < entry.detections.size(); ++i)
+        {
+            const Detection &detection = entry.detections[i];
+            StoredDetection &stored = target->detections[i];
+            stored = {detection.class_id, detection.confidence, detection.bbox.x, detection.bbox.y, detection.bbox.width, detection.bbox.height, {}};
+            std::strncpy(stored.class_name, detection.class_name.c_str(), sizeof(stored.class_name) - 1);
+        }
+        target->used = 1;
+    }
+
+private:
+    uint8_t *base;
+    size_t mapped_size;
+    uint32_t slot_count;
+
+    Slot &slotFor(uint64_t frame_hash, uint64_t context, uint32_t probe) const
+    {
+        const uint64_t home = indexKey(frame_hash, context) % slot_count;
+        return reinterpret_cast<Slot *>(base + DATA_OFFSET)[(home + probe) % slot_count];
+    }
+};
+
+DetectionCache::DetectionCache(const DetectionCacheConfig &config)
+    : config(config),
+      hit_count(0),
+      miss_count(0)
+{
+    if (config.capacity == 0)
+    {
+        throw std::runtime_error("Detection cache capacity must be at least 1");
+    }
+    if (!config.store_path.empty())
+    {
+        store = std::make_unique<Store>(config.store_path, config.store_slots);
+    }
+}
+
+DetectionCache::~DetectionCache() = default;
+
+/*
+ * Function to get the detections of a frame seen before
+ *
+ * @param frame_hash: frameHash of the frame
+ * @param context: cacheContext of the pipeline the detections would come from
+ * @param frame_size: size of the frame, the boxes are scaled to it
+ * @param detections: set to the cached detections on a hit
+ *
+ * @return: true on a hit
+ */
+bool DetectionCache::lookup(uint64_t frame_hash, uint64_t context, const cv::Size &frame_size, std::vector<Detection> &detections)
+{
+    static Counter &hits_total = lookupCounter("hit");
+    static Counter &misses_total = lookupCounter("miss");
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto entry = find(frame_hash, context);
+    if (entry == entries.end() && store)
+    {
+        Entry stored;
+        if (store->lookup(frame_hash, context, stored))
+        {
+            remember(std::move(stored));
+            entry = entries.begin();
+        }
+    }
+
+    if (entry == entries.end())
+    {
+        ++miss_count;
+        misses_total.increment();
+        return false;
+    }
+
+    // Most recently used first
+    entries.splice(entries.begin(), entries, entry);
+    detections = scaled(entry->detections, entry->frame_size, frame_size);
+    ++hit_count;
+    hits_total.increment();
+    return true;
+}
+
+/*
+ * Function to keep the detections of a frame for its next occurrence
+ *
+ * @param frame_hash: frameHash of the frame
+ * @param context: cacheContext of the pipeline the detections came from
+ * @param frame_size: size of the frame the boxes are in
+ * @param detections: detections of the frame
+ */
+void DetectionCache::insert(uint64_t frame_hash, uint64_t context, const cv::Size &frame_size, const std::vector<Detection> &detections)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry entry{frame_hash, context, frame_size, detections};
+    if (store)
+    {
+        store->insert(entry);
+    }
+    remember(std::move(entry));
+}
+
+uint64_t DetectionCache::hits() const
+{
+    return hit_count.load();
+}
+
+uint64_t DetectionCache::misses() const
+{
+    return miss_count.load();
+}
+
+size_t DetectionCache::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+std::list<DetectionCache::Entry>::iterator DetectionCache::find(uint64_t frame_hash, uint64_t context)
+{
+    auto exact = index.find(indexKey(frame_hash, context));
+    if (exact != index.end() && exact->second->frame_hash == frame_hash && exact->second->context == context)
+    {
+        return exact->second;
+    }
+    if (config.max_distance <= 0)
+    {
+        return entries.end();
+    }
+
+    // Closest near duplicate, a few thousand XORs at most
+    auto best = entries.end();
+    int best_distance = config.max_distance + 1;
+    for (auto it = entries.begin(); it != entries.end(); ++it)
+    {
+        if (it->context != context)
+        {
+            continue;
+        }
+        const int distance = hashDistance(it->frame_hash, frame_hash);
+        if (distance < best_distance)
+        {
+            best = it;
+            best_distance = distance;
+        }
+    }
+    return best;
+}
+
+void DetectionCache::remember(Entry entry)
+{
+    const uint64_t key = indexKey(entry.frame_hash, entry.context);
+    auto existing = index.find(key);
+    if (existing != index.end())
+    {
+        entries.erase(existing->second);
+        index.erase(existing);
+    }
+
+    entries.push_front(std::move(entry));
+    index[key] = entries.begin();
+
+    if (entries.size() > config.capacity)
+    {
+        index.erase(indexKey(entries.back().frame_hash, entries.back().context));
+        entries.pop_back();
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef DETECTION_CACHE_H
+#define DETECTION_CACHE_H
+
+#include "inference.h"
+#include "preprocess.h"
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct DetectionCacheConfig
+{
+    // Entries kept in memory, the least recently used goes first
+    size_t capacity = 4096;
+
+    // Frames whose hashes differ in at most this many of their 64 bits share
+    // their detections, 0 for exact duplicates only. Above 0 a miss scans
+    // the memory entries; the disk store only serves exact hashes.
+    int max_distance = 0;
+
+    // File of the on-disk store, kept across runs; empty for memory only
+    std::string store_path;
+    uint32_t store_slots = 1 << 14;
+};
+
+// 64-bit hash of the frame's luma at 9x7: 56 bits compare neighbouring
+// pixels along each row (a difference hash), the top 8 hold the mean
+// brightness in 9 levels so flat frames of different brightness do not
+// collide. It survives re-encoding and rescaling but not crops.
+uint64_t frameHash(const cv::Mat &image);
+uint64_t frameHash(const YuvFrame &frame);
+
+// Everything besides the pixels that the detections depend on, hashed the
+// same way in every process so the disk store stays valid across runs
+uint64_t cacheContext(const std::string &pipeline, float confidence_threshold);
+// Path, size and modification time of a model file
+std::string modelIdentity(const std::string &model_path);
+
+
+// Detections of frames seen before, keyed by frame hash and context, so a
+// repeated frame does not go through the model again. Boxes are scaled to
+// the size of the frame looked up, as a re-upload may have been resized.
+class DetectionCache
+{
+public:
+    explicit DetectionCache(const DetectionCacheConfig &config = DetectionCacheConfig());
+    ~DetectionCache();
+
+    DetectionCache(const DetectionCache &) = delete;
+    DetectionCache &operator=(const DetectionCache &) = delete;
+
+    bool lookup(uint64_t frame_hash, uint64_t context, const cv::Size &frame_size, std::vector<Detection> &detections);
+    void insert(uint64_t frame_hash, uint64_t context, const cv::Size &frame_size, const std::vector<Detection> &detections);
+
+    uint64_t hits() const;
+    uint64_t misses() const;
+    size_t size() const;
+
+private:
+    struct Entry
+    {
+        uint64_t frame_hash;
+        uint64_t context;
+        cv::Size frame_size;
+        std::vector<Detection> detections;
+    };
+
+    class Store;
+
+    DetectionCacheConfig config;
+    mutable std::mutex mutex;
+    std::list<Entry> entries;
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+    std::unique_ptr<Store> store;
+    std::atomic<uint64_t> hit_count;
+    std::atomic<uint64_t> miss_count;
+
+    std::list<Entry>::iterator find(uint64_t frame_hash, uint64_t context);
+    void remember(Entry entry);
+};
+
+
+#endif // DETECTION_CACHE_H
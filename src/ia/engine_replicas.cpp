@@ -0,0 +1,194 @@
+#include "engine_replicas.h"
+#include <algorithm>
+#include <exception>
+#include <thread>
+
+EngineReplicas::EngineReplicas(const std::string &model_path, const EngineConfig &engine_config, const BatchConfig &batch_config, const CpuTopology &topology)
+    : next_replica(0)
+{
+    if (topology.empty())
+    {
+        replicas.resize(1);
+        replicas[0].engine = std::make_unique<InferenceEngine>(model_path, engine_config);
+        replicas[0].scheduler = std::make_unique<BatchScheduler>(*replicas[0].engine, batch_config);
+        return;
+    }
+
+    // Build the replicas in parallel, each from a thread placed on its node
+    const std::vector<NumaNode> &nodes = topology.nodes();
+    replicas.resize(nodes.size());
+    std::vector<std::exception_ptr> errors(nodes.size());
+    std::vector<std::thread> builders;
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        builders.emplace_back([&, i]
+                              {
+                                  const NumaNode &node = nodes[i];
+                                  try
+                                  {
+                                      pinCurrentThread(node.cpus);
+                                      preferNodeMemory(node.id);
+
+                                      EngineConfig replica_engine_config = engine_config;
+                                      replica_engine_config.cpus = node.cpus;
+                                      if (replica_engine_config.intra_op_threads <= 0)
+                                      {
+                                          replica_engine_config.intra_op_threads = static_cast<int>(node.cpus.size());
+                                      }
+                                      if (!replica_engine_config.profile_prefix.empty())
+                                      {
+                                          replica_engine_config.profile_prefix += ".node" + std::to_string(node.id);
+                                      }
+
+                                      BatchConfig replica_batch_config = batch_config;
+                                      replica_batch_config.cpus = node.cpus;
+
+                                      replicas[i].node = node;
+                                      replicas[i].engine = std::make_unique<InferenceEngine>(model_path, replica_engine_config);
+                                      replicas[i].scheduler = std::make_unique<BatchScheduler>(*replicas[i].engine, replica_batch_config);
+                                  }
+                                  catch (...)
+                                  {
+                                      errors[i] = std::current_exception();
+                                  } });
+    }
+    for (auto &builder : builders)
+    {
+        builder.join();
+    }
+
+    for (const auto &error : errors)
+    {
+        if (error)
+        {
+            stop();
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+EngineReplicas::~EngineReplicas()
+{
+    stop();
+}
+
+size_t EngineReplicas::size() const
+{
+    return replicas.size();
+}
+
+InferenceEngine &EngineReplicas::engine(size_t index)
+{
+    return *replicas.at(index).engine;
+}
+
+BatchScheduler &EngineReplicas::scheduler(size_t index)
+{
+    return *replicas.at(index).scheduler;
+}
+
+/*
+ * Function to pick the replica for the next request or client
+ *
+ * @return: index of the replica, round robin
+ */
+size_t EngineReplicas::nextIndex()
+{
+    return next_replica.fetch_add(1, std::memory_order_relaxed) % replicas.size();
+}
+
+BatchScheduler &EngineReplicas::next()
+{
+    return scheduler(nextIndex());
+}
+
+/*
+ * Function to check whether every replica finished its warm-up
+ *
+ * @return: true once all engines are ready
+ */
+bool EngineReplicas::ready() const
+{
+    for (const auto &replica : replicas)
+    {
+        if (!replica.engine || !replica.engine->ready())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Function to get the longest warm-up of the replicas
+ *
+ * @return: warm-up time of the slowest replica, they warm up in parallel
+ */
+std::chrono::milliseconds EngineReplicas::warmupDuration() const
+{
+    std::chrono::milliseconds longest(0);
+    for (const auto &replica : replicas)
+    {
+        longest = std::max(longest, replica.engine->warmupDuration());
+    }
+    return longest;
+}
+
+/*
+ * Function to swap a new model file into every replica
+ *
+ * Each replica loads and warms its copy from a thread placed on its node,
+ * all of them in parallel, while requests keep being served.
+ *
+ * @param model_path: ONNX file to load
+ */
+void EngineReplicas::reload(const std::string &model_path)
+{
+    std::vector<std::exception_ptr> errors(replicas.size());
+    std::vector<std::thread> loaders;
+    for (size_t i = 0; i < replicas.size(); ++i)
+    {
+        loaders.emplace_back([&, i]
+                             {
+                                 try
+                                 {
+                                     // Load the new weights on the node that serves them
+                                     if (replicas[i].node.id >= 0)
+                                     {
+                                         pinCurrentThread(replicas[i].node.cpus);
+                                         preferNodeMemory(replicas[i].node.id);
+                                     }
+                                     replicas[i].engine->reload(model_path);
+                                 }
+                                 catch (...)
+                                 {
+                                     errors[i] = std::current_exception();
+                                 } });
+    }
+    for (auto &loader : loaders)
+    {
+        loader.join();
+    }
+
+    for (const auto &error : errors)
+    {
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+/*
+ * Function to finish the queued requests of every replica
+ */
+void EngineReplicas::stop()
+{
+    for (auto &replica : replicas)
+    {
+        if (replica.scheduler)
+        {
+            replica.scheduler->stop();
+        }
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef ENGINE_REPLICAS_H
+#define ENGINE_REPLICAS_H
+
+#include "batch_scheduler.h"
+#include "inference.h"
+#include "system/cpu_topology.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+// One engine and batch scheduler per NUMA node. Each replica is built on a
+// thread pinned to its node with node-local memory preferred, so the model
+// weights, the ONNX Runtime pool and the scheduler workers stay on that
+// node. Requests are spread over the replicas round robin. An empty topology
+// gives a single replica without any placement.
+class EngineReplicas
+{
+public:
+    EngineReplicas(const std::string &model_path, const EngineConfig &engine_config, const BatchConfig &batch_config, const CpuTopology &topology = CpuTopology());
+    ~EngineReplicas();
+
+    size_t size() const;
+    InferenceEngine &engine(size_t index);
+    BatchScheduler &scheduler(size_t index);
+    size_t nextIndex();
+    BatchScheduler &next();
+    bool ready() const;
+    std::chrono::milliseconds warmupDuration() const;
+    void reload(const std::string &model_path);
+    void stop();
+
+private:
+    struct Replica
+    {
+        std::unique_ptr<InferenceEngine> engine;
+        std::unique_ptr<BatchScheduler> scheduler;
+        NumaNode node{-1, {}};
+    };
+
+    std::vector<Replica> replicas;
+    std::atomic<size_t> next_replica;
+};
+
+
+#endif // ENGINE_REPLICAS_H
@@ -1,5 +1,9 @@
 #include "inference.h"
+#include "metrics/metrics.h"
+#include "metrics/trace.h"
 #include <algorithm>
+#include <array>
+#include <fstream>
 #include <iostream>
 
 const std::vector<std::string> InferenceEngine::CLASS_NAMES = {
@@ -13,49 +17,215 @@ const std::vector<std::string> InferenceEngine::CLASS_NAMES = {
     "cell phone", "microwave", "oven", "toaster", "sink", "refrigerator", "book", "clock", "vase",
     "scissors", "teddy bear", "hair drier", "toothbrush"};
 
-InferenceEngine::InferenceEngine(const std::string &model_path)
-    : env(ORT_LOGGING_LEVEL_WARNING, "ONNXRuntime"),
-      session_options(),
-      session(env, model_path.c_str(), session_options),
-      input_shape{1, 3, 640, 640}
+InferenceEngine::InferenceEngine(const std::string &model_path, const EngineConfig &config)
+    : InferenceEngine(std::make_shared<Ort::Env>(ORT_LOGGING_LEVEL_WARNING, "ONNXRuntime"), model_path, config)
 {
-    session_options.SetIntraOpNumThreads(1);
-    session_options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_BASIC);
+}
+
+/*
+ * Function to create an engine on an environment shared with other engines
+ *
+ * @param env: ONNX Runtime environment, kept alive by the engine
+ * @param model_path: path to the ONNX file
+ * @param config: engine configuration
+ */
+InferenceEngine::InferenceEngine(std::shared_ptr<Ort::Env> env, const std::string &model_path, const EngineConfig &config)
+    : input_shape{1, 3, 640, 640},
+      engine_config(config),
+      env(std::move(env)),
+      session_options(createSessionOptions(config)),
+      model(std::make_unique<Model>(*this->env, model_path, session_options)),
+      class_names(config.class_names.empty() ? CLASS_NAMES : config.class_names),
+      dynamic_batch(false),
+      memory_info(Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault)),
+      is_ready(false),
+      warmup_milliseconds(0),
+      model_generation(1)
+{
+    auto current = model.read();
+
+    // Take the input resolution from the model when it is fixed
+    const std::vector<int64_t> &model_shape = current->input_dims;
+    if (model_shape.size() == 4)
+    {
+        dynamic_batch = model_shape[0] < 0;
+        for (int i = 2; i < 4; ++i)
+        {
+            if (model_shape[i] > 0)
+            {
+                input_shape[i] = model_shape[i];
+            }
+        }
+    }
+
+    if (config.warmup_iterations > 0)
+    {
+        warmup_milliseconds = warmUp(*current).count();
+    }
+    is_ready = true;
+}
+
+/*
+ * Function to open a model file
+ *
+ * @param env: ONNX Runtime environment, must outlive the model
+ * @param model_path: path to the ONNX file
+ * @param options: session options shared by every model of the engine
+ */
+InferenceEngine::Model::Model(Ort::Env &env, const std::string &model_path, const Ort::SessionOptions &options)
+    : session(env, model_path.c_str(), options),
+      path(model_path)
+{
+    Ort::AllocatorWithDefaultOptions allocator;
+    input_name = session.GetInputNameAllocated(0, allocator).get();
+    output_name = session.GetOutputNameAllocated(0, allocator).get();
+    input_dims = session.GetInputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+
+    // With a fully known output shape the results are written straight into the caller's buffer
+    std::vector<int64_t> model_output_shape = session.GetOutputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+    if (!model_output_shape.empty())
+    {
+        model_output_shape[0] = 1;
+        if (std::all_of(model_output_shape.begin(), model_output_shape.end(), [](int64_t dim)
+                        { return dim > 0; }))
+        {
+            output_shape = model_output_shape;
+        }
+    }
 }
 
 InferenceEngine::~InferenceEngine() {}
 
+/*
+ * Function to build the session options
+ *
+ * The options have to be complete before the session is created, since the
+ * session copies them.
+ *
+ * @param config: engine configuration
+ *
+ * @return: session options for the engine
+ */
+Ort::SessionOptions InferenceEngine::createSessionOptions(const EngineConfig &config)
+{
+    Ort::SessionOptions options;
+    options.SetGraphOptimizationLevel(config.optimization_level);
+    if (config.shared_thread_pool)
+    {
+        options.DisablePerSessionThreads();
+    }
+    else
+    {
+        options.SetIntraOpNumThreads(config.intra_op_threads);
+    }
+    if (!config.shared_thread_pool && !config.cpus.empty() && config.intra_op_threads > 1)
+    {
+        // One entry per pool thread, the calling thread is the first member of the pool.
+        // ONNX Runtime numbers logical processors from 1.
+        std::string affinities;
+        for (int i = 1; i < config.intra_op_threads; ++i)
+        {
+            affinities += (i > 1 ? ";" : "") + std::to_string(config.cpus[i % config.cpus.size()] + 1);
+        }
+        options.AddConfigEntry("session.intra_op_thread_affinities", affinities.c_str());
+    }
+    if (!config.profile_prefix.empty())
+    {
+        options.EnableProfiling(config.profile_prefix.c_str());
+    }
+
+    return options;
+}
+
 /*
  * Function to preprocess the image
  *
- * @param image_path: path to the image
- * @param orig_width: original width of the image
- * @param orig_height: original height of the image
+ * @param image: input image
  *
  * @return: vector of floats representing the preprocessed image
  */
 std::vector<float> InferenceEngine::preprocessImage(const cv::Mat &image)
 {
-    if (image.empty())
-    {
-        throw std::runtime_error("Could not read the image");
-    }
+    static Histogram &preprocess_seconds = stageHistogram("preprocess");
+    ScopedTimer timer(preprocess_seconds, "preprocess");
 
-    cv::Mat resized_image;
-    cv::resize(image, resized_image, cv::Size(input_shape[2], input_shape[3]));
+    return preprocessStretch(image, inputSize());
+}
 
-    resized_image.convertTo(resized_image, CV_32F, 1.0 / 255);
+/*
+ * Function to preprocess the image into an existing tensor
+ *
+ * @param image: input image
+ * @param input_tensor_values: filled with the preprocessed image, its capacity is reused
+ */
+void InferenceEngine::preprocessImage(const cv::Mat &image, std::vector<float> &input_tensor_values)
+{
+    static Histogram &preprocess_seconds = stageHistogram("preprocess");
+    ScopedTimer timer(preprocess_seconds, "preprocess");
 
-    std::vector<cv::Mat> channels(3);
-    cv::split(resized_image, channels);
+    preprocessStretch(image, inputSize(), input_tensor_values);
+}
 
-    std::vector<float> input_tensor_values;
-    for (int c = 0; c < 3; ++c)
-    {
-        input_tensor_values.insert(input_tensor_values.end(), (float *)channels[c].data, (float *)channels[c].data + input_shape[2] * input_shape[3]);
-    }
+/*
+ * Function to preprocess the image at a given network resolution
+ *
+ * @param image: input image
+ * @param input_size: resolution to stretch the image to, see supportsInputSize
+ * @param input_tensor_values: filled with the preprocessed image, its capacity is reused
+ */
+void InferenceEngine::preprocessImage(const cv::Mat &image, const cv::Size &input_size, std::vector<float> &input_tensor_values)
+{
+    static Histogram &preprocess_seconds = stageHistogram("preprocess");
+    ScopedTimer timer(preprocess_seconds, "preprocess");
 
-    return input_tensor_values;
+    preprocessStretch(image, input_size, input_tensor_values);
+}
+
+/*
+ * Function to preprocess a decoded YUV frame without converting it to BGR first
+ *
+ * @param frame: NV12, I420 or YUYV frame, only read during this call
+ * @param input_tensor_values: filled with the preprocessed frame, its capacity is reused
+ */
+void InferenceEngine::preprocessImage(const YuvFrame &frame, std::vector<float> &input_tensor_values)
+{
+    static Histogram &preprocess_seconds = stageHistogram("preprocess");
+    ScopedTimer timer(preprocess_seconds, "preprocess");
+
+    preprocessYuv(frame, inputSize(), input_tensor_values);
+}
+
+/*
+ * Function to preprocess a region of the image
+ *
+ * @param image: input image
+ * @param region: region of the image to feed to the network
+ * @param transform: filled with the mapping needed to project detections back
+ *
+ * @return: vector of floats representing the preprocessed region
+ */
+std::vector<float> InferenceEngine::preprocessRegion(const cv::Mat &image, const cv::Rect &region, LetterboxTransform &transform)
+{
+    static Histogram &preprocess_seconds = stageHistogram("preprocess");
+    ScopedTimer timer(preprocess_seconds, "preprocess");
+
+    return preprocessLetterbox(image, region, inputSize(), transform);
+}
+
+/*
+ * Function to preprocess a region of the image into an existing tensor
+ *
+ * @param image: input image
+ * @param region: region of the image to feed to the network
+ * @param transform: filled with the mapping needed to project detections back
+ * @param input_tensor_values: filled with the preprocessed region, its capacity is reused
+ */
+void InferenceEngine::preprocessRegion(const cv::Mat &image, const cv::Rect &region, LetterboxTransform &transform, std::vector<float> &input_tensor_values)
+{
+    static Histogram &preprocess_seconds = stageHistogram("preprocess");
+    ScopedTimer timer(preprocess_seconds, "preprocess");
+
+    preprocessLetterbox(image, region, inputSize(), transform, input_tensor_values);
 }
 
 /*
@@ -73,36 +243,57 @@ std::vector<float> InferenceEngine::preprocessImage(const cv::Mat &image)
 */
 std::vector<Detection> InferenceEngine::filterDetections(const std::vector<float> &results, float confidence_threshold, int img_width, int img_height, int orig_width, int orig_height)
 {
-    std::vector<Detection> detections;
-    const int num_detections = results.size() / 6;
+    static Histogram &filter_seconds = stageHistogram("filter");
+    ScopedTimer timer(filter_seconds, "filter");
 
-    for (int i = 0; i < num_detections; ++i)
-    {
-        float left = results[i * 6 + 0];
-        float top = results[i * 6 + 1];
-        float right = results[i * 6 + 2];
-        float bottom = results[i * 6 + 3];
-        float confidence = results[i * 6 + 4];
-        int class_id = results[i * 6 + 5];
+    return decodeDetections(results, confidence_threshold, img_width, img_height, orig_width, orig_height, class_names);
+}
 
-        if (confidence >= confidence_threshold)
-        {
-            int x = static_cast<int>(left * orig_width / img_width);
-            int y = static_cast<int>(top * orig_height / img_height);
-            int width = static_cast<int>((right - left) * orig_width / img_width);
-            int height = static_cast<int>((bottom - top) * orig_height / img_height);
-
-            detections.push_back(
-                {confidence,
-                 cv::Rect(x, y, width, height),
-                 class_id,
-                 CLASS_NAMES[class_id]});
-        }
-    }
+/*
+    * Function to filter the detections of a letterboxed region
+    *
+    * @param results: vector of floats representing the output tensor
+    * @param confidence_threshold: minimum confidence threshold
+    * @param transform: letterbox mapping returned by preprocessRegion
+    *
+    * @return: vector of Detection objects in frame coordinates
+
+*/
+std::vector<Detection> InferenceEngine::filterDetections(const std::vector<float> &results, float confidence_threshold, const LetterboxTransform &transform)
+{
+    static Histogram &filter_seconds = stageHistogram("filter");
+    ScopedTimer timer(filter_seconds, "filter");
+
+    return decodeDetections(results, confidence_threshold, transform, class_names);
+}
 
-    return detections;
+/*
+    * Function to get the network input size
+    *
+    * @return: width and height expected by the model
+*/
+cv::Size InferenceEngine::inputSize() const
+{
+    return cv::Size(static_cast<int>(input_shape[3]), static_cast<int>(input_shape[2]));
 }
 
+/*
+    * Function to check whether the model accepts a network resolution
+    *
+    * @param input_size: width and height of the input tensor
+    *
+    * @return: true if the model has that size or was exported with dynamic height and width
+*/
+bool InferenceEngine::supportsInputSize(const cv::Size &input_size) const
+{
+    auto current = model.read();
+    const std::vector<int64_t> &dims = current->input_dims;
+    if (dims.size() != 4)
+    {
+        return input_size == inputSize();
+    }
+    return (dims[2] < 0 || dims[2] == input_size.height) && (dims[3] < 0 || dims[3] == input_size.width);
+}
 
 /*
     * Function to run inference
@@ -113,88 +304,385 @@ std::vector<Detection> InferenceEngine::filterDetections(const std::vector<float
 */
 std::vector<float> InferenceEngine::runInference(const std::vector<float> &input_tensor_values)
 {
-    Ort::AllocatorWithDefaultOptions allocator;
+    std::vector<float> output_tensor_values;
+    runInference(input_tensor_values, output_tensor_values);
+    return output_tensor_values;
+}
 
-    std::string input_name = getInputName();
-    std::string output_name = getOutputName();
+/*
+    * Function to run inference into an existing output buffer
+    *
+    * When the model output shape is fully known the session writes straight
+    * into output_tensor_values, so a caller reusing its buffers does not
+    * allocate per frame.
+    *
+    * @param input_tensor_values: vector of floats representing the input tensor
+    * @param output_tensor_values: filled with the output tensor, its capacity is reused
+*/
+void InferenceEngine::runInference(const std::vector<float> &input_tensor_values, std::vector<float> &output_tensor_values)
+{
+    runInference(input_tensor_values, inputSize(), output_tensor_values);
+}
 
-    const char *input_name_ptr = input_name.c_str();
-    const char *output_name_ptr = output_name.c_str();
+/*
+    * Function to run inference at a given network resolution
+    *
+    * Models with dynamic height and width plan their memory once per input
+    * shape, so every resolution in use should be part of the warm-up.
+    *
+    * @param input_tensor_values: image preprocessed at input_size
+    * @param input_size: width and height of the input tensor
+    * @param output_tensor_values: filled with the output tensor, its capacity is reused
+*/
+void InferenceEngine::runInference(const std::vector<float> &input_tensor_values, const cv::Size &input_size, std::vector<float> &output_tensor_values)
+{
+    static Histogram &inference_seconds = stageHistogram("inference");
+    static Counter &allocations = bufferAllocations();
+    ScopedTimer timer(inference_seconds, "inference");
+
+    // Pins the current model until the run is over, a concurrent reload waits for it
+    auto current = model.read();
+    const char *input_name_ptr = current->input_name.c_str();
+    const char *output_name_ptr = current->output_name.c_str();
+    const std::vector<int64_t> &output_shape = current->output_shape;
+
+    const std::array<int64_t, 4> shape = {1, input_shape[1], input_size.height, input_size.width};
+    if (input_tensor_values.size() != static_cast<size_t>(shape[1] * shape[2] * shape[3]))
+    {
+        throw std::runtime_error("Input tensor does not hold one " + std::to_string(input_size.width) + "x" + std::to_string(input_size.height) + " image");
+    }
+    Ort::Value input_tensor = Ort::Value::CreateTensor<float>(memory_info, const_cast<float *>(input_tensor_values.data()), input_tensor_values.size(), shape.data(), shape.size());
+
+    if (!output_shape.empty())
+    {
+        size_t output_tensor_size = 1;
+        for (int64_t dim : output_shape)
+        {
+            output_tensor_size *= static_cast<size_t>(dim);
+        }
+        if (output_tensor_values.capacity() < output_tensor_size)
+        {
+            allocations.increment();
+        }
+        output_tensor_values.resize(output_tensor_size);
 
-    Ort::MemoryInfo memory_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
-    Ort::Value input_tensor = Ort::Value::CreateTensor<float>(memory_info, const_cast<float *>(input_tensor_values.data()), input_tensor_values.size(), input_shape.data(), input_shape.size());
+        Ort::Value output_tensor = Ort::Value::CreateTensor<float>(memory_info, output_tensor_values.data(), output_tensor_values.size(), output_shape.data(), output_shape.size());
+        current->session.Run(Ort::RunOptions{nullptr}, &input_name_ptr, &input_tensor, 1, &output_name_ptr, &output_tensor, 1);
+        return;
+    }
 
-    auto output_tensors = session.Run(Ort::RunOptions{nullptr}, &input_name_ptr, &input_tensor, 1, &output_name_ptr, 1);
+    auto output_tensors = current->session.Run(Ort::RunOptions{nullptr}, &input_name_ptr, &input_tensor, 1, &output_name_ptr, 1);
 
     float *floatarr = output_tensors[0].GetTensorMutableData<float>();
     size_t output_tensor_size = output_tensors[0].GetTensorTypeAndShapeInfo().GetElementCount();
 
-    return std::vector<float>(floatarr, floatarr + output_tensor_size);
+    if (output_tensor_values.capacity() < output_tensor_size)
+    {
+        allocations.increment();
+    }
+    output_tensor_values.assign(floatarr, floatarr + output_tensor_size);
+}
+
+/*
+    * Function to run inference on several images at once
+    *
+    * Models exported with a dynamic batch dimension run the whole batch in a
+    * single call; fixed batch models fall back to one call per image.
+    *
+    * @param input_tensor_values: preprocessed images concatenated in NCHW order
+    * @param batch_size: number of images in the tensor
+    *
+    * @return: one output tensor per image
+*/
+std::vector<std::vector<float>> InferenceEngine::runInferenceBatch(const std::vector<float> &input_tensor_values, size_t batch_size)
+{
+    const size_t image_size = static_cast<size_t>(input_shape[1] * input_shape[2] * input_shape[3]);
+    if (batch_size == 0 || input_tensor_values.size() != image_size * batch_size)
+    {
+        throw std::runtime_error("Input tensor does not match the batch size");
+    }
+
+    std::vector<std::vector<float>> outputs;
+    outputs.reserve(batch_size);
+
+    if (!dynamic_batch || batch_size == 1)
+    {
+        std::vector<float> single(image_size);
+        for (size_t b = 0; b < batch_size; ++b)
+        {
+            std::copy(input_tensor_values.begin() + b * image_size, input_tensor_values.begin() + (b + 1) * image_size, single.begin());
+            outputs.push_back(runInference(single));
+        }
+        return outputs;
+    }
+
+    static Histogram &inference_seconds = stageHistogram("inference");
+    static Counter &allocations = bufferAllocations();
+    ScopedTimer timer(inference_seconds, "inference");
+
+    auto current = model.read();
+    const char *input_name_ptr = current->input_name.c_str();
+    const char *output_name_ptr = current->output_name.c_str();
+
+    std::vector<int64_t> batch_shape = input_shape;
+    batch_shape[0] = static_cast<int64_t>(batch_size);
+
+    Ort::Value input_tensor = Ort::Value::CreateTensor<float>(memory_info, const_cast<float *>(input_tensor_values.data()), input_tensor_values.size(), batch_shape.data(), batch_shape.size());
+
+    auto output_tensors = current->session.Run(Ort::RunOptions{nullptr}, &input_name_ptr, &input_tensor, 1, &output_name_ptr, 1);
+
+    float *floatarr = output_tensors[0].GetTensorMutableData<float>();
+    const size_t per_image = output_tensors[0].GetTensorTypeAndShapeInfo().GetElementCount() / batch_size;
+    for (size_t b = 0; b < batch_size; ++b)
+    {
+        outputs.emplace_back(floatarr + b * per_image, floatarr + (b + 1) * per_image);
+    }
+    allocations.increment(batch_size);
+
+    return outputs;
 }
 
 /*
-    * Function to draw the labels on the image
+    * Function to stop the ONNX Runtime profiler enabled with profile_prefix
     *
-    * @param image: input image
-    * @param detections: vector of Detection objects
+    * @return: path of the JSON profile written by ONNX Runtime
+*/
+std::string InferenceEngine::endProfiling()
+{
+    Ort::AllocatorWithDefaultOptions allocator;
+    Ort::AllocatedStringPtr profile_path = model.read()->session.EndProfilingAllocated(allocator);
+    return std::string(profile_path.get());
+}
+
+/*
+    * Function to get when the ONNX Runtime profiler started
     *
-    * @return: image with labels drawn
+    * @return: nanoseconds since the epoch, used to align the profile with the pipeline trace
+*/
+uint64_t InferenceEngine::profilingStartNs() const
+{
+    return model.read()->session.GetProfilingStartTimeNs();
+}
 
+/*
+    * Function to check whether the engine finished its warm-up
+    *
+    * @return: true once the engine can serve requests at steady state latency
 */
-cv::Mat InferenceEngine::draw_labels(const cv::Mat &image, const std::vector<Detection> &detections)
+bool InferenceEngine::ready() const
 {
-    cv::Mat result = image.clone();
+    return is_ready;
+}
 
-    for (const auto &detection : detections)
+/*
+    * Function to get how long the warm-up took
+    *
+    * @return: wall time of the warm-up runs, zero if there were none
+*/
+std::chrono::milliseconds InferenceEngine::warmupDuration() const
+{
+    return std::chrono::milliseconds(warmup_milliseconds.load());
+}
+
+/*
+    * Function to swap in a new model file without stopping the engine
+    *
+    * The new session is created and warmed up on the calling thread while
+    * requests keep running on the current one. It is then published with
+    * an RCU pointer: requests never wait for the swap, the ones in flight
+    * finish on the old session, and the old session is destroyed once the
+    * last of them is done. The new model must keep the input contract of
+    * the engine, since callers preprocess for it.
+    *
+    * @param model_path: ONNX file to load, may be the current path rewritten in place
+*/
+void InferenceEngine::reload(const std::string &model_path)
+{
+    std::lock_guard<std::mutex> lock(reload_mutex);
+    TraceScope scope("reload");
+
+    auto next = std::make_unique<Model>(*env, model_path, session_options);
+
+    const std::vector<int64_t> &dims = next->input_dims;
+    if (dims.size() != 4 || (dims[0] < 0) != dynamic_batch ||
+        (dims[1] > 0 && dims[1] != input_shape[1]) || (dims[2] > 0 && dims[2] != input_shape[2]) || (dims[3] > 0 && dims[3] != input_shape[3]))
+    {
+        throw std::runtime_error("Model " + model_path + " does not have the input shape of the running model");
+    }
+
+    if (engine_config.warmup_iterations > 0)
     {
-        cv::rectangle(result, detection.bbox, cv::Scalar(0, 255, 0), 2);
-        std::string label = detection.class_name + ": " + std::to_string(detection.confidence);
+        warmup_milliseconds = warmUp(*next).count();
+    }
+
+    std::unique_ptr<Model> previous = model.exchange(std::move(next));
+    model_generation.fetch_add(1);
 
-        int baseLine;
-        cv::Size labelSize = cv::getTextSize(label, cv::FONT_HERSHEY_SIMPLEX, 0.5, 1, &baseLine);
+    static Counter &reloads = MetricsRegistry::global().counter("yolov10_model_reloads_total", "Models swapped in without a restart");
+    reloads.increment();
+}
 
-        cv::rectangle(
-            result,
-            cv::Point(detection.bbox.x, detection.bbox.y - labelSize.height),
-            cv::Point(detection.bbox.x + labelSize.width, detection.bbox.y + baseLine),
-            cv::Scalar(255, 255, 255),
-            cv::FILLED);
+/*
+    * Function to get the file of the model serving new requests
+    *
+    * @return: path passed to the constructor or to the last reload
+*/
+std::string InferenceEngine::modelPath() const
+{
+    return model.read()->path;
+}
 
-        cv::putText(
-            result,
-            label,
-            cv::Point(
-                detection.bbox.x,
-                detection.bbox.y),
-            cv::FONT_HERSHEY_SIMPLEX,
-            0.5,
-            cv::Scalar(0, 0, 0),
-            1);
+/*
+    * Function to get how many models the engine has served
+    *
+    * @return: 1 for the model given to the constructor, incremented by every reload
+*/
+uint64_t InferenceEngine::generation() const
+{
+    return model_generation.load();
+}
+
+/*
+    * Function to check whether the model accepts more than one image per run
+    *
+    * @return: true if the batch dimension of the model is dynamic
+*/
+bool InferenceEngine::supportsBatching() const
+{
+    return dynamic_batch;
+}
+
+const std::vector<std::string> &InferenceEngine::classNames() const
+{
+    return class_names;
+}
+
+/*
+ * Function to read a label map
+ *
+ * @param path: text file with one class name per line, in class id order
+ *
+ * @return: names indexed by class id
+ */
+std::vector<std::string> loadClassNames(const std::string &path)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        throw std::runtime_error("Could not open the label map: " + path);
+    }
+
+    std::vector<std::string> names;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+        names.push_back(line);
+    }
+    while (!names.empty() && names.back().empty())
+    {
+        names.pop_back();
+    }
+    if (names.empty())
+    {
+        throw std::runtime_error("Label map is empty: " + path);
     }
 
+    return names;
+}
+
+/*
+    * Function to draw the labels on a copy of the image
+    *
+    * @param image: input image
+    * @param detections: vector of Detection objects
+    *
+    * @return: image with labels drawn
+
+*/
+cv::Mat InferenceEngine::draw_labels(const cv::Mat &image, const std::vector<Detection> &detections)
+{
+    cv::Mat result = image.clone();
+    drawLabels(result, detections);
+
     return result;
 }
 
 /*
-    * Function to get the input name
+    * Function to draw the labels on the image in place
     *
-    * @return: name of the input tensor
+    * @param image: image to annotate, usually the frame that was just processed
+    * @param detections: vector of Detection objects
+
 */
-std::string InferenceEngine::getInputName()
+void InferenceEngine::drawLabels(cv::Mat &image, const std::vector<Detection> &detections)
 {
-    Ort::AllocatorWithDefaultOptions allocator;
-    Ort::AllocatedStringPtr name_allocator = session.GetInputNameAllocated(0, allocator);
-    return std::string(name_allocator.get());
+    static Histogram &draw_seconds = stageHistogram("draw");
+    ScopedTimer timer(draw_seconds, "draw");
+
+    label_renderer.render(image, detections);
 }
 
 /*
-    * Function to get the output name
+    * Function to run dummy inferences before the first request
+    *
+    * The first runs of a session pay for arena growth, lazy allocations and
+    * kernel selection. Running every configured shape here moves that cost
+    * out of the first requests. The runs bypass the stage histograms so they
+    * do not skew the latency metrics.
+    *
+    * @param target: model to warm up, not yet visible to requests or pinned by the caller
     *
-    * @return: name of the output tensor
+    * @return: time spent in the warm-up runs
 */
-std::string InferenceEngine::getOutputName()
+std::chrono::milliseconds InferenceEngine::warmUp(Model &target)
 {
-    Ort::AllocatorWithDefaultOptions allocator;
-    Ort::AllocatedStringPtr name_allocator = session.GetOutputNameAllocated(0, allocator);
-    return std::string(name_allocator.get());
+    TraceScope scope("warmup");
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<cv::Size> resolutions = engine_config.warmup_resolutions;
+    if (resolutions.empty())
+    {
+        resolutions.push_back(inputSize());
+    }
+
+    const std::vector<int64_t> &model_shape = target.input_dims;
+    const char *input_name_ptr = target.input_name.c_str();
+    const char *output_name_ptr = target.output_name.c_str();
+
+    for (const cv::Size &resolution : resolutions)
+    {
+        if (model_shape.size() == 4 &&
+            ((model_shape[2] > 0 && model_shape[2] != resolution.height) || (model_shape[3] > 0 && model_shape[3] != resolution.width)))
+        {
+            throw std::runtime_error("Warm-up resolution " + std::to_string(resolution.width) + "x" + std::to_string(resolution.height) + " does not match the model input");
+        }
+
+        for (size_t batch_size : engine_config.warmup_batch_sizes)
+        {
+            if (batch_size == 0 || (batch_size > 1 && !dynamic_batch))
+            {
+                continue;
+            }
+
+            std::vector<int64_t> shape = {static_cast<int64_t>(batch_size), input_shape[1], resolution.height, resolution.width};
+            std::vector<float> input_tensor_values(batch_size * input_shape[1] * resolution.area(), 0.5f);
+            Ort::Value input_tensor = Ort::Value::CreateTensor<float>(memory_info, input_tensor_values.data(), input_tensor_values.size(), shape.data(), shape.size());
+
+            for (int i = 0; i < engine_config.warmup_iterations; ++i)
+            {
+                target.session.Run(Ort::RunOptions{nullptr}, &input_name_ptr, &input_tensor, 1, &output_name_ptr, 1);
+            }
+        }
+    }
+
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+    static Gauge &warmup_gauge = MetricsRegistry::global().gauge("yolov10_engine_warmup_milliseconds", "Time spent in the engine warm-up runs");
+    warmup_gauge.set(duration.count());
+
+    return duration;
 }
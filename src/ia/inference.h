@@ -1,41 +1,119 @@
 #ifndef INFERENCE_H
 #define INFERENCE_H
 
+#include "label_renderer.h"
+#include "memory/rcu_pointer.h"
+#include "preprocess.h"
 #include <onnxruntime_cxx_api.h>
 #include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <string>
 
-struct Detection
+struct EngineConfig
 {
-    float confidence;
-    cv::Rect bbox;
-    int class_id;
-    std::string class_name;
+    int intra_op_threads = 1;
+    GraphOptimizationLevel optimization_level = GraphOptimizationLevel::ORT_ENABLE_BASIC;
+    std::string profile_prefix;
+
+    // CPUs for the ONNX Runtime intra-op threads, one per thread, empty to
+    // let the OS place them
+    std::vector<int> cpus;
+
+    // Dummy runs made before the engine reports ready, for every batch size
+    // and resolution. No resolution means the model input size; batch sizes
+    // above one are only used by models with a dynamic batch dimension.
+    int warmup_iterations = 0;
+    std::vector<size_t> warmup_batch_sizes{1};
+    std::vector<cv::Size> warmup_resolutions;
+
+    // Labels indexed by class id, empty for the 80 COCO classes
+    std::vector<std::string> class_names;
+
+    // Run on the thread pools of the environment instead of per session
+    // ones, the environment must be created with global thread pools
+    bool shared_thread_pool = false;
 };
 
+std::vector<std::string> loadClassNames(const std::string &path);
+
 
 class InferenceEngine
 {
 public:
-    InferenceEngine(const std::string &model_path);
+    InferenceEngine(const std::string &model_path, const EngineConfig &config = EngineConfig());
+    InferenceEngine(std::shared_ptr<Ort::Env> env, const std::string &model_path, const EngineConfig &config = EngineConfig());
     ~InferenceEngine();
 
     std::vector<float> preprocessImage(const cv::Mat &image);
+    void preprocessImage(const cv::Mat &image, std::vector<float> &input_tensor_values);
+    void preprocessImage(const cv::Mat &image, const cv::Size &input_size, std::vector<float> &input_tensor_values);
+    void preprocessImage(const YuvFrame &frame, std::vector<float> &input_tensor_values);
+    std::vector<float> preprocessRegion(const cv::Mat &image, const cv::Rect &region, LetterboxTransform &transform);
+    void preprocessRegion(const cv::Mat &image, const cv::Rect &region, LetterboxTransform &transform, std::vector<float> &input_tensor_values);
     std::vector<Detection> filterDetections(const std::vector<float> &results, float confidence_threshold, int img_width, int img_height, int orig_width, int orig_height);
+    std::vector<Detection> filterDetections(const std::vector<float> &results, float confidence_threshold, const LetterboxTransform &transform);
     std::vector<float> runInference(const std::vector<float> &input_tensor_values);
-    
+    void runInference(const std::vector<float> &input_tensor_values, std::vector<float> &output_tensor_values);
+    void runInference(const std::vector<float> &input_tensor_values, const cv::Size &input_size, std::vector<float> &output_tensor_values);
+    std::vector<std::vector<float>> runInferenceBatch(const std::vector<float> &input_tensor_values, size_t batch_size);
+
+    cv::Size inputSize() const;
+    bool supportsInputSize(const cv::Size &input_size) const;
+
+    std::string endProfiling();
+    uint64_t profilingStartNs() const;
+
+    bool ready() const;
+    std::chrono::milliseconds warmupDuration() const;
+
+    void reload(const std::string &model_path);
+    std::string modelPath() const;
+    uint64_t generation() const;
+
+    bool supportsBatching() const;
+    const std::vector<std::string> &classNames() const;
+
     cv::Mat draw_labels(const cv::Mat &image, const std::vector<Detection> &detections);
+    void drawLabels(cv::Mat &image, const std::vector<Detection> &detections);
 
     std::vector<int64_t> input_shape;
     
 private:
-    Ort::Env env;
+    // A loaded model file, swapped as a whole by reload(). Requests pin the
+    // model they started on, so they finish on it even if a reload happens.
+    struct Model
+    {
+        Model(Ort::Env &env, const std::string &model_path, const Ort::SessionOptions &options);
+
+        Ort::Session session;
+        std::string path;
+        std::string input_name;
+        std::string output_name;
+        std::vector<int64_t> input_dims;
+        std::vector<int64_t> output_shape;
+    };
+
+    EngineConfig engine_config;
+    std::shared_ptr<Ort::Env> env;
     Ort::SessionOptions session_options;
-    Ort::Session session;
+    RcuPointer<Model> model;
+    LabelRenderer label_renderer;
+    std::vector<std::string> class_names;
+
+    bool dynamic_batch;
+    Ort::MemoryInfo memory_info;
+    std::atomic<bool> is_ready;
+    std::atomic<int64_t> warmup_milliseconds;
+    std::atomic<uint64_t> model_generation;
+    std::mutex reload_mutex;
+
+    static Ort::SessionOptions createSessionOptions(const EngineConfig &config);
 
-    std::string getInputName();
-    std::string getOutputName();
+    std::chrono::milliseconds warmUp(Model &target);
 
     static const std::vector<std::string> CLASS_NAMES;
 };
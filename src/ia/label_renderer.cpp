@@ -0,0 +1,140 @@
+#include "label_renderer.h"
+#include "preprocess.h"
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+LabelRenderer::LabelRenderer(int confidence_buckets, double background_opacity)
+    : confidence_buckets(std::max(1, confidence_buckets)),
+      background_opacity(std::min(std::max(background_opacity, 0.0), 1.0))
+{
+}
+
+/*
+ * Function to draw the detections on the image in place
+ *
+ * @param image: BGR image to annotate
+ * @param detections: vector of Detection objects
+ */
+void LabelRenderer::render(cv::Mat &image, const std::vector<Detection> &detections)
+{
+    for (const auto &detection : detections)
+    {
+        cv::rectangle(image, detection.bbox, cv::Scalar(0, 255, 0), 2);
+
+        const Sprite sprite = getSprite(detection);
+        blit(image, sprite, cv::Point(detection.bbox.x, detection.bbox.y - sprite.ascent));
+    }
+}
+
+/*
+ * Function to drop every cached sprite
+ */
+void LabelRenderer::clear()
+{
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    cache.clear();
+}
+
+/*
+ * Function to get the sprite of a detection, rendering it on first use
+ *
+ * Returned by value: another thread may clear the cache once the lock is
+ * released, and copying only bumps the reference counts of the pixels.
+ *
+ * @param detection: detection to label
+ *
+ * @return: cached sprite for the class and confidence bucket
+ */
+LabelRenderer::Sprite LabelRenderer::getSprite(const Detection &detection)
+{
+    const int bucket = std::min(confidence_buckets, std::max(0, static_cast<int>(detection.confidence * confidence_buckets)));
+    const int64_t key = static_cast<int64_t>(detection.class_id) * (confidence_buckets + 1) + bucket;
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    auto it = cache.find(key);
+    if (it != cache.end())
+    {
+        return it->second;
+    }
+
+    if (cache.size() >= MAX_CACHED_SPRITES)
+    {
+        cache.clear();
+    }
+
+    char confidence_text[16];
+    std::snprintf(confidence_text, sizeof(confidence_text), "%.2f", static_cast<double>(bucket) / confidence_buckets);
+
+    return cache.emplace(key, renderSprite(detection.class_name + ": " + confidence_text)).first->second;
+}
+
+/*
+ * Function to render a label into a BGRA sprite
+ *
+ * @param label: text of the label
+ *
+ * @return: sprite with a white background and black text
+ */
+LabelRenderer::Sprite LabelRenderer::renderSprite(const std::string &label) const
+{
+    int baseLine;
+    cv::Size labelSize = cv::getTextSize(label, cv::FONT_HERSHEY_SIMPLEX, 0.5, 1, &baseLine);
+
+    const int alpha = static_cast<int>(background_opacity * 255 + 0.5);
+    cv::Mat pixels(labelSize.height + baseLine + 1, labelSize.width + 1, CV_8UC4, cv::Scalar(255, 255, 255, alpha));
+    cv::putText(pixels, label, cv::Point(0, labelSize.height), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0, 0, 0, 255), 1);
+
+    Sprite sprite{pixels, cv::Mat(), labelSize.height};
+    if (alpha == 255)
+    {
+        cv::cvtColor(pixels, sprite.opaque_pixels, cv::COLOR_BGRA2BGR);
+    }
+
+    return sprite;
+}
+
+/*
+ * Function to copy a sprite onto the image, clipped to the image bounds
+ *
+ * @param image: BGR image to draw on
+ * @param sprite: sprite to copy
+ * @param origin: position of the top left corner of the sprite in the image
+ */
+void LabelRenderer::blit(cv::Mat &image, const Sprite &sprite, cv::Point origin) const
+{
+    cv::Rect target = cv::Rect(origin.x, origin.y, sprite.pixels.cols, sprite.pixels.rows) & cv::Rect(0, 0, image.cols, image.rows);
+    if (target.empty())
+    {
+        return;
+    }
+
+    if (image.type() != CV_8UC3)
+    {
+        throw std::runtime_error("Labels can only be drawn on 8-bit BGR images");
+    }
+
+    const cv::Rect source(target.x - origin.x, target.y - origin.y, target.width, target.height);
+    cv::Mat destination = image(target);
+
+    if (!sprite.opaque_pixels.empty())
+    {
+        sprite.opaque_pixels(source).copyTo(destination);
+        return;
+    }
+
+    for (int y = 0; y < target.height; ++y)
+    {
+        const cv::Vec4b *src = sprite.pixels.ptr<cv::Vec4b>(y + source.y) + source.x;
+        cv::Vec3b *dst = destination.ptr<cv::Vec3b>(y);
+
+        for (int x = 0; x < target.width; ++x)
+        {
+            const int a = src[x][3];
+            for (int c = 0; c < 3; ++c)
+            {
+                dst[x][c] = static_cast<uchar>((src[x][c] * a + dst[x][c] * (255 - a) + 127) / 255);
+            }
+        }
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef LABEL_RENDERER_H
+#define LABEL_RENDERER_H
+
+#include <opencv2/opencv.hpp>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct Detection;
+
+// Draws detections in place. The "name: confidence" labels are rendered once
+// per class and confidence bucket into BGRA sprites and blitted afterwards,
+// so no text layout or Hershey rendering happens per frame.
+class LabelRenderer
+{
+public:
+    explicit LabelRenderer(int confidence_buckets = 100, double background_opacity = 1.0);
+
+    void render(cv::Mat &image, const std::vector<Detection> &detections);
+    void clear();
+
+private:
+    struct Sprite
+    {
+        cv::Mat pixels;
+        cv::Mat opaque_pixels;
+        int ascent;
+    };
+
+    Sprite getSprite(const Detection &detection);
+    Sprite renderSprite(const std::string &label) const;
+    void blit(cv::Mat &image, const Sprite &sprite, cv::Point origin) const;
+
+    int confidence_buckets;
+    double background_opacity;
+
+    std::mutex cache_mutex;
+    std::unordered_map<int64_t, Sprite> cache;
+
+    static constexpr size_t MAX_CACHED_SPRITES = 4096;
+};
+
+
+#endif // LABEL_RENDERER_H
@@ -0,0 +1,398 @@
+#include "model_registry.h"
+#include "metrics/metrics.h"
+#include "system/cpu_topology.h"
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+    int readInt(const cv::FileNode &node, int fallback)
+    {
+        return node.empty() ? fallback : static_cast<int>(node);
+    }
+
+    std::string readString(const cv::FileNode &node)
+    {
+        return node.empty() ? std::string() : node.string();
+    }
+
+    size_t fileSize(const std::string &path)
+    {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file)
+        {
+            throw std::runtime_error("Could not open the model: " + path);
+        }
+        return static_cast<size_t>(file.tellg());
+    }
+
+    Gauge &loadedBytesGauge()
+    {
+        static Gauge &gauge = MetricsRegistry::global().gauge("yolov10_registry_loaded_bytes", "Estimated memory of the loaded models");
+        return gauge;
+    }
+}
+
+/*
+ * Function to load the registry settings and models from a YAML or JSON file
+ *
+ * Expected layout:
+ *
+ *   threads: 8
+ *   cpus: "0-7"
+ *   memory_budget_mb: 4096
+ *   idle_timeout_s: 600
+ *   models:
+ *     - { name: "live", path: "yolov10n.onnx", pinned: 1, max_batch: 8 }
+ *     - { name: "forensic", path: "yolov10x.onnx", labels: "forensic.names", max_batch: 2 }
+ *
+ * Per model, "warmup", "max_wait_us", "workers" and "memory_mb" are optional.
+ *
+ * @param path: path to the configuration file
+ *
+ * @return: RegistryConfig with the parsed models
+ */
+RegistryConfig RegistryConfig::load(const std::string &path)
+{
+    cv::FileStorage storage(path, cv::FileStorage::READ);
+    if (!storage.isOpened())
+    {
+        throw std::runtime_error("Could not open model registry file: " + path);
+    }
+
+    RegistryConfig config;
+    config.intra_op_threads = readInt(storage["threads"], 0);
+    config.cpus = parseCpuList(readString(storage["cpus"]));
+    config.memory_budget_bytes = static_cast<size_t>(readInt(storage["memory_budget_mb"], 0)) << 20;
+    config.idle_timeout = std::chrono::seconds(readInt(storage["idle_timeout_s"], 0));
+
+    cv::FileNode models_node = storage["models"];
+    if (!models_node.isSeq())
+    {
+        throw std::runtime_error("Model registry file has no 'models' list: " + path);
+    }
+
+    for (const auto &model_node : models_node)
+    {
+        ModelSpec spec;
+        spec.name = readString(model_node["name"]);
+        spec.path = readString(model_node["path"]);
+        if (spec.name.empty() || spec.path.empty())
+        {
+            throw std::runtime_error("Model registry entry needs a name and a path: " + path);
+        }
+        spec.labels_path = readString(model_node["labels"]);
+        spec.pinned = readInt(model_node["pinned"], 0) != 0;
+        spec.memory_bytes = static_cast<size_t>(readInt(model_node["memory_mb"], 0)) << 20;
+        spec.engine.warmup_iterations = readInt(model_node["warmup"], 2);
+        spec.batch.max_batch_size = static_cast<size_t>(readInt(model_node["max_batch"], static_cast<int>(spec.batch.max_batch_size)));
+        spec.batch.max_wait = std::chrono::microseconds(readInt(model_node["max_wait_us"], static_cast<int>(spec.batch.max_wait.count())));
+        spec.batch.workers = readInt(model_node["workers"], spec.batch.workers);
+        spec.engine.warmup_batch_sizes = {1, spec.batch.max_batch_size};
+        config.models.push_back(spec);
+    }
+
+    return config;
+}
+
+ModelRegistry::ModelRegistry(const RegistryConfig &config)
+    : config(config),
+      env(createEnv(config)),
+      loaded_bytes(0)
+{
+    for (const auto &spec : config.models)
+    {
+        add(spec);
+    }
+}
+
+ModelRegistry::~ModelRegistry()
+{
+    stop();
+}
+
+/*
+ * Function to create the environment and the thread pool shared by the models
+ *
+ * @param config: registry configuration
+ *
+ * @return: environment with global thread pools
+ */
+std::shared_ptr<Ort::Env> ModelRegistry::createEnv(const RegistryConfig &config)
+{
+    Ort::ThreadingOptions threading;
+    threading.SetGlobalIntraOpNumThreads(config.intra_op_threads);
+    threading.SetGlobalInterOpNumThreads(1);
+    if (!config.cpus.empty() && config.intra_op_threads > 1)
+    {
+        // Same format as the per session affinities, 1-based, the caller is the first thread
+        std::string affinities;
+        for (int i = 1; i < config.intra_op_threads; ++i)
+        {
+            affinities += (i > 1 ? ";" : "") + std::to_string(config.cpus[i % config.cpus.size()] + 1);
+        }
+        Ort::ThrowOnError(Ort::GetApi().SetGlobalIntraOpThreadAffinity(threading, affinities.c_str()));
+    }
+
+    return std::make_shared<Ort::Env>(threading, ORT_LOGGING_LEVEL_WARNING, "ONNXRuntime");
+}
+
+/*
+ * Function to register a model, it is loaded on its first request
+ *
+ * @param spec: name, file and settings of the model
+ */
+void ModelRegistry::add(const ModelSpec &spec)
+{
+    size_t bytes = spec.memory_bytes ? spec.memory_bytes : fileSize(spec.path);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (entries.count(spec.name))
+    {
+        throw std::runtime_error("Model registered twice: " + spec.name);
+    }
+    entries[spec.name] = Entry{spec, bytes, nullptr, std::chrono::steady_clock::now(), false};
+}
+
+/*
+ * Function to get a model, loading it if needed
+ *
+ * The model stays loaded, and is not evicted, while the returned handle or a
+ * copy of it is alive. Requests should hold it until their results are in.
+ *
+ * @param name: registered name of the model
+ *
+ * @return: engine and batch scheduler of the model
+ */
+std::shared_ptr<ModelRegistry::LoadedModel> ModelRegistry::acquire(const std::string &name)
+{
+    static Counter &hits = MetricsRegistry::global().counter("yolov10_registry_requests_total", "Model lookups", "result=\"hit\"");
+    static Counter &misses = MetricsRegistry::global().counter("yolov10_registry_requests_total", "Model lookups", "result=\"load\"");
+
+    // Evicted models are destroyed after the lock is released
+    std::vector<std::shared_ptr<LoadedModel>> evicted;
+    std::unique_lock<std::mutex> lock(mutex);
+
+    auto it = entries.find(name);
+    if (it == entries.end())
+    {
+        throw std::runtime_error("Unknown model: " + name);
+    }
+    Entry &entry = it->second;
+
+    // Another request may be loading it already
+    loaded_cv.wait(lock, [&entry]
+                   { return !entry.loading; });
+
+    auto now = std::chrono::steady_clock::now();
+    entry.last_used = now;
+    evictExpired(now, evicted);
+    if (entry.loaded)
+    {
+        hits.increment();
+        return entry.loaded;
+    }
+
+    // Reserve the memory before loading, so concurrent loads cannot overshoot the budget
+    makeRoom(entry, evicted);
+    entry.loading = true;
+    loaded_bytes += entry.bytes;
+    loadedBytesGauge().set(static_cast<int64_t>(loaded_bytes));
+    misses.increment();
+
+    lock.unlock();
+    evicted.clear();
+    std::shared_ptr<LoadedModel> model;
+    try
+    {
+        model = loadModel(entry.spec);
+    }
+    catch (...)
+    {
+        lock.lock();
+        entry.loading = false;
+        loaded_bytes -= entry.bytes;
+        loadedBytesGauge().set(static_cast<int64_t>(loaded_bytes));
+        loaded_cv.notify_all();
+        throw;
+    }
+    lock.lock();
+
+    entry.loaded = model;
+    entry.loading = false;
+    loaded_cv.notify_all();
+
+    return model;
+}
+
+/*
+ * Function to create the engine and scheduler of a model
+ *
+ * @param spec: model to load
+ *
+ * @return: loaded model, warmed up if configured
+ */
+std::shared_ptr<ModelRegistry::LoadedModel> ModelRegistry::loadModel(const ModelSpec &spec)
+{
+    EngineConfig engine_config = spec.engine;
+    engine_config.shared_thread_pool = true;
+    if (!spec.labels_path.empty())
+    {
+        engine_config.class_names = loadClassNames(spec.labels_path);
+    }
+
+    BatchConfig batch_config = spec.batch;
+    batch_config.queue_name = "batch_" + spec.name;
+
+    auto model = std::make_shared<LoadedModel>();
+    model->engine = std::make_unique<InferenceEngine>(env, spec.path, engine_config);
+    model->scheduler = std::make_unique<BatchScheduler>(*model->engine, batch_config);
+    return model;
+}
+
+/*
+ * Function to unload the models that have not been used for the idle timeout
+ *
+ * @param now: current time
+ * @param evicted: receives the unloaded models, to be destroyed without the lock
+ */
+void ModelRegistry::evictExpired(std::chrono::steady_clock::time_point now, std::vector<std::shared_ptr<LoadedModel>> &evicted)
+{
+    if (config.idle_timeout.count() <= 0)
+    {
+        return;
+    }
+
+    for (auto &item : entries)
+    {
+        Entry &entry = item.second;
+        if (entry.loaded && !entry.spec.pinned && entry.loaded.use_count() == 1 && now - entry.last_used >= config.idle_timeout)
+        {
+            unload(entry, evicted);
+        }
+    }
+}
+
+/*
+ * Function to unload idle models until the entry fits in the memory budget
+ *
+ * Models in use or pinned are never unloaded. The least recently used idle
+ * model goes first.
+ *
+ * @param entry: model about to be loaded
+ * @param evicted: receives the unloaded models, to be destroyed without the lock
+ */
+void ModelRegistry::makeRoom(const Entry &entry, std::vector<std::shared_ptr<LoadedModel>> &evicted)
+{
+    if (config.memory_budget_bytes == 0)
+    {
+        return;
+    }
+
+    while (loaded_bytes + entry.bytes > config.memory_budget_bytes)
+    {
+        Entry *oldest = nullptr;
+        for (auto &item : entries)
+        {
+            Entry &candidate = item.second;
+            // Only this map holds an idle model
+            if (candidate.loaded && !candidate.spec.pinned && candidate.loaded.use_count() == 1 &&
+                (!oldest || candidate.last_used < oldest->last_used))
+            {
+                oldest = &candidate;
+            }
+        }
+
+        if (!oldest)
+        {
+            throw std::runtime_error("Model " + entry.spec.name + " does not fit in the memory budget, every loaded model is in use");
+        }
+        unload(*oldest, evicted);
+    }
+}
+
+void ModelRegistry::unload(Entry &entry, std::vector<std::shared_ptr<LoadedModel>> &evicted)
+{
+    static Counter &evictions = MetricsRegistry::global().counter("yolov10_registry_evictions_total", "Models unloaded to free memory");
+
+    evicted.push_back(std::move(entry.loaded));
+    entry.loaded.reset();
+    loaded_bytes -= entry.bytes;
+    loadedBytesGauge().set(static_cast<int64_t>(loaded_bytes));
+    evictions.increment();
+}
+
+bool ModelRegistry::contains(const std::string &name) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.count(name) != 0;
+}
+
+/*
+ * Function to list the registered models
+ *
+ * @return: names in alphabetical order
+ */
+std::vector<std::string> ModelRegistry::names() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::string> result;
+    for (const auto &item : entries)
+    {
+        result.push_back(item.first);
+    }
+    return result;
+}
+
+/*
+ * Function to list the models currently in memory
+ *
+ * @return: names in alphabetical order
+ */
+std::vector<std::string> ModelRegistry::loadedNames() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::string> result;
+    for (const auto &item : entries)
+    {
+        if (item.second.loaded)
+        {
+            result.push_back(item.first);
+        }
+    }
+    return result;
+}
+
+size_t ModelRegistry::loadedBytes() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return loaded_bytes;
+}
+
+/*
+ * Function to unload the models idle for longer than the timeout
+ *
+ * Also done on every acquire(); servers without steady traffic can call it
+ * from a timer.
+ */
+void ModelRegistry::evictIdle()
+{
+    std::vector<std::shared_ptr<LoadedModel>> evicted;
+    std::lock_guard<std::mutex> lock(mutex);
+    evictExpired(std::chrono::steady_clock::now(), evicted);
+}
+
+/*
+ * Function to finish the queued requests of every loaded model
+ */
+void ModelRegistry::stop()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &item : entries)
+    {
+        if (item.second.loaded)
+        {
+            item.second.loaded->scheduler->stop();
+        }
+    }
+}
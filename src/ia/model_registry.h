@@ -0,0 +1,103 @@
+#ifndef MODEL_REGISTRY_H
+#define MODEL_REGISTRY_H
+
+#include "batch_scheduler.h"
+#include "inference.h"
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct ModelSpec
+{
+    std::string name;
+    std::string path;
+    // Text file with one class name per line, empty for COCO
+    std::string labels_path;
+    EngineConfig engine;
+    BatchConfig batch;
+    // Estimated footprint, 0 to use the size of the ONNX file
+    size_t memory_bytes = 0;
+    // Never evicted, e.g. the model of the live streams
+    bool pinned = false;
+};
+
+struct RegistryConfig
+{
+    // Threads of the pool shared by every model, 0 for one per core
+    int intra_op_threads = 0;
+    std::vector<int> cpus;
+
+    // Loaded models must fit in the budget, idle ones are evicted least
+    // recently used first to make room. 0 disables the budget.
+    size_t memory_budget_bytes = 0;
+    // Unpinned models unused for this long are unloaded, 0 keeps them
+    std::chrono::seconds idle_timeout{0};
+
+    std::vector<ModelSpec> models;
+
+    static RegistryConfig load(const std::string &path);
+};
+
+
+// Several models served side by side, chosen by name per request. The
+// models share one Ort::Env and its global thread pool, so adding a variant
+// does not add threads; each one keeps its own input shape, label map and
+// batch queue. Models are loaded on first use and unloaded when idle to stay
+// under the memory budget. The registry must create the first Ort::Env of
+// the process, since ONNX Runtime keeps a single environment.
+class ModelRegistry
+{
+public:
+    struct LoadedModel
+    {
+        std::unique_ptr<InferenceEngine> engine;
+        std::unique_ptr<BatchScheduler> scheduler;
+    };
+
+    explicit ModelRegistry(const RegistryConfig &config = RegistryConfig());
+    ~ModelRegistry();
+
+    ModelRegistry(const ModelRegistry &) = delete;
+    ModelRegistry &operator=(const ModelRegistry &) = delete;
+
+    void add(const ModelSpec &spec);
+    std::shared_ptr<LoadedModel> acquire(const std::string &name);
+
+    bool contains(const std::string &name) const;
+    std::vector<std::string> names() const;
+    std::vector<std::string> loadedNames() const;
+    size_t loadedBytes() const;
+    void evictIdle();
+    void stop();
+
+private:
+    struct Entry
+    {
+        ModelSpec spec;
+        size_t bytes;
+        std::shared_ptr<LoadedModel> loaded;
+        std::chrono::steady_clock::time_point last_used;
+        bool loading = false;
+    };
+
+    RegistryConfig config;
+    std::shared_ptr<Ort::Env> env;
+
+    mutable std::mutex mutex;
+    std::condition_variable loaded_cv;
+    std::map<std::string, Entry> entries;
+    size_t loaded_bytes;
+
+    static std::shared_ptr<Ort::Env> createEnv(const RegistryConfig &config);
+    std::shared_ptr<LoadedModel> loadModel(const ModelSpec &spec);
+    void evictExpired(std::chrono::steady_clock::time_point now, std::vector<std::shared_ptr<LoadedModel>> &evicted);
+    void makeRoom(const Entry &entry, std::vector<std::shared_ptr<LoadedModel>> &evicted);
+    void unload(Entry &entry, std::vector<std::shared_ptr<LoadedModel>> &evicted);
+};
+
+
+#endif // MODEL_REGISTRY_H
@@ -0,0 +1,467 @@
+#include "preprocess.h"
+#include "metrics/metrics.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+    std::string className(const std::vector<std::string> &class_names, int class_id)
+    {
+        if (class_id >= 0 && class_id < static_cast<int>(class_names.size()))
+        {
+            return class_names[class_id];
+        }
+        return std::to_string(class_id);
+    }
+
+    // BT.601 video range to RGB, the coefficients of OpenCV's YUV conversions
+    const float YUV_Y = 1.164f;
+    const float YUV_UB = 2.018f;
+    const float YUV_UG = -0.391f;
+    const float YUV_VG = -0.813f;
+    const float YUV_VR = 1.596f;
+
+    // Source samples of one output pixel along one axis, as cv::INTER_LINEAR picks them
+    struct LinearTap
+    {
+        int first;
+        int second;
+        float weight;
+    };
+
+    void linearTaps(int source_size, int target_size, std::vector<LinearTap> &taps)
+    {
+        taps.resize(target_size);
+        const double scale = static_cast<double>(source_size) / target_size;
+        for (int i = 0; i < target_size; ++i)
+        {
+            const double position = (i + 0.5) * scale - 0.5;
+            int first = static_cast<int>(std::floor(position));
+            float weight = static_cast<float>(position - first);
+            if (first < 0)
+            {
+                first = 0;
+                weight = 0.0f;
+            }
+            if (first >= source_size - 1)
+            {
+                first = source_size - 1;
+                weight = 0.0f;
+            }
+            taps[i] = {first, std::min(first + 1, source_size - 1), weight};
+        }
+    }
+
+    // Luma and chroma of a source pixel, chroma taken from the sample that
+    // covers it like the color conversion upsamples it
+    struct Nv12Sampler
+    {
+        const uint8_t *y_plane;
+        const uint8_t *uv_plane;
+        int y_stride;
+        int uv_stride;
+
+        int luma(int x, int y) const { return y_plane[y * y_stride + x]; }
+        int u(int x, int y) const { return uv_plane[(y >> 1) * uv_stride + (x & ~1)]; }
+        int v(int x, int y) const { return uv_plane[(y >> 1) * uv_stride + (x | 1)]; }
+    };
+
+    struct I420Sampler
+    {
+        const uint8_t *y_plane;
+        const uint8_t *u_plane;
+        const uint8_t *v_plane;
+        int y_stride;
+        int u_stride;
+        int v_stride;
+
+        int luma(int x, int y) const { return y_plane[y * y_stride + x]; }
+        int u(int x, int y) const { return u_plane[(y >> 1) * u_stride + (x >> 1)]; }
+        int v(int x, int y) const { return v_plane[(y >> 1) * v_stride + (x >> 1)]; }
+    };
+
+    struct YuyvSampler
+    {
+        const uint8_t *plane;
+        int stride;
+
+        int luma(int x, int y) const { return plane[y * stride + 2 * x]; }
+        int u(int x, int y) const { return plane[y * stride + 4 * (x >> 1) + 1]; }
+        int v(int x, int y) const { return plane[y * stride + 4 * (x >> 1) + 3]; }
+    };
+
+    /*
+     * Function to convert, resize, normalize and scatter one band of output rows
+     *
+     * The conversion is affine, so interpolating Y, U and V and converting
+     * once per output pixel matches converting every source pixel first,
+     * up to saturation and rounding.
+     */
+    template <typename Sampler>
+    void convertRows(const Sampler &sampler, const std::vector<LinearTap> &columns, const std::vector<LinearTap> &rows,
+                     const cv::Range &range, size_t plane_size, float *tensor)
+    {
+        const int width = static_cast<int>(columns.size());
+        const float scale = 1.0f / 255.0f;
+
+        for (int out_y = range.start; out_y < range.end; ++out_y)
+        {
+            const LinearTap &row = rows[out_y];
+            float *blue = tensor + static_cast<size_t>(out_y) * width;
+            float *green = blue + plane_size;
+            float *red = green + plane_size;
+
+            for (int out_x = 0; out_x < width; ++out_x)
+            {
+                const LinearTap &column = columns[out_x];
+                const float w00 = (1.0f - column.weight) * (1.0f - row.weight);
+                const float w01 = column.weight * (1.0f - row.weight);
+                const float w10 = (1.0f - column.weight) * row.weight;
+                const float w11 = column.weight * row.weight;
+
+                // Luma below the video range is black, as in the color conversion
+                const float luma = w00 * std::max(0, sampler.luma(column.first, row.first) - 16) +
+                                   w01 * std::max(0, sampler.luma(column.second, row.first) - 16) +
+                                   w10 * std::max(0, sampler.luma(column.first, row.second) - 16) +
+                                   w11 * std::max(0, sampler.luma(column.second, row.second) - 16);
+                const float u = w00 * sampler.u(column.first, row.first) + w01 * sampler.u(column.second, row.first) +
+                                w10 * sampler.u(column.first, row.second) + w11 * sampler.u(column.second, row.second) - 128.0f;
+                const float v = w00 * sampler.v(column.first, row.first) + w01 * sampler.v(column.second, row.first) +
+                                w10 * sampler.v(column.first, row.second) + w11 * sampler.v(column.second, row.second) - 128.0f;
+
+                const float y = YUV_Y * luma;
+                blue[out_x] = std::min(std::max(y + YUV_UB * u, 0.0f), 255.0f) * scale;
+                green[out_x] = std::min(std::max(y + YUV_UG * u + YUV_VG * v, 0.0f), 255.0f) * scale;
+                red[out_x] = std::min(std::max(y + YUV_VR * v, 0.0f), 255.0f) * scale;
+            }
+        }
+    }
+}
+
+/*
+ * Function to stretch the image to the input size
+ *
+ * @param image: input image
+ * @param input_size: width and height of the network input
+ *
+ * @return: vector of floats representing the preprocessed image
+ */
+std::vector<float> preprocessStretch(const cv::Mat &image, const cv::Size &input_size)
+{
+    std::vector<float> tensor;
+    preprocessStretch(image, input_size, tensor);
+    return tensor;
+}
+
+/*
+ * Function to stretch the image to the input size into an existing tensor
+ *
+ * @param image: input image
+ * @param input_size: width and height of the network input
+ * @param tensor: filled with the preprocessed image, its capacity is reused
+ */
+void preprocessStretch(const cv::Mat &image, const cv::Size &input_size, std::vector<float> &tensor)
+{
+    if (image.empty())
+    {
+        throw std::runtime_error("Could not read the image");
+    }
+
+    thread_local cv::Mat resized_image;
+    cv::resize(image, resized_image, input_size);
+
+    packChannels(resized_image, tensor);
+}
+
+/*
+ * Function to letterbox a region of the image into the input size
+ *
+ * @param image: input image
+ * @param region: region of the image to feed to the network
+ * @param input_size: width and height of the network input
+ * @param transform: filled with the mapping needed to project detections back
+ *
+ * @return: vector of floats representing the preprocessed region
+ */
+std::vector<float> preprocessLetterbox(const cv::Mat &image, const cv::Rect &region, const cv::Size &input_size, LetterboxTransform &transform)
+{
+    std::vector<float> tensor;
+    preprocessLetterbox(image, region, input_size, transform, tensor);
+    return tensor;
+}
+
+/*
+ * Function to letterbox a region of the image into an existing tensor
+ *
+ * The region is cropped, scaled with its aspect ratio preserved and padded
+ * to the input size, so a small region of interest keeps its full effective
+ * resolution instead of being shrunk together with the whole frame.
+ *
+ * @param image: input image
+ * @param region: region of the image to feed to the network
+ * @param input_size: width and height of the network input
+ * @param transform: filled with the mapping needed to project detections back
+ * @param tensor: filled with the preprocessed region, its capacity is reused
+ */
+void preprocessLetterbox(const cv::Mat &image, const cv::Rect &region, const cv::Size &input_size, LetterboxTransform &transform, std::vector<float> &tensor)
+{
+    if (image.empty())
+    {
+        throw std::runtime_error("Could not read the image");
+    }
+
+    cv::Rect crop = region & cv::Rect(0, 0, image.cols, image.rows);
+    if (crop.empty())
+    {
+        throw std::runtime_error("Region of interest lies outside the image");
+    }
+
+    const int input_width = input_size.width;
+    const int input_height = input_size.height;
+    const float scale = std::min(static_cast<float>(input_width) / crop.width, static_cast<float>(input_height) / crop.height);
+    const int scaled_width = std::max(1, std::min(input_width, static_cast<int>(std::round(crop.width * scale))));
+    const int scaled_height = std::max(1, std::min(input_height, static_cast<int>(std::round(crop.height * scale))));
+
+    transform.crop = crop;
+    transform.scale = scale;
+    transform.pad_x = (input_width - scaled_width) / 2;
+    transform.pad_y = (input_height - scaled_height) / 2;
+
+    thread_local cv::Mat letterboxed;
+    letterboxed.create(input_height, input_width, CV_8UC3);
+    letterboxed.setTo(cv::Scalar(114, 114, 114));
+    cv::Mat target = letterboxed(cv::Rect(transform.pad_x, transform.pad_y, scaled_width, scaled_height));
+    cv::resize(image(crop), target, cv::Size(scaled_width, scaled_height));
+
+    packChannels(letterboxed, tensor);
+}
+
+/*
+ * Function to convert a resized BGR image into a planar float tensor
+ *
+ * The channels are split straight into the planes of the tensor.
+ *
+ * @param resized_image: image already resized to the input shape
+ * @param tensor: filled with floats in CHW order scaled to [0, 1]
+ */
+void packChannels(const cv::Mat &resized_image, std::vector<float> &tensor)
+{
+    thread_local cv::Mat float_image;
+    resized_image.convertTo(float_image, CV_32F, 1.0 / 255);
+
+    const size_t plane_size = static_cast<size_t>(float_image.rows) * float_image.cols;
+    if (tensor.capacity() < plane_size * 3)
+    {
+        static Counter &allocations = bufferAllocations();
+        allocations.increment();
+    }
+    tensor.resize(plane_size * 3);
+
+    cv::Mat channels[3];
+    for (int c = 0; c < 3; ++c)
+    {
+        channels[c] = cv::Mat(float_image.rows, float_image.cols, CV_32F, tensor.data() + c * plane_size);
+    }
+    cv::split(float_image, channels);
+}
+
+/*
+ * Function to check that a YUV frame describes memory that can be read
+ *
+ * @param frame: frame to check, throws if its size, planes or strides do not fit the format
+ */
+void checkYuvFrame(const YuvFrame &frame)
+{
+    if (frame.width <= 0 || frame.height <= 0 || !frame.planes[0])
+    {
+        throw std::runtime_error("YUV frame has no pixels");
+    }
+    if (frame.width % 2 || (frame.format != PixelFormat::YUYV && frame.height % 2))
+    {
+        throw std::runtime_error("YUV frame size must be even where chroma is subsampled");
+    }
+
+    bool valid = false;
+    switch (frame.format)
+    {
+    case PixelFormat::NV12:
+        valid = frame.planes[1] && frame.strides[0] >= frame.width && frame.strides[1] >= frame.width;
+        break;
+    case PixelFormat::I420:
+        valid = frame.planes[1] && frame.planes[2] && frame.strides[0] >= frame.width &&
+                frame.strides[1] >= frame.width / 2 && frame.strides[2] >= frame.width / 2;
+        break;
+    case PixelFormat::YUYV:
+        valid = frame.strides[0] >= frame.width * 2;
+        break;
+    }
+    if (!valid)
+    {
+        throw std::runtime_error("YUV frame is missing a plane or has a stride shorter than a row");
+    }
+}
+
+/*
+ * Function to stretch a YUV frame to the input size in one pass
+ *
+ * Color conversion, resizing, scaling to [0, 1] and the split into BGR
+ * planes happen together, once per network input pixel, so a 4K frame is
+ * never converted at full resolution. The result matches cvtColor followed
+ * by preprocessStretch up to rounding.
+ *
+ * @param frame: decoded frame, only read during this call
+ * @param input_size: width and height of the network input
+ * @param tensor: filled with floats in CHW order scaled to [0, 1], its capacity is reused
+ */
+void preprocessYuv(const YuvFrame &frame, const cv::Size &input_size, std::vector<float> &tensor)
+{
+    checkYuvFrame(frame);
+
+    thread_local std::vector<LinearTap> column_taps;
+    thread_local std::vector<LinearTap> row_taps;
+    linearTaps(frame.width, input_size.width, column_taps);
+    linearTaps(frame.height, input_size.height, row_taps);
+
+    // The bands run on other threads, which must see this thread's taps
+    const std::vector<LinearTap> &columns = column_taps;
+    const std::vector<LinearTap> &rows = row_taps;
+
+    const size_t plane_size = static_cast<size_t>(input_size.width) * input_size.height;
+    if (tensor.capacity() < plane_size * 3)
+    {
+        static Counter &allocations = bufferAllocations();
+        allocations.increment();
+    }
+    tensor.resize(plane_size * 3);
+
+    // Rows are independent, so bands of them run on OpenCV's thread pool like cv::resize does
+    float *data = tensor.data();
+    cv::parallel_for_(cv::Range(0, input_size.height), [&](const cv::Range &range)
+                      {
+                          switch (frame.format)
+                          {
+                          case PixelFormat::NV12:
+                              convertRows(Nv12Sampler{frame.planes[0], frame.planes[1], frame.strides[0], frame.strides[1]}, columns, rows, range, plane_size, data);
+                              break;
+                          case PixelFormat::I420:
+                              convertRows(I420Sampler{frame.planes[0], frame.planes[1], frame.planes[2], frame.strides[0], frame.strides[1], frame.strides[2]}, columns, rows, range, plane_size, data);
+                              break;
+                          case PixelFormat::YUYV:
+                              convertRows(YuyvSampler{frame.planes[0], frame.strides[0]}, columns, rows, range, plane_size, data);
+                              break;
+                          } });
+}
+
+/*
+    * Function to filter the detections based on the confidence threshold
+    *
+    * @param results: vector of floats representing the output tensor
+    * @param confidence_threshold: minimum confidence threshold
+    * @param img_width: width of the input image
+    * @param img_height: height of the input image
+    * @param orig_width: original width of the image
+    * @param orig_height: original height of the image
+    * @param class_names: names indexed by class id
+    *
+    * @return: vector of Detection objects
+
+*/
+std::vector<Detection> decodeDetections(const std::vector<float> &results, float confidence_threshold, int img_width, int img_height, int orig_width, int orig_height, const std::vector<std::string> &class_names)
+{
+    std::vector<Detection> detections;
+    const int num_detections = results.size() / 6;
+
+    for (int i = 0; i < num_detections; ++i)
+    {
+        float left = results[i * 6 + 0];
+        float top = results[i * 6 + 1];
+        float right = results[i * 6 + 2];
+        float bottom = results[i * 6 + 3];
+        float confidence = results[i * 6 + 4];
+        int class_id = results[i * 6 + 5];
+
+        if (confidence >= confidence_threshold)
+        {
+            int x = static_cast<int>(left * orig_width / img_width);
+            int y = static_cast<int>(top * orig_height / img_height);
+            int width = static_cast<int>((right - left) * orig_width / img_width);
+            int height = static_cast<int>((bottom - top) * orig_height / img_height);
+
+            detections.push_back(
+                {confidence,
+                 cv::Rect(x, y, width, height),
+                 class_id,
+                 className(class_names, class_id)});
+        }
+    }
+
+    return detections;
+}
+
+/*
+    * Function to filter the detections of a letterboxed region
+    *
+    * @param results: vector of floats representing the output tensor
+    * @param confidence_threshold: minimum confidence threshold
+    * @param transform: letterbox mapping returned by preprocessLetterbox
+    * @param class_names: names indexed by class id
+    *
+    * @return: vector of Detection objects in frame coordinates
+
+*/
+std::vector<Detection> decodeDetections(const std::vector<float> &results, float confidence_threshold, const LetterboxTransform &transform, const std::vector<std::string> &class_names)
+{
+    std::vector<Detection> detections;
+    const int num_detections = results.size() / 6;
+    const cv::Rect &crop = transform.crop;
+
+    auto to_frame_x = [&](float value)
+    {
+        float x = (value - transform.pad_x) / transform.scale + crop.x;
+        return std::min(std::max(x, static_cast<float>(crop.x)), static_cast<float>(crop.x + crop.width));
+    };
+    auto to_frame_y = [&](float value)
+    {
+        float y = (value - transform.pad_y) / transform.scale + crop.y;
+        return std::min(std::max(y, static_cast<float>(crop.y)), static_cast<float>(crop.y + crop.height));
+    };
+
+    for (int i = 0; i < num_detections; ++i)
+    {
+        float confidence = results[i * 6 + 4];
+        if (confidence < confidence_threshold)
+        {
+            continue;
+        }
+
+        int left = static_cast<int>(to_frame_x(results[i * 6 + 0]));
+        int top = static_cast<int>(to_frame_y(results[i * 6 + 1]));
+        int right = static_cast<int>(to_frame_x(results[i * 6 + 2]));
+        int bottom = static_cast<int>(to_frame_y(results[i * 6 + 3]));
+        int class_id = results[i * 6 + 5];
+
+        detections.push_back(
+            {confidence,
+             cv::Rect(left, top, right - left, bottom - top),
+             class_id,
+             className(class_names, class_id)});
+    }
+
+    return detections;
+}
+
+/*
+ * Function to measure how much two boxes overlap
+ *
+ * @param first: box in any coordinate system
+ * @param second: box in the same coordinate system
+ *
+ * @return: intersection over union, 0 for disjoint or empty boxes
+ */
+float boxIou(const cv::Rect &first, const cv::Rect &second)
+{
+    const double intersection = (first & second).area();
+    const double union_area = static_cast<double>(first.area()) + second.area() - intersection;
+    return union_area > 0 ? static_cast<float>(intersection / union_area) : 0.0f;
+}
@@ -0,0 +1,62 @@
+#ifndef PREPROCESS_H
+#define PREPROCESS_H
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct Detection
+{
+    float confidence;
+    cv::Rect bbox;
+    int class_id;
+    std::string class_name;
+};
+
+// Describes how a region of the frame was letterboxed into the network input
+struct LetterboxTransform
+{
+    cv::Rect crop;
+    float scale;
+    int pad_x;
+    int pad_y;
+};
+
+enum class PixelFormat
+{
+    NV12,
+    I420,
+    YUYV
+};
+
+// Frame as output by a video decoder, BT.601 video range YUV in memory the
+// caller owns. The planes are Y and interleaved UV for NV12, Y, U and V for
+// I420, and the single packed plane for YUYV; strides are in bytes.
+struct YuvFrame
+{
+    PixelFormat format;
+    int width;
+    int height;
+    const uint8_t *planes[3];
+    int strides[3];
+};
+
+// Image to tensor and tensor to detection kernels. They only depend on the
+// input size and the class names, so they can be exercised without a model.
+// The overloads taking a tensor reuse its capacity, and the intermediate
+// images are kept per thread, so a steady stream of frames allocates nothing.
+std::vector<float> preprocessStretch(const cv::Mat &image, const cv::Size &input_size);
+void preprocessStretch(const cv::Mat &image, const cv::Size &input_size, std::vector<float> &tensor);
+std::vector<float> preprocessLetterbox(const cv::Mat &image, const cv::Rect &region, const cv::Size &input_size, LetterboxTransform &transform);
+void preprocessLetterbox(const cv::Mat &image, const cv::Rect &region, const cv::Size &input_size, LetterboxTransform &transform, std::vector<float> &tensor);
+void packChannels(const cv::Mat &resized_image, std::vector<float> &tensor);
+void checkYuvFrame(const YuvFrame &frame);
+void preprocessYuv(const YuvFrame &frame, const cv::Size &input_size, std::vector<float> &tensor);
+
+std::vector<Detection> decodeDetections(const std::vector<float> &results, float confidence_threshold, int img_width, int img_height, int orig_width, int orig_height, const std::vector<std::string> &class_names);
+std::vector<Detection> decodeDetections(const std::vector<float> &results, float confidence_threshold, const LetterboxTransform &transform, const std::vector<std::string> &class_names);
+
+float boxIou(const cv::Rect &first, const cv::Rect &second);
+
+#endif // PREPROCESS_H
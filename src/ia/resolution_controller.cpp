@@ -0,0 +1,145 @@
+#include "resolution_controller.h"
+#include "metrics/metrics.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+    // Weight of the newest latency sample in the moving average
+    const double LATENCY_SMOOTHING = 0.2;
+}
+
+ResolutionController::ResolutionController(const ResolutionConfig &config)
+    : config(config),
+      current(0),
+      frames_since_decision(0),
+      latency_us(config.resolutions.size(), 0.0),
+      smallest_object(1.0)
+{
+    if (config.resolutions.empty() || !std::is_sorted(config.resolutions.begin(), config.resolutions.end()))
+    {
+        throw std::runtime_error("Resolutions must be a non-empty increasing list");
+    }
+
+    // Start at the configured resolution, or the closest one below it
+    for (size_t i = 0; i < config.resolutions.size(); ++i)
+    {
+        if (config.resolutions[i] <= config.initial_resolution)
+        {
+            current = i;
+        }
+    }
+}
+
+/*
+ * Function to detect objects at the current resolution and adapt it
+ *
+ * @param engine: engine with a dynamic input height and width
+ * @param image: BGR frame of the stream
+ * @param confidence_threshold: minimum confidence threshold
+ *
+ * @return: vector of Detection objects in frame coordinates
+ */
+std::vector<Detection> ResolutionController::detect(InferenceEngine &engine, const cv::Mat &image, float confidence_threshold)
+{
+    // Tensors are reused from frame to frame by every thread running a stream
+    thread_local std::vector<float> input_tensor_values;
+    thread_local std::vector<float> results;
+
+    const cv::Size input_size = inputSize();
+    engine.preprocessImage(image, input_size, input_tensor_values);
+
+    auto start = std::chrono::steady_clock::now();
+    engine.runInference(input_tensor_values, input_size, results);
+    auto latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    std::vector<Detection> detections = engine.filterDetections(results, confidence_threshold, input_size.width, input_size.height, image.cols, image.rows);
+    update(latency, detections, image.size());
+    return detections;
+}
+
+/*
+ * Function to feed the outcome of a frame to the controller
+ *
+ * @param latency: inference time of the frame at the current resolution
+ * @param detections: detections of the frame, in frame coordinates
+ * @param frame_size: size of the frame
+ */
+void ResolutionController::update(std::chrono::microseconds latency, const std::vector<Detection> &detections, const cv::Size &frame_size)
+{
+    double &average = latency_us[current];
+    average = average == 0.0 ? latency.count() : (1.0 - LATENCY_SMOOTHING) * average + LATENCY_SMOOTHING * latency.count();
+
+    // The frame is stretched to the input, so each axis is scaled on its own
+    for (const auto &detection : detections)
+    {
+        double side = std::min(static_cast<double>(detection.bbox.width) / frame_size.width, static_cast<double>(detection.bbox.height) / frame_size.height);
+        smallest_object = std::min(smallest_object, side);
+    }
+
+    if (++frames_since_decision >= config.decision_interval)
+    {
+        decide();
+        frames_since_decision = 0;
+        smallest_object = 1.0;
+    }
+}
+
+/*
+ * Function to estimate the latency at a resolution
+ *
+ * @param index: index of the resolution
+ *
+ * @return: measured average, or the current one scaled by the pixel count
+ */
+double ResolutionController::expectedLatency(size_t index) const
+{
+    if (latency_us[index] > 0.0)
+    {
+        return latency_us[index];
+    }
+
+    const double ratio = static_cast<double>(config.resolutions[index]) / config.resolutions[current];
+    return latency_us[current] * ratio * ratio;
+}
+
+void ResolutionController::decide()
+{
+    static Counter &up = MetricsRegistry::global().counter("yolov10_resolution_switches_total", "Network resolution changes", "direction=\"up\"");
+    static Counter &down = MetricsRegistry::global().counter("yolov10_resolution_switches_total", "Network resolution changes", "direction=\"down\"");
+
+    const double slo = static_cast<double>(config.latency_slo.count());
+    const double smallest_pixels = smallest_object * config.resolutions[current];
+
+    // Overloaded: go down whatever the objects need
+    if (latency_us[current] > slo && current > 0)
+    {
+        --current;
+        down.increment();
+    }
+    else if (smallest_pixels < config.min_object_pixels && current + 1 < config.resolutions.size() &&
+             expectedLatency(current + 1) <= slo * config.headroom)
+    {
+        ++current;
+        up.increment();
+    }
+    else if (smallest_object < 1.0 && current > 0 &&
+             smallest_object * config.resolutions[current - 1] >= 2.0 * config.min_object_pixels)
+    {
+        --current;
+        down.increment();
+    }
+
+    static Gauge &resolution_gauge = MetricsRegistry::global().gauge("yolov10_input_resolution", "Network resolution of the latest stream decision");
+    resolution_gauge.set(config.resolutions[current]);
+}
+
+int ResolutionController::resolution() const
+{
+    return config.resolutions[current];
+}
+
+cv::Size ResolutionController::inputSize() const
+{
+    return cv::Size(resolution(), resolution());
+}
@@ -0,0 +1,62 @@
+#ifndef RESOLUTION_CONTROLLER_H
+#define RESOLUTION_CONTROLLER_H
+
+#include "inference.h"
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <vector>
+
+struct ResolutionConfig
+{
+    // Square network resolutions to choose from, in increasing order
+    std::vector<int> resolutions{320, 480, 640, 960};
+    int initial_resolution = 640;
+
+    // Inference latency the stream must stay under
+    std::chrono::microseconds latency_slo{33000};
+    // A step up is only taken when the next resolution is expected to use
+    // at most this share of the SLO
+    double headroom = 0.8;
+
+    // Objects whose shorter side falls below this many network input pixels
+    // are missed often; the resolution goes up until the smallest recent
+    // object is above it, and down while it would still be twice as large
+    int min_object_pixels = 24;
+
+    // Frames between two decisions, so one odd frame does not flip the resolution
+    int decision_interval = 15;
+};
+
+
+// Picks the network resolution of one stream, for models exported with a
+// dynamic height and width. Small objects push the resolution up, a
+// latency above the SLO pushes it down, and large objects alone let it go
+// down to save compute. Every resolution should be in the engine's warm-up
+// so switching does not pay for memory planning.
+class ResolutionController
+{
+public:
+    explicit ResolutionController(const ResolutionConfig &config = ResolutionConfig());
+
+    std::vector<Detection> detect(InferenceEngine &engine, const cv::Mat &image, float confidence_threshold);
+    void update(std::chrono::microseconds latency, const std::vector<Detection> &detections, const cv::Size &frame_size);
+
+    int resolution() const;
+    cv::Size inputSize() const;
+
+private:
+    ResolutionConfig config;
+    size_t current;
+    int frames_since_decision;
+
+    // Smoothed latency per resolution, 0 until measured
+    std::vector<double> latency_us;
+    // Shorter side of the smallest object of the window, as a share of the frame
+    double smallest_object;
+
+    double expectedLatency(size_t index) const;
+    void decide();
+};
+
+
+#endif // RESOLUTION_CONTROLLER_H
@@ -0,0 +1,205 @@
+#include "roi.h"
+#include <stdexcept>
+
+const std::vector<RegionOfInterest> RoiConfig::NO_REGIONS;
+
+/*
+ * Function to build a region from an axis aligned rectangle
+ *
+ * @param name: name of the region
+ * @param rect: rectangle in frame coordinates
+ *
+ * @return: RegionOfInterest covering the rectangle
+ */
+RegionOfInterest RegionOfInterest::fromRect(const std::string &name, const cv::Rect &rect)
+{
+    return {
+        name,
+        {rect.tl(), cv::Point(rect.x + rect.width, rect.y), rect.br(), cv::Point(rect.x, rect.y + rect.height)},
+        rect};
+}
+
+/*
+ * Function to build a region from a polygon
+ *
+ * @param name: name of the region
+ * @param polygon: vertices in frame coordinates
+ *
+ * @return: RegionOfInterest whose bounds enclose the polygon
+ */
+RegionOfInterest RegionOfInterest::fromPolygon(const std::string &name, const std::vector<cv::Point> &polygon)
+{
+    if (polygon.size() < 3)
+    {
+        throw std::runtime_error("Region '" + name + "' needs at least 3 points");
+    }
+
+    return {name, polygon, cv::boundingRect(polygon)};
+}
+
+/*
+ * Function to check whether a detection belongs to the region
+ *
+ * @param bbox: bounding box in frame coordinates
+ *
+ * @return: true if the center of the box lies inside the polygon
+ */
+bool RegionOfInterest::contains(const cv::Rect &bbox) const
+{
+    cv::Point2f center(bbox.x + bbox.width * 0.5f, bbox.y + bbox.height * 0.5f);
+    return cv::pointPolygonTest(polygon, center, false) >= 0;
+}
+
+/*
+ * Function to load the regions of every source from a YAML or JSON file
+ *
+ * Expected layout:
+ *
+ *   sources:
+ *     - name: "cam0"
+ *       regions:
+ *         - { name: "door", rect: [ x, y, width, height ] }
+ *         - { name: "lane", polygon: [ x0, y0, x1, y1, x2, y2 ] }
+ *
+ * A source named "*" is used for any source without its own entry.
+ *
+ * @param config_path: path to the configuration file
+ *
+ * @return: RoiConfig with the parsed regions
+ */
+RoiConfig RoiConfig::load(const std::string &config_path)
+{
+    cv::FileStorage storage(config_path, cv::FileStorage::READ);
+    if (!storage.isOpened())
+    {
+        throw std::runtime_error("Could not open ROI config: " + config_path);
+    }
+
+    RoiConfig config;
+    cv::FileNode sources_node = storage["sources"];
+    if (!sources_node.isSeq())
+    {
+        throw std::runtime_error("ROI config has no 'sources' list: " + config_path);
+    }
+
+    for (const auto &source_node : sources_node)
+    {
+        std::string source = source_node["name"].string();
+        if (source.empty())
+        {
+            throw std::runtime_error("ROI config has a source without a name");
+        }
+
+        for (const auto &region_node : source_node["regions"])
+        {
+            std::string region_name = region_node["name"].string();
+            std::vector<int> values;
+
+            if (!region_node["rect"].empty())
+            {
+                region_node["rect"] >> values;
+                if (values.size() != 4)
+                {
+                    throw std::runtime_error("Region '" + region_name + "' rect needs 4 values");
+                }
+                config.addRegion(source, RegionOfInterest::fromRect(region_name, cv::Rect(values[0], values[1], values[2], values[3])));
+            }
+            else if (!region_node["polygon"].empty())
+            {
+                region_node["polygon"] >> values;
+                if (values.size() % 2 != 0)
+                {
+                    throw std::runtime_error("Region '" + region_name + "' polygon needs x, y pairs");
+                }
+
+                std::vector<cv::Point> polygon;
+                for (size_t i = 0; i < values.size(); i += 2)
+                {
+                    polygon.emplace_back(values[i], values[i + 1]);
+                }
+                config.addRegion(source, RegionOfInterest::fromPolygon(region_name, polygon));
+            }
+            else
+            {
+                throw std::runtime_error("Region '" + region_name + "' needs a rect or a polygon");
+            }
+        }
+    }
+
+    return config;
+}
+
+void RoiConfig::addRegion(const std::string &source, const RegionOfInterest &region)
+{
+    sources[source].push_back(region);
+}
+
+/*
+ * Function to get the regions configured for a source
+ *
+ * @param source: name of the camera or input
+ *
+ * @return: regions of the source, the "*" regions, or an empty list
+ */
+const std::vector<RegionOfInterest> &RoiConfig::regionsFor(const std::string &source) const
+{
+    auto it = sources.find(source);
+    if (it == sources.end())
+    {
+        it = sources.find("*");
+    }
+
+    return it == sources.end() ? NO_REGIONS : it->second;
+}
+
+bool RoiConfig::empty() const
+{
+    return sources.empty();
+}
+
+/*
+ * Function to run the detector only on the configured regions
+ *
+ * Each region's bounding box is letterboxed into the network input on its
+ * own, the detections are mapped back to frame coordinates and every box
+ * whose center falls outside the region polygon is dropped.
+ *
+ * @param engine: inference engine
+ * @param image: full camera frame
+ * @param regions: regions to process, the whole frame is used when empty
+ * @param confidence_threshold: minimum confidence threshold
+ *
+ * @return: vector of Detection objects in frame coordinates
+ */
+std::vector<Detection> detectRegions(InferenceEngine &engine, const cv::Mat &image, const std::vector<RegionOfInterest> &regions, float confidence_threshold)
+{
+    // Tensors are reused from frame to frame by every thread running the pipeline
+    thread_local std::vector<float> input_tensor_values;
+    thread_local std::vector<float> results;
+
+    if (regions.empty())
+    {
+        engine.preprocessImage(image, input_tensor_values);
+        engine.runInference(input_tensor_values, results);
+        const cv::Size input_size = engine.inputSize();
+        return engine.filterDetections(results, confidence_threshold, input_size.width, input_size.height, image.cols, image.rows);
+    }
+
+    std::vector<Detection> detections;
+    for (const auto &region : regions)
+    {
+        LetterboxTransform transform;
+        engine.preprocessRegion(image, region.bounds, transform, input_tensor_values);
+        engine.runInference(input_tensor_values, results);
+
+        for (auto &detection : engine.filterDetections(results, confidence_threshold, transform))
+        {
+            if (region.contains(detection.bbox))
+            {
+                detections.push_back(std::move(detection));
+            }
+        }
+    }
+
+    return detections;
+}
@@ -0,0 +1,44 @@
+#ifndef ROI_H
+#define ROI_H
+
+#include "inference.h"
+#include <opencv2/opencv.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+// A region of a camera frame the detector should look at. Rectangles are
+// stored as four point polygons so both kinds are handled the same way.
+struct RegionOfInterest
+{
+    std::string name;
+    std::vector<cv::Point> polygon;
+    cv::Rect bounds;
+
+    static RegionOfInterest fromRect(const std::string &name, const cv::Rect &rect);
+    static RegionOfInterest fromPolygon(const std::string &name, const std::vector<cv::Point> &polygon);
+
+    bool contains(const cv::Rect &bbox) const;
+};
+
+
+class RoiConfig
+{
+public:
+    static RoiConfig load(const std::string &config_path);
+
+    void addRegion(const std::string &source, const RegionOfInterest &region);
+    const std::vector<RegionOfInterest> &regionsFor(const std::string &source) const;
+    bool empty() const;
+
+private:
+    std::map<std::string, std::vector<RegionOfInterest>> sources;
+
+    static const std::vector<RegionOfInterest> NO_REGIONS;
+};
+
+
+std::vector<Detection> detectRegions(InferenceEngine &engine, const cv::Mat &image, const std::vector<RegionOfInterest> &regions, float confidence_threshold);
+
+
+#endif // ROI_H
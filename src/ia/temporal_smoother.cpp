@@ -0,0 +1,189 @@
+#include "temporal_smoother.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <tuple>
+
+namespace
+{
+    cv::Rect toRect(const cv::Rect2f &box)
+    {
+        return cv::Rect(static_cast<int>(std::lround(box.x)), static_cast<int>(std::lround(box.y)),
+                        std::max(1, static_cast<int>(std::lround(box.width))), std::max(1, static_cast<int>(std::lround(box.height))));
+    }
+
+    cv::Rect2f lerp(const cv::Rect2f &from, const cv::Rect2f &to, float t)
+    {
+        return cv::Rect2f(from.x + (to.x - from.x) * t, from.y + (to.y - from.y) * t,
+                          from.width + (to.width - from.width) * t, from.height + (to.height - from.height) * t);
+    }
+}
+
+TemporalSmoother::TemporalSmoother(const SmootherConfig &config)
+    : config(config),
+      last_ms(0.0),
+      previous_ms(0.0),
+      started(false)
+{
+}
+
+/*
+ * Function to take in the detections of an inferred frame
+ *
+ * Tracks are matched greedily, highest IoU first, against their box
+ * extrapolated to this frame, so fast objects still overlap their track.
+ *
+ * @param detections: detections of the frame
+ * @param timestamp_ms: time of the frame, increasing from call to call
+ */
+void TemporalSmoother::update(const std::vector<Detection> &detections, double timestamp_ms)
+{
+    if (started && timestamp_ms <= last_ms)
+    {
+        throw std::runtime_error("Smoother timestamps must increase");
+    }
+
+    const double elapsed_ms = timestamp_ms - last_ms;
+    std::vector<cv::Rect2f> predicted;
+    predicted.reserve(active.size());
+    for (const Track &track : active)
+    {
+        predicted.push_back(extrapolate(track, timestamp_ms));
+    }
+
+    std::vector<std::tuple<float, size_t, size_t>> candidates;
+    for (size_t t = 0; t < active.size(); ++t)
+    {
+        for (size_t d = 0; d < detections.size(); ++d)
+        {
+            if (active[t].detection.class_id != detections[d].class_id)
+            {
+                continue;
+            }
+            const float iou = boxIou(toRect(predicted[t]), detections[d].bbox);
+            if (iou >= config.match_iou)
+            {
+                candidates.emplace_back(iou, t, d);
+            }
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const auto &a, const auto &b)
+              { return std::get<0>(a) > std::get<0>(b); });
+
+    std::vector<bool> track_matched(active.size(), false);
+    std::vector<bool> detection_matched(detections.size(), false);
+    for (const auto &candidate : candidates)
+    {
+        const size_t t = std::get<1>(candidate);
+        const size_t d = std::get<2>(candidate);
+        if (track_matched[t] || detection_matched[d])
+        {
+            continue;
+        }
+        track_matched[t] = true;
+        detection_matched[d] = true;
+
+        Track &track = active[t];
+        const cv::Rect2f box(detections[d].bbox);
+        const float dt = static_cast<float>(elapsed_ms);
+        const cv::Vec4f measured((box.x - track.box.x) / dt, (box.y - track.box.y) / dt,
+                                 (box.width - track.box.width) / dt, (box.height - track.box.height) / dt);
+        // The first measurement is taken as is, a zero velocity is no prior
+        track.velocity = track.has_previous ? config.velocity_smoothing * measured + (1.0f - config.velocity_smoothing) * track.velocity : measured;
+        track.previous_box = track.box;
+        track.has_previous = true;
+        track.box = box;
+        track.detection = detections[d];
+        track.missed = 0;
+    }
+
+    // Unmatched tracks coast at their velocity until they have missed too many inferences
+    std::vector<Track> kept;
+    kept.reserve(active.size() + detections.size());
+    for (size_t t = 0; t < active.size(); ++t)
+    {
+        Track &track = active[t];
+        if (!track_matched[t])
+        {
+            if (++track.missed > config.max_missed)
+            {
+                continue;
+            }
+            track.previous_box = track.box;
+            track.has_previous = true;
+            track.box = predicted[t];
+        }
+        kept.push_back(track);
+    }
+    for (size_t d = 0; d < detections.size(); ++d)
+    {
+        if (!detection_matched[d])
+        {
+            kept.push_back(Track{detections[d], cv::Rect2f(detections[d].bbox), cv::Rect2f(), false, cv::Vec4f(), 0});
+        }
+    }
+    active = std::move(kept);
+
+    previous_ms = started ? last_ms : timestamp_ms;
+    last_ms = timestamp_ms;
+    started = true;
+}
+
+/*
+ * Function to get the detections of a frame that was not inferred
+ *
+ * A frame after the last inference is extrapolated from it. A frame
+ * between the last two inferences is interpolated between them; objects
+ * first seen by the last one are left out, as they may not be there yet.
+ *
+ * @param timestamp_ms: time of the frame
+ *
+ * @return: vector of Detection objects, empty before the first update
+ */
+std::vector<Detection> TemporalSmoother::predict(double timestamp_ms) const
+{
+    std::vector<Detection> detections;
+    detections.reserve(active.size());
+    for (const Track &track : active)
+    {
+        cv::Rect2f box;
+        if (timestamp_ms >= last_ms)
+        {
+            box = extrapolate(track, timestamp_ms);
+        }
+        else if (track.has_previous)
+        {
+            const double t = std::max(0.0, (timestamp_ms - previous_ms) / (last_ms - previous_ms));
+            box = lerp(track.previous_box, track.box, static_cast<float>(t));
+        }
+        else
+        {
+            continue;
+        }
+
+        Detection detection = track.detection;
+        detection.bbox = toRect(box);
+        detections.push_back(std::move(detection));
+    }
+    return detections;
+}
+
+void TemporalSmoother::reset()
+{
+    active.clear();
+    last_ms = 0.0;
+    previous_ms = 0.0;
+    started = false;
+}
+
+size_t TemporalSmoother::tracks() const
+{
+    return active.size();
+}
+
+cv::Rect2f TemporalSmoother::extrapolate(const Track &track, double timestamp_ms) const
+{
+    const float dt = static_cast<float>(std::min(timestamp_ms - last_ms, config.max_extrapolation_ms));
+    return cv::Rect2f(track.box.x + track.velocity[0] * dt, track.box.y + track.velocity[1] * dt,
+                      std::max(1.0f, track.box.width + track.velocity[2] * dt), std::max(1.0f, track.box.height + track.velocity[3] * dt));
+}
@@ -0,0 +1,69 @@
+#ifndef TEMPORAL_SMOOTHER_H
+#define TEMPORAL_SMOOTHER_H
+
+#include "inference.h"
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+struct SmootherConfig
+{
+    // A detection continues a track of the same class when it overlaps the
+    // track's predicted box by at least this IoU
+    float match_iou = 0.3f;
+
+    // Weight of the newest measurement in the velocity of a track
+    float velocity_smoothing = 0.6f;
+
+    // A track missing from this many inferences in a row is dropped; until
+    // then it keeps moving at its last velocity
+    int max_missed = 1;
+
+    // Boxes are not moved further than this past the inference they come
+    // from, a stale velocity would send them off course
+    double max_extrapolation_ms = 500.0;
+};
+
+
+// Fills in the detections of the frames that were not inferred, so a
+// stream inferred every few frames still yields a box per object on every
+// frame. Detections of consecutive inferences are linked into tracks by
+// IoU, and each track keeps a velocity for its center and size.
+//
+// Frames after the last inference are extrapolated at once. A consumer
+// that can hold frames back until the next inference gets them
+// interpolated between the two inferences instead, which follows turns.
+class TemporalSmoother
+{
+public:
+    explicit TemporalSmoother(const SmootherConfig &config = SmootherConfig());
+
+    void update(const std::vector<Detection> &detections, double timestamp_ms);
+    std::vector<Detection> predict(double timestamp_ms) const;
+
+    void reset();
+    size_t tracks() const;
+
+private:
+    struct Track
+    {
+        Detection detection;
+        cv::Rect2f box;
+        // Box at the inference before, if the track existed then
+        cv::Rect2f previous_box;
+        bool has_previous;
+        // Change of x, y, width and height per millisecond
+        cv::Vec4f velocity;
+        int missed;
+    };
+
+    SmootherConfig config;
+    std::vector<Track> active;
+    double last_ms;
+    double previous_ms;
+    bool started;
+
+    cv::Rect2f extrapolate(const Track &track, double timestamp_ms) const;
+};
+
+
+#endif // TEMPORAL_SMOOTHER_H
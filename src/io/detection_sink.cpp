@@ -0,0 +1,425 @@
+#include "detection_sink.h"
+#include "metrics/trace.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+    void appendEscaped(std::string &out, const std::string &value)
+    {
+        for (char c : value)
+        {
+            switch (c)
+            {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out += escaped;
+                }
+                else
+                {
+                    out += c;
+                }
+            }
+        }
+    }
+
+    // RFC 4180 field: quoted, with embedded quotes doubled
+    void appendCsvField(std::string &out, const std::string &value)
+    {
+        out += '"';
+        for (char c : value)
+        {
+            if (c == '"')
+            {
+                out += '"';
+            }
+            out += c;
+        }
+        out += '"';
+    }
+
+    template <typename T>
+    void appendRaw(std::string &out, T value)
+    {
+        out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    std::string extensionOf(const std::string &path)
+    {
+        size_t dot = path.find_last_of('.');
+        return dot == std::string::npos ? "" : path.substr(dot + 1);
+    }
+}
+
+/*
+ * Function to open a buffered sink
+ *
+ * @param path: output file, "-" writes to the standard output
+ * @param buffer_capacity: bytes kept in memory before they are handed to the stream
+ */
+BufferedStreamSink::BufferedStreamSink(const std::string &path, size_t buffer_capacity)
+    : stream(&std::cout),
+      buffer_capacity(buffer_capacity)
+{
+    if (path != "-")
+    {
+        file.open(path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Could not open output file: " + path);
+        }
+        stream = &file;
+    }
+
+    buffer.reserve(buffer_capacity + 4096);
+}
+
+void BufferedStreamSink::write(const DetectionRecord &record)
+{
+    format(record, buffer);
+    if (buffer.size() >= buffer_capacity)
+    {
+        drain();
+    }
+}
+
+void BufferedStreamSink::flush()
+{
+    drain();
+    stream->flush();
+}
+
+void BufferedStreamSink::drain()
+{
+    if (buffer.empty())
+    {
+        return;
+    }
+
+    stream->write(buffer.data(), buffer.size());
+    if (!*stream)
+    {
+        throw std::runtime_error("Could not write detections");
+    }
+    buffer.clear();
+}
+
+void TextSink::format(const DetectionRecord &record, std::string &out)
+{
+    char line[128];
+    for (const auto &detection : record.detections)
+    {
+        std::snprintf(line, sizeof(line), "Class ID: %d Confidence: %g BBox: [%d, %d, %d, %d] Class Name: ",
+                      detection.class_id, detection.confidence,
+                      detection.bbox.x, detection.bbox.y, detection.bbox.width, detection.bbox.height);
+        out += line;
+        out += detection.class_name;
+        out += '\n';
+    }
+}
+
+/*
+ * Function to format a record as a JSON object
+ *
+ * {"source":"cam0","frame":12,"timestamp_ms":400.0,"width":1920,"height":1080,
+ *  "detections":[{"class_id":0,"class_name":"person","confidence":0.91,"bbox":[x,y,w,h]}]}
+ *
+ * @param record: record to format
+ * @param out: string the object is appended to
+ */
+void formatJson(const DetectionRecord &record, std::string &out)
+{
+    char number[96];
+
+    out += "{\"source\":\"";
+    appendEscaped(out, record.source);
+    std::snprintf(number, sizeof(number), "\",\"frame\":%lld,\"timestamp_ms\":%.3f,\"width\":%d,\"height\":%d,\"detections\":[",
+                  static_cast<long long>(record.frame_index), record.timestamp_ms, record.width, record.height);
+    out += number;
+
+    for (size_t i = 0; i < record.detections.size(); ++i)
+    {
+        const Detection &detection = record.detections[i];
+        std::snprintf(number, sizeof(number), "%s{\"class_id\":%d,\"class_name\":\"", i == 0 ? "" : ",", detection.class_id);
+        out += number;
+        appendEscaped(out, detection.class_name);
+        std::snprintf(number, sizeof(number), "\",\"confidence\":%.4f,\"bbox\":[%d,%d,%d,%d]}",
+                      detection.confidence, detection.bbox.x, detection.bbox.y, detection.bbox.width, detection.bbox.height);
+        out += number;
+    }
+
+    out += "]}";
+}
+
+void JsonlSink::format(const DetectionRecord &record, std::string &out)
+{
+    formatJson(record, out);
+    out += '\n';
+}
+
+CsvSink::CsvSink(const std::string &path, size_t buffer_capacity)
+    : BufferedStreamSink(path, buffer_capacity)
+{
+    buffer += "source,frame,timestamp_ms,class_id,class_name,confidence,x,y,width,height\n";
+}
+
+void CsvSink::format(const DetectionRecord &record, std::string &out)
+{
+    std::string source;
+    appendCsvField(source, record.source);
+
+    char line[160];
+    for (const auto &detection : record.detections)
+    {
+        std::snprintf(line, sizeof(line), ",%lld,%.3f,%d,",
+                      static_cast<long long>(record.frame_index), record.timestamp_ms, detection.class_id);
+        out += source;
+        out += line;
+        appendCsvField(out, detection.class_name);
+        std::snprintf(line, sizeof(line), ",%.4f,%d,%d,%d,%d\n",
+                      detection.confidence, detection.bbox.x, detection.bbox.y, detection.bbox.width, detection.bbox.height);
+        out += line;
+    }
+}
+
+/*
+ * The binary file starts with the uint32 MAGIC and VERSION, followed by
+ * records of the form
+ *
+ *   uint32 payload_size
+ *   int64  frame_index
+ *   double timestamp_ms
+ *   int32  width, height
+ *   uint16 source_length, char source[source_length]
+ *   uint32 count
+ *   count x { int32 class_id, float confidence, int32 x, y, width, height }
+ *
+ * so readers can skip whole records without parsing them.
+ */
+BinarySink::BinarySink(const std::string &path, size_t buffer_capacity)
+    : BufferedStreamSink(path, buffer_capacity)
+{
+    appendRaw(buffer, MAGIC);
+    appendRaw(buffer, VERSION);
+}
+
+void BinarySink::format(const DetectionRecord &record, std::string &out)
+{
+    const uint16_t source_length = static_cast<uint16_t>(std::min<size_t>(record.source.size(), UINT16_MAX));
+    const uint32_t count = static_cast<uint32_t>(record.detections.size());
+    const uint32_t payload_size = sizeof(int64_t) + sizeof(double) + 2 * sizeof(int32_t) + sizeof(uint16_t) + source_length + sizeof(uint32_t) + count * 6 * sizeof(int32_t);
+
+    appendRaw(out, payload_size);
+    appendRaw(out, static_cast<int64_t>(record.frame_index));
+    appendRaw(out, record.timestamp_ms);
+    appendRaw(out, static_cast<int32_t>(record.width));
+    appendRaw(out, static_cast<int32_t>(record.height));
+    appendRaw(out, source_length);
+    out.append(record.source.data(), source_length);
+    appendRaw(out, count);
+
+    for (const auto &detection : record.detections)
+    {
+        appendRaw(out, static_cast<int32_t>(detection.class_id));
+        appendRaw(out, detection.confidence);
+        appendRaw(out, static_cast<int32_t>(detection.bbox.x));
+        appendRaw(out, static_cast<int32_t>(detection.bbox.y));
+        appendRaw(out, static_cast<int32_t>(detection.bbox.width));
+        appendRaw(out, static_cast<int32_t>(detection.bbox.height));
+    }
+}
+
+/*
+ * Function to start the background writer
+ *
+ * @param sink: sink the records are written to
+ * @param capacity: records queued before write blocks
+ */
+AsyncSinkWriter::AsyncSinkWriter(std::unique_ptr<DetectionSink> sink, size_t capacity)
+    : sink(std::move(sink)),
+      capacity(std::max<size_t>(1, capacity)),
+      writing(false),
+      stopping(false)
+{
+    worker = std::thread(&AsyncSinkWriter::run, this);
+}
+
+AsyncSinkWriter::~AsyncSinkWriter()
+{
+    try
+    {
+        close();
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+    }
+}
+
+void AsyncSinkWriter::write(const DetectionRecord &record)
+{
+    write(DetectionRecord(record));
+}
+
+/*
+ * Function to queue a record for the background writer
+ *
+ * Blocks while the queue is full, so a slow disk slows the caller down
+ * instead of growing memory.
+ *
+ * @param record: record to write, moved into the queue
+ */
+void AsyncSinkWriter::write(DetectionRecord &&record)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        space_cv.wait(lock, [this]
+                      { return pending.size() < capacity || stopping || error; });
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+        if (stopping)
+        {
+            throw std::runtime_error("Detection writer is closed");
+        }
+        pending.push_back(std::move(record));
+    }
+    pending_cv.notify_one();
+}
+
+/*
+ * Function to wait until every queued record reached the underlying sink
+ */
+void AsyncSinkWriter::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    idle_cv.wait(lock, [this]
+                 { return (pending.empty() && !writing) || error; });
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+    sink->flush();
+}
+
+/*
+ * Function to drain the queue and stop the background writer
+ */
+void AsyncSinkWriter::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!worker.joinable())
+        {
+            return;
+        }
+        stopping = true;
+    }
+    pending_cv.notify_one();
+    space_cv.notify_all();
+    worker.join();
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+    sink->flush();
+}
+
+void AsyncSinkWriter::run()
+{
+    Tracer::global().setThreadName("sink writer");
+
+    std::vector<DetectionRecord> batch;
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true)
+    {
+        pending_cv.wait(lock, [this]
+                        { return !pending.empty() || stopping; });
+        if (pending.empty() && stopping)
+        {
+            break;
+        }
+
+        batch.swap(pending);
+        writing = true;
+        lock.unlock();
+        space_cv.notify_all();
+
+        std::exception_ptr failure;
+        try
+        {
+            for (const auto &record : batch)
+            {
+                sink->write(record);
+            }
+        }
+        catch (...)
+        {
+            failure = std::current_exception();
+        }
+        batch.clear();
+
+        lock.lock();
+        writing = false;
+        if (failure)
+        {
+            // Later records are dropped, the caller hears about the first error
+            error = failure;
+            pending.clear();
+            space_cv.notify_all();
+            idle_cv.notify_all();
+            break;
+        }
+        idle_cv.notify_all();
+    }
+}
+
+/*
+ * Function to create a sink from a path and an optional format name
+ *
+ * @param path: output file, "-" writes to the standard output
+ * @param format: text, jsonl, csv or binary; guessed from the extension when empty
+ *
+ * @return: the sink
+ */
+std::unique_ptr<DetectionSink> createDetectionSink(const std::string &path, const std::string &format)
+{
+    std::string kind = format.empty() ? extensionOf(path) : format;
+
+    if (kind == "jsonl" || kind == "json")
+    {
+        return std::make_unique<JsonlSink>(path);
+    }
+    if (kind == "csv")
+    {
+        return std::make_unique<CsvSink>(path);
+    }
+    if (kind == "binary" || kind == "bin")
+    {
+        return std::make_unique<BinarySink>(path);
+    }
+    if (kind == "text" || kind == "txt" || (format.empty() && path == "-"))
+    {
+        return std::make_unique<TextSink>(path);
+    }
+
+    throw std::runtime_error("Unknown output format for: " + path);
+}
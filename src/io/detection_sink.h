@@ -0,0 +1,144 @@
+#ifndef DETECTION_SINK_H
+#define DETECTION_SINK_H
+
+#include "ia/inference.h"
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Detections of one frame together with where they came from
+struct DetectionRecord
+{
+    std::string source;
+    int64_t frame_index;
+    double timestamp_ms;
+    int width;
+    int height;
+    std::vector<Detection> detections;
+};
+
+
+class DetectionSink
+{
+public:
+    virtual ~DetectionSink() = default;
+
+    virtual void write(const DetectionRecord &record) = 0;
+    virtual void flush() = 0;
+};
+
+
+// Formats records into a large in-memory buffer and hands it to the stream
+// in big chunks; nothing is flushed per line.
+class BufferedStreamSink : public DetectionSink
+{
+public:
+    explicit BufferedStreamSink(const std::string &path, size_t buffer_capacity = 1 << 20);
+
+    void write(const DetectionRecord &record) override;
+    void flush() override;
+
+protected:
+    virtual void format(const DetectionRecord &record, std::string &out) = 0;
+
+    std::string buffer;
+
+private:
+    std::ofstream file;
+    std::ostream *stream;
+    size_t buffer_capacity;
+
+    void drain();
+};
+
+
+// Legacy human readable lines, one per detection
+class TextSink : public BufferedStreamSink
+{
+public:
+    using BufferedStreamSink::BufferedStreamSink;
+
+protected:
+    void format(const DetectionRecord &record, std::string &out) override;
+};
+
+
+// One JSON object per frame and line
+class JsonlSink : public BufferedStreamSink
+{
+public:
+    using BufferedStreamSink::BufferedStreamSink;
+
+protected:
+    void format(const DetectionRecord &record, std::string &out) override;
+};
+
+
+// One row per detection with a header line
+class CsvSink : public BufferedStreamSink
+{
+public:
+    explicit CsvSink(const std::string &path, size_t buffer_capacity = 1 << 20);
+
+protected:
+    void format(const DetectionRecord &record, std::string &out) override;
+};
+
+
+// Compact length prefixed records in host byte order
+class BinarySink : public BufferedStreamSink
+{
+public:
+    explicit BinarySink(const std::string &path, size_t buffer_capacity = 1 << 20);
+
+    static constexpr uint32_t MAGIC = 0x54454459; // "YDET"
+    static constexpr uint32_t VERSION = 1;
+
+protected:
+    void format(const DetectionRecord &record, std::string &out) override;
+};
+
+
+// Moves writing to a background thread so the caller only waits on I/O once
+// capacity records are queued. The first error of the underlying sink stops
+// the writer and is rethrown from the next write, flush or close.
+class AsyncSinkWriter : public DetectionSink
+{
+public:
+    explicit AsyncSinkWriter(std::unique_ptr<DetectionSink> sink, size_t capacity = 4096);
+    ~AsyncSinkWriter() override;
+
+    void write(const DetectionRecord &record) override;
+    void write(DetectionRecord &&record);
+    void flush() override;
+    void close();
+
+private:
+    std::unique_ptr<DetectionSink> sink;
+    size_t capacity;
+    std::mutex mutex;
+    std::condition_variable pending_cv;
+    std::condition_variable space_cv;
+    std::condition_variable idle_cv;
+    std::vector<DetectionRecord> pending;
+    bool writing;
+    bool stopping;
+    std::exception_ptr error;
+    std::thread worker;
+
+    void run();
+};
+
+
+void formatJson(const DetectionRecord &record, std::string &out);
+std::unique_ptr<DetectionSink> createDetectionSink(const std::string &path, const std::string &format = "");
+
+
+#endif // DETECTION_SINK_H
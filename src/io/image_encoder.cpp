@@ -0,0 +1,225 @@
+#include "image_encoder.h"
+#include "metrics/metrics.h"
+#include "metrics/trace.h"
+#include "system/cpu_topology.h"
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+
+AsyncImageEncoder::AsyncImageEncoder(const EncoderOptions &options)
+    : options(options),
+      active(0),
+      stopping(false),
+      dropped_images(0),
+      queue_depth(queueDepthGauge("encoder")),
+      dropped_frames(MetricsRegistry::global().counter("yolov10_dropped_frames_total", "Frames dropped because a queue was full", "queue=\"encoder\""))
+{
+    this->options.threads = std::max(1, options.threads);
+    this->options.queue_capacity = std::max<size_t>(1, options.queue_capacity);
+    this->options.jpeg_quality = std::min(100, std::max(1, options.jpeg_quality));
+
+    for (int i = 0; i < this->options.threads; ++i)
+    {
+        workers.emplace_back(&AsyncImageEncoder::run, this);
+    }
+}
+
+AsyncImageEncoder::~AsyncImageEncoder()
+{
+    try
+    {
+        close();
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+    }
+}
+
+/*
+ * Function to queue an image for encoding
+ *
+ * The encoder keeps a reference to the pixels instead of copying them, so
+ * the caller must not draw on the image after submitting it.
+ *
+ * @param image: image to encode
+ * @param path: output file, the extension selects the format
+ *
+ * @return: false if the queue was full and the image was dropped
+ */
+bool AsyncImageEncoder::submit(const cv::Mat &image, const std::string &path)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (stopping)
+    {
+        throw std::runtime_error("Image encoder is closed");
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+
+    if (jobs.size() >= options.queue_capacity)
+    {
+        if (options.drop_when_full)
+        {
+            ++dropped_images;
+            dropped_frames.increment();
+            return false;
+        }
+        space_cv.wait(lock, [this]
+                      { return jobs.size() < options.queue_capacity || stopping; });
+        if (stopping)
+        {
+            throw std::runtime_error("Image encoder is closed");
+        }
+    }
+
+    jobs.push_back({image, path});
+    queue_depth.set(static_cast<int64_t>(jobs.size()));
+    lock.unlock();
+    job_cv.notify_one();
+
+    return true;
+}
+
+/*
+ * Function to wait until every queued image has been written
+ */
+void AsyncImageEncoder::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    idle_cv.wait(lock, [this]
+                 { return jobs.empty() && active == 0; });
+}
+
+/*
+ * Function to write the remaining images and stop the workers
+ *
+ * Rethrows the first error of the workers, once.
+ */
+void AsyncImageEncoder::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    job_cv.notify_all();
+    space_cv.notify_all();
+
+    for (auto &worker : workers)
+    {
+        if (worker.joinable())
+        {
+            worker.join();
+        }
+    }
+    workers.clear();
+
+    std::exception_ptr failure;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        failure.swap(error);
+    }
+    if (failure)
+    {
+        std::rethrow_exception(failure);
+    }
+}
+
+size_t AsyncImageEncoder::dropped() const
+{
+    return dropped_images.load();
+}
+
+void AsyncImageEncoder::run()
+{
+    Tracer::global().setThreadName("image encoder");
+    pinCurrentThread(options.cpus);
+
+    // Reused for every image handled by this worker
+    cv::Mat scaled;
+    std::vector<uchar> encoded;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        job_cv.wait(lock, [this]
+                    { return !jobs.empty() || stopping; });
+        if (jobs.empty())
+        {
+            break;
+        }
+
+        Job job = std::move(jobs.front());
+        jobs.pop_front();
+        queue_depth.set(static_cast<int64_t>(jobs.size()));
+        ++active;
+        lock.unlock();
+        space_cv.notify_one();
+
+        std::exception_ptr failure;
+        try
+        {
+            encode(job, scaled, encoded);
+        }
+        catch (...)
+        {
+            failure = std::current_exception();
+        }
+        job.image.release();
+
+        lock.lock();
+        if (failure && !error)
+        {
+            error = failure;
+        }
+        --active;
+        if (jobs.empty() && active == 0)
+        {
+            idle_cv.notify_all();
+        }
+    }
+}
+
+/*
+ * Function to encode an image into the recycled buffer and write it to disk
+ *
+ * @param job: image and output path
+ * @param scaled: reusable buffer for the downscaled image
+ * @param encoded: reusable buffer for the compressed bytes
+ */
+void AsyncImageEncoder::encode(const Job &job, cv::Mat &scaled, std::vector<uchar> &encoded) const
+{
+    static Histogram &encode_seconds = stageHistogram("encode");
+    ScopedTimer timer(encode_seconds, "encode");
+
+    const cv::Mat *image = &job.image;
+    if (options.scale > 0 && options.scale < 1.0)
+    {
+        cv::resize(job.image, scaled, cv::Size(), options.scale, options.scale, cv::INTER_AREA);
+        image = &scaled;
+    }
+
+    size_t dot = job.path.find_last_of('.');
+    std::string extension = dot == std::string::npos ? ".jpg" : job.path.substr(dot);
+
+    if (!cv::imencode(extension, *image, encoded, {cv::IMWRITE_JPEG_QUALITY, options.jpeg_quality}))
+    {
+        throw std::runtime_error("Could not encode the image: " + job.path);
+    }
+
+    FILE *file = std::fopen(job.path.c_str(), "wb");
+    if (!file)
+    {
+        throw std::runtime_error("Could not open output file: " + job.path);
+    }
+    size_t written = std::fwrite(encoded.data(), 1, encoded.size(), file);
+
+    // A full disk may only show when the buffered bytes are flushed
+    if (std::fclose(file) != 0 || written != encoded.size())
+    {
+        throw std::runtime_error("Could not write the image: " + job.path);
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef IMAGE_ENCODER_H
+#define IMAGE_ENCODER_H
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class Counter;
+class Gauge;
+
+struct EncoderOptions
+{
+    int threads = 2;
+    size_t queue_capacity = 8;
+    int jpeg_quality = 90;
+    double scale = 1.0;
+    bool drop_when_full = false;
+    std::vector<int> cpus;
+};
+
+
+// Encodes and writes annotated images on a pool of background threads. The
+// queue is bounded: submit blocks (or drops the image) once it is full, so a
+// slow disk applies backpressure instead of growing memory. The first image
+// that could not be encoded or written is reported by the next submit or by
+// close.
+class AsyncImageEncoder
+{
+public:
+    explicit AsyncImageEncoder(const EncoderOptions &options = EncoderOptions());
+    ~AsyncImageEncoder();
+
+    bool submit(const cv::Mat &image, const std::string &path);
+    void wait();
+    void close();
+
+    size_t dropped() const;
+
+private:
+    struct Job
+    {
+        cv::Mat image;
+        std::string path;
+    };
+
+    EncoderOptions options;
+    std::mutex mutex;
+    std::condition_variable job_cv;
+    std::condition_variable space_cv;
+    std::condition_variable idle_cv;
+    std::deque<Job> jobs;
+    size_t active;
+    bool stopping;
+    std::exception_ptr error;
+    std::atomic<size_t> dropped_images;
+    Gauge &queue_depth;
+    Counter &dropped_frames;
+    std::vector<std::thread> workers;
+
+    void run();
+    void encode(const Job &job, cv::Mat &scaled, std::vector<uchar> &encoded) const;
+};
+
+
+#endif // IMAGE_ENCODER_H
@@ -0,0 +1,267 @@
+#include "video_indexer.h"
+#include "metrics/metrics.h"
+#include "metrics/trace.h"
+#ifdef YOLOV10_WITH_FFMPEG
+#include "video_source.h"
+#endif
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+    // A target closer than this is reached by decoding forward: a seek
+    // restarts at the keyframe before it and would decode about as much
+    const double SEEK_GAP_MS = 1000.0;
+
+    Counter &sampledFramesCounter()
+    {
+        static Counter &counter = MetricsRegistry::global().counter("yolov10_index_frames_sampled_total", "Video frames sampled by the offline indexer");
+        return counter;
+    }
+
+    struct SampledFrame
+    {
+        int64_t index = 0;
+        double timestamp_ms = 0.0;
+        int width = 0;
+        int height = 0;
+    };
+
+    // Walks a video and hands out the frames to index, already turned into a network input
+    class FrameSampler
+    {
+    public:
+        virtual ~FrameSampler() = default;
+
+        virtual bool next(InferenceEngine &engine, SampledFrame &sampled, std::vector<float> &tensor) = 0;
+        virtual double durationMs() const = 0;
+    };
+
+#ifdef YOLOV10_WITH_FFMPEG
+    // Keyframes are sampled without sending any other packet to the decoder;
+    // intervals seek to the keyframe before each target and decode up to it
+    class LibavSampler : public FrameSampler
+    {
+    public:
+        LibavSampler(const std::string &path, const VideoIndexConfig &config)
+            : mode(config.mode),
+              interval_ms(config.interval_seconds * 1000.0),
+              target_ms(0.0),
+              position_ms(0.0),
+              source(path, sourceConfig(config))
+        {
+        }
+
+        bool next(InferenceEngine &engine, SampledFrame &sampled, std::vector<float> &tensor) override
+        {
+            // A stream that cannot seek is decoded forward instead
+            if (mode == SamplingMode::Interval && target_ms - position_ms > SEEK_GAP_MS)
+            {
+                source.seek(target_ms);
+            }
+
+            // Half a frame early is still on time
+            const double tolerance_ms = 500.0 / std::max(source.frameRate(), 1.0);
+            while (source.read(frame))
+            {
+                position_ms = frame.timestamp_ms;
+                if (mode == SamplingMode::Interval && frame.timestamp_ms < target_ms - tolerance_ms)
+                {
+                    continue;
+                }
+
+                if (frame.has_yuv)
+                {
+                    engine.preprocessImage(frame.yuv, tensor);
+                }
+                else
+                {
+                    engine.preprocessImage(frame.bgr, tensor);
+                }
+                sampled = {frame.index, frame.timestamp_ms, frame.width(), frame.height()};
+                target_ms = frame.timestamp_ms + interval_ms;
+                return true;
+            }
+            return false;
+        }
+
+        double durationMs() const override
+        {
+            return source.durationMs();
+        }
+
+    private:
+        SamplingMode mode;
+        double interval_ms;
+        double target_ms;
+        double position_ms;
+        VideoSource source;
+        VideoFrame frame;
+
+        static VideoSourceConfig sourceConfig(const VideoIndexConfig &config)
+        {
+            VideoSourceConfig source_config;
+            source_config.mode = config.mode == SamplingMode::Keyframes ? DecodeMode::Keyframes : DecodeMode::AllFrames;
+            source_config.threads = config.decode_threads;
+            return source_config;
+        }
+    };
+#endif
+
+    // OpenCV cannot tell keyframes apart, so this one only samples by
+    // interval, seeking by timestamp when the next target is far
+    class CaptureSampler : public FrameSampler
+    {
+    public:
+        CaptureSampler(const std::string &path, const VideoIndexConfig &config)
+            : interval_ms(config.interval_seconds * 1000.0),
+              target_ms(0.0),
+              capture(path)
+        {
+            if (!capture.isOpened())
+            {
+                throw std::runtime_error("Could not open the video: " + path);
+            }
+            frame_rate = capture.get(cv::CAP_PROP_FPS);
+        }
+
+        bool next(InferenceEngine &engine, SampledFrame &sampled, std::vector<float> &tensor) override
+        {
+            {
+                static Histogram &decode_seconds = stageHistogram("decode");
+                ScopedTimer timer(decode_seconds, "decode");
+
+                if (target_ms - capture.get(cv::CAP_PROP_POS_MSEC) > SEEK_GAP_MS)
+                {
+                    capture.set(cv::CAP_PROP_POS_MSEC, target_ms);
+                }
+
+                const double tolerance_ms = 500.0 / std::max(frame_rate, 1.0);
+                bool found = false;
+                while (!found && capture.grab())
+                {
+                    if (capture.get(cv::CAP_PROP_POS_MSEC) >= target_ms - tolerance_ms)
+                    {
+                        found = capture.retrieve(image) && !image.empty();
+                    }
+                }
+                if (!found)
+                {
+                    return false;
+                }
+            }
+
+            const double timestamp_ms = capture.get(cv::CAP_PROP_POS_MSEC);
+            engine.preprocessImage(image, tensor);
+            sampled = {std::llround(capture.get(cv::CAP_PROP_POS_FRAMES)) - 1, timestamp_ms, image.cols, image.rows};
+            target_ms = timestamp_ms + interval_ms;
+            return true;
+        }
+
+        double durationMs() const override
+        {
+            return frame_rate > 0.0 ? capture.get(cv::CAP_PROP_FRAME_COUNT) * 1000.0 / frame_rate : 0.0;
+        }
+
+    private:
+        double interval_ms;
+        double target_ms;
+        double frame_rate;
+        cv::VideoCapture capture;
+        cv::Mat image;
+    };
+
+    std::unique_ptr<FrameSampler> createSampler(const std::string &path, const VideoIndexConfig &config)
+    {
+#ifdef YOLOV10_WITH_FFMPEG
+        return std::make_unique<LibavSampler>(path, config);
+#else
+        return std::make_unique<CaptureSampler>(path, config);
+#endif
+    }
+}
+
+/*
+ * Function to write the detections of a sample of the frames of a video file
+ *
+ * Only the sampled frames are decoded where the stream allows it, so the
+ * cost follows the number of samples rather than the length of the video.
+ * They are run through the engine in batches of config.batch_size. Without
+ * libavcodec the video is read with OpenCV and only interval sampling works.
+ *
+ * @param engine: inference engine
+ * @param path: video file
+ * @param source: source name given to the records
+ * @param sink: receives one record per sampled frame, with its index and timestamp
+ * @param config: sampling and batching settings
+ *
+ * @return: number of frames sampled, length of the video and time taken
+ */
+VideoIndexStats indexVideo(InferenceEngine &engine, const std::string &path, const std::string &source, DetectionSink &sink, const VideoIndexConfig &config)
+{
+    if (config.batch_size == 0)
+    {
+        throw std::runtime_error("Index batch size must be at least 1");
+    }
+    if (config.mode == SamplingMode::Interval && config.interval_seconds <= 0.0)
+    {
+        throw std::runtime_error("Index interval must be positive");
+    }
+#ifndef YOLOV10_WITH_FFMPEG
+    if (config.mode == SamplingMode::Keyframes)
+    {
+        throw std::runtime_error("Keyframe sampling needs libavcodec, build with -DYOLOV10_WITH_FFMPEG=ON");
+    }
+#endif
+
+    const auto start = std::chrono::steady_clock::now();
+    std::unique_ptr<FrameSampler> sampler = createSampler(path, config);
+    const cv::Size input_size = engine.inputSize();
+
+    VideoIndexStats stats;
+    std::vector<SampledFrame> frames;
+    std::vector<float> tensor;
+    std::vector<float> batch;
+    frames.reserve(config.batch_size);
+
+    auto runBatch = [&]()
+    {
+        if (frames.empty())
+        {
+            return;
+        }
+
+        std::vector<std::vector<float>> outputs = engine.runInferenceBatch(batch, frames.size());
+        for (size_t i = 0; i < frames.size(); ++i)
+        {
+            const SampledFrame &frame = frames[i];
+            sink.write(DetectionRecord{source, frame.index, frame.timestamp_ms, frame.width, frame.height,
+                                       engine.filterDetections(outputs[i], config.confidence_threshold, input_size.width, input_size.height, frame.width, frame.height)});
+        }
+
+        stats.sampled_frames += static_cast<int64_t>(frames.size());
+        sampledFramesCounter().increment(frames.size());
+        frames.clear();
+        batch.clear();
+    };
+
+    SampledFrame frame;
+    while (sampler->next(engine, frame, tensor))
+    {
+        batch.insert(batch.end(), tensor.begin(), tensor.end());
+        frames.push_back(frame);
+        if (frames.size() == config.batch_size)
+        {
+            runBatch();
+        }
+    }
+    runBatch();
+
+    stats.video_ms = sampler->durationMs();
+    stats.elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
@@ -0,0 +1,49 @@
+#ifndef VIDEO_INDEXER_H
+#define VIDEO_INDEXER_H
+
+#include "detection_sink.h"
+#include "ia/inference.h"
+#include <cstdint>
+#include <string>
+
+enum class SamplingMode
+{
+    // Only the keyframes of the stream, which decode without any other
+    // frame; needs libavcodec
+    Keyframes,
+    // One frame every interval_seconds, reached by seeking when it is far away
+    Interval
+};
+
+struct VideoIndexConfig
+{
+#ifdef YOLOV10_WITH_FFMPEG
+    SamplingMode mode = SamplingMode::Keyframes;
+#else
+    // OpenCV cannot tell keyframes apart
+    SamplingMode mode = SamplingMode::Interval;
+#endif
+    double interval_seconds = 2.0;
+
+    // Frames sent to the engine at once; models without a dynamic batch
+    // dimension still run them one by one
+    size_t batch_size = 8;
+    float confidence_threshold = 0.3f;
+
+    // Decoder threads, 0 for one per core
+    int decode_threads = 0;
+};
+
+struct VideoIndexStats
+{
+    int64_t sampled_frames = 0;
+    double video_ms = 0.0;
+    double elapsed_ms = 0.0;
+};
+
+
+VideoIndexStats indexVideo(InferenceEngine &engine, const std::string &path, const std::string &source, DetectionSink &sink,
+                           const VideoIndexConfig &config = VideoIndexConfig());
+
+
+#endif // VIDEO_INDEXER_H
@@ -0,0 +1,429 @@
+#include "video_source.h"
+#include "metrics/metrics.h"
+#include "metrics/trace.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/avutil.h>
+#include <libswscale/swscale.h>
+}
+
+namespace
+{
+    std::string avError(int status)
+    {
+        char message[AV_ERROR_MAX_STRING_SIZE] = {};
+        av_strerror(status, message, sizeof(message));
+        return message;
+    }
+
+    Counter &decodedFramesCounter()
+    {
+        static Counter &counter = MetricsRegistry::global().counter("yolov10_video_frames_decoded_total", "Video frames decoded by libavcodec");
+        return counter;
+    }
+
+    Counter &skippedPacketsCounter()
+    {
+        static Counter &counter = MetricsRegistry::global().counter("yolov10_video_packets_skipped_total", "Video packets dropped without being decoded");
+        return counter;
+    }
+}
+
+int VideoFrame::width() const
+{
+    return has_yuv ? yuv.width : bgr.cols;
+}
+
+int VideoFrame::height() const
+{
+    return has_yuv ? yuv.height : bgr.rows;
+}
+
+/*
+ * Function to get the frame as a BGR image, for drawing or BGR only consumers
+ *
+ * @return: BGR image, converted at full resolution if the frame is YUV
+ */
+cv::Mat VideoFrame::toBgr() const
+{
+    if (!has_yuv)
+    {
+        return bgr;
+    }
+
+    cv::Mat result;
+    const int w = yuv.width;
+    const int h = yuv.height;
+    switch (yuv.format)
+    {
+    case PixelFormat::NV12:
+        cv::cvtColorTwoPlane(cv::Mat(h, w, CV_8UC1, const_cast<uint8_t *>(yuv.planes[0]), yuv.strides[0]),
+                             cv::Mat(h / 2, w / 2, CV_8UC2, const_cast<uint8_t *>(yuv.planes[1]), yuv.strides[1]), result, cv::COLOR_YUV2BGR_NV12);
+        break;
+    case PixelFormat::I420:
+    {
+        // cvtColor wants the three planes back to back without padding
+        cv::Mat packed(h * 3 / 2, w, CV_8UC1);
+        cv::Mat luma = packed.rowRange(0, h);
+        cv::Mat(h, w, CV_8UC1, const_cast<uint8_t *>(yuv.planes[0]), yuv.strides[0]).copyTo(luma);
+        uint8_t *chroma = packed.ptr<uint8_t>(h);
+        for (int plane = 1; plane < 3; ++plane)
+        {
+            cv::Mat target(h / 2, w / 2, CV_8UC1, chroma + (plane - 1) * (w / 2) * (h / 2));
+            cv::Mat(h / 2, w / 2, CV_8UC1, const_cast<uint8_t *>(yuv.planes[plane]), yuv.strides[plane]).copyTo(target);
+        }
+        cv::cvtColor(packed, result, cv::COLOR_YUV2BGR_I420);
+        break;
+    }
+    case PixelFormat::YUYV:
+        cv::cvtColor(cv::Mat(h, w, CV_8UC2, const_cast<uint8_t *>(yuv.planes[0]), yuv.strides[0]), result, cv::COLOR_YUV2BGR_YUYV);
+        break;
+    }
+    return result;
+}
+
+VideoSource::VideoSource(const std::string &url, const VideoSourceConfig &config)
+    : config(config),
+      format_context(nullptr),
+      codec_context(nullptr),
+      packet(nullptr),
+      frame(nullptr),
+      sws_context(nullptr),
+      stream_index(-1),
+      time_base_ms(0.0),
+      frame_rate(0.0),
+      start_pts(0),
+      last_index(-1),
+      draining(false),
+      decoded_count(0),
+      skipped_count(0)
+{
+    if (config.mode == DecodeMode::EveryNth && config.every_nth < 1)
+    {
+        throw std::runtime_error("every_nth must be at least 1");
+    }
+
+    try
+    {
+        int status = avformat_open_input(&format_context, url.c_str(), nullptr, nullptr);
+        if (status < 0)
+        {
+            throw std::runtime_error("Could not open the video " + url + ": " + avError(status));
+        }
+        status = avformat_find_stream_info(format_context, nullptr);
+        if (status < 0)
+        {
+            throw std::runtime_error("Could not read the streams of " + url + ": " + avError(status));
+        }
+
+        const AVCodec *codec = nullptr;
+        stream_index = av_find_best_stream(format_context, AVMEDIA_TYPE_VIDEO, -1, -1, &codec, 0);
+        if (stream_index < 0)
+        {
+            throw std::runtime_error("No decodable video stream in " + url);
+        }
+        AVStream *stream = format_context->streams[stream_index];
+
+        codec_context = avcodec_alloc_context3(codec);
+        if (!codec_context || avcodec_parameters_to_context(codec_context, stream->codecpar) < 0)
+        {
+            throw std::runtime_error("Could not set up the decoder of " + url);
+        }
+        codec_context->pkt_timebase = stream->time_base;
+        codec_context->thread_count = config.threads;
+        codec_context->thread_type = (config.frame_threads ? FF_THREAD_FRAME : 0) | (config.slice_threads ? FF_THREAD_SLICE : 0);
+        if (config.mode == DecodeMode::Keyframes)
+        {
+            codec_context->skip_frame = AVDISCARD_NONKEY;
+        }
+        status = avcodec_open2(codec_context, codec, nullptr);
+        if (status < 0)
+        {
+            throw std::runtime_error("Could not open the decoder of " + url + ": " + avError(status));
+        }
+
+        packet = av_packet_alloc();
+        frame = av_frame_alloc();
+        if (!packet || !frame)
+        {
+            throw std::runtime_error("Out of memory while opening " + url);
+        }
+
+        time_base_ms = av_q2d(stream->time_base) * 1000.0;
+        const AVRational rate = stream->avg_frame_rate.num ? stream->avg_frame_rate : stream->r_frame_rate;
+        frame_rate = rate.num && rate.den ? av_q2d(rate) : 0.0;
+        start_pts = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+    }
+    catch (...)
+    {
+        close();
+        throw;
+    }
+}
+
+VideoSource::~VideoSource()
+{
+    close();
+}
+
+void VideoSource::close()
+{
+    sws_freeContext(sws_context);
+    sws_context = nullptr;
+    av_frame_free(&frame);
+    av_packet_free(&packet);
+    avcodec_free_context(&codec_context);
+    avformat_close_input(&format_context);
+}
+
+/*
+ * Function to decode the next frame the mode asks for
+ *
+ * @param output: filled with the frame, its pixels valid until the next read or seek
+ *
+ * @return: false at the end of the stream
+ */
+bool VideoSource::read(VideoFrame &output)
+{
+    static Histogram &decode_seconds = stageHistogram("decode");
+    ScopedTimer timer(decode_seconds, "decode");
+
+    while (true)
+    {
+        const int status = avcodec_receive_frame(codec_context, frame);
+        if (status == 0)
+        {
+            ++decoded_count;
+            decodedFramesCounter().increment();
+
+            const int64_t index = frameIndex(frame->best_effort_timestamp);
+            last_index = index;
+            if (!wanted(index))
+            {
+                av_frame_unref(frame);
+                continue;
+            }
+
+            exportFrame(output);
+            return true;
+        }
+        if (status == AVERROR_EOF)
+        {
+            return false;
+        }
+        if (status != AVERROR(EAGAIN))
+        {
+            throw std::runtime_error("Video decoding failed: " + avError(status));
+        }
+
+        sendNextPacket();
+    }
+}
+
+/*
+ * Function to jump to a point of the stream
+ *
+ * Decoding restarts at the last keyframe at or before the time, so the
+ * next frames read may come slightly before it.
+ *
+ * @param timestamp_ms: time since the start of the stream
+ *
+ * @return: false if the container cannot seek
+ */
+bool VideoSource::seek(double timestamp_ms)
+{
+    const int64_t target = start_pts + static_cast<int64_t>(timestamp_ms / time_base_ms);
+    if (av_seek_frame(format_context, stream_index, target, AVSEEK_FLAG_BACKWARD) < 0)
+    {
+        return false;
+    }
+
+    avcodec_flush_buffers(codec_context);
+    draining = false;
+    last_index = -1;
+    return true;
+}
+
+int VideoSource::width() const
+{
+    return codec_context->width;
+}
+
+int VideoSource::height() const
+{
+    return codec_context->height;
+}
+
+double VideoSource::frameRate() const
+{
+    return frame_rate;
+}
+
+/*
+ * Function to get the length of the stream
+ *
+ * @return: duration in milliseconds, 0 for live streams
+ */
+double VideoSource::durationMs() const
+{
+    const AVStream *stream = format_context->streams[stream_index];
+    if (stream->duration != AV_NOPTS_VALUE && stream->duration > 0)
+    {
+        return stream->duration * time_base_ms;
+    }
+    return format_context->duration > 0 ? format_context->duration * 1000.0 / AV_TIME_BASE : 0.0;
+}
+
+uint64_t VideoSource::decodedFrames() const
+{
+    return decoded_count;
+}
+
+uint64_t VideoSource::skippedPackets() const
+{
+    return skipped_count;
+}
+
+/*
+ * Function to number a frame from its timestamp
+ *
+ * @param pts: presentation timestamp in stream time base
+ *
+ * @return: frame index from the start of the stream, or the one after the
+ *          last frame when the timestamp is unknown
+ */
+int64_t VideoSource::frameIndex(int64_t pts) const
+{
+    if (pts == AV_NOPTS_VALUE || frame_rate <= 0.0)
+    {
+        return last_index + 1;
+    }
+    return std::llround((pts - start_pts) * time_base_ms * frame_rate / 1000.0);
+}
+
+bool VideoSource::wanted(int64_t index) const
+{
+    return config.mode != DecodeMode::EveryNth || index % config.every_nth == 0;
+}
+
+/*
+ * Function to tell whether a packet has to go through the decoder
+ *
+ * Keyframe mode drops every other packet. Every-nth mode drops unwanted
+ * packets the demuxer marks as disposable, which no other frame references.
+ *
+ * @param candidate: packet of the video stream
+ *
+ * @return: false if the packet can be dropped undecoded
+ */
+bool VideoSource::needsDecoding(const AVPacket &candidate) const
+{
+    switch (config.mode)
+    {
+    case DecodeMode::Keyframes:
+        return candidate.flags & AV_PKT_FLAG_KEY;
+    case DecodeMode::EveryNth:
+        return !(candidate.flags & AV_PKT_FLAG_DISPOSABLE) || candidate.pts == AV_NOPTS_VALUE || wanted(frameIndex(candidate.pts));
+    case DecodeMode::AllFrames:
+        break;
+    }
+    return true;
+}
+
+/*
+ * Function to feed the decoder the next packet it needs, or the end of stream
+ */
+void VideoSource::sendNextPacket()
+{
+    if (draining)
+    {
+        throw std::runtime_error("Video decoder asked for input after the end of the stream");
+    }
+
+    while (true)
+    {
+        if (av_read_frame(format_context, packet) < 0)
+        {
+            // End of the file or a broken stream: let the decoder output what it holds
+            avcodec_send_packet(codec_context, nullptr);
+            draining = true;
+            return;
+        }
+
+        if (packet->stream_index != stream_index || !needsDecoding(*packet))
+        {
+            if (packet->stream_index == stream_index)
+            {
+                ++skipped_count;
+                skippedPacketsCounter().increment();
+            }
+            av_packet_unref(packet);
+            continue;
+        }
+
+        // A corrupt packet only loses its own frame, decoding goes on with the next one
+        avcodec_send_packet(codec_context, packet);
+        av_packet_unref(packet);
+        return;
+    }
+}
+
+/*
+ * Function to hand the decoded frame out without copying it where possible
+ *
+ * Video range NV12, I420 and YUYV are passed as planes; anything else is
+ * converted to BGR.
+ *
+ * @param output: filled with the frame
+ */
+void VideoSource::exportFrame(VideoFrame &output)
+{
+    output.index = last_index;
+    output.timestamp_ms = frame->best_effort_timestamp != AV_NOPTS_VALUE ? (frame->best_effort_timestamp - start_pts) * time_base_ms : last_index * 1000.0 / std::max(frame_rate, 1.0);
+    output.keyframe = frame->pict_type == AV_PICTURE_TYPE_I;
+
+    const int w = frame->width;
+    const int h = frame->height;
+    const bool video_range = frame->color_range != AVCOL_RANGE_JPEG;
+    const bool even = w % 2 == 0 && h % 2 == 0;
+    output.has_yuv = video_range && even;
+    switch (frame->format)
+    {
+    case AV_PIX_FMT_NV12:
+        output.yuv = {PixelFormat::NV12, w, h, {frame->data[0], frame->data[1], nullptr}, {frame->linesize[0], frame->linesize[1], 0}};
+        break;
+    case AV_PIX_FMT_YUV420P:
+        output.yuv = {PixelFormat::I420, w, h, {frame->data[0], frame->data[1], frame->data[2]}, {frame->linesize[0], frame->linesize[1], frame->linesize[2]}};
+        break;
+    case AV_PIX_FMT_YUYV422:
+        output.yuv = {PixelFormat::YUYV, w, h, {frame->data[0], nullptr, nullptr}, {frame->linesize[0], 0, 0}};
+        break;
+    default:
+        output.has_yuv = false;
+        break;
+    }
+
+    if (output.has_yuv)
+    {
+        output.bgr.release();
+        return;
+    }
+
+    // Other layouts, bit depths and full range video go through swscale
+    sws_context = sws_getCachedContext(sws_context, w, h, static_cast<AVPixelFormat>(frame->format), w, h, AV_PIX_FMT_BGR24, SWS_BILINEAR, nullptr, nullptr, nullptr);
+    if (!sws_context)
+    {
+        throw std::runtime_error("Unsupported video pixel format");
+    }
+    converted.create(h, w, CV_8UC3);
+    uint8_t *target[] = {converted.data};
+    const int target_stride[] = {static_cast<int>(converted.step)};
+    sws_scale(sws_context, frame->data, frame->linesize, 0, h, target, target_stride);
+    output.bgr = converted;
+}
@@ -0,0 +1,110 @@
+#ifndef VIDEO_SOURCE_H
+#define VIDEO_SOURCE_H
+
+#include "ia/preprocess.h"
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <string>
+
+struct AVCodecContext;
+struct AVFormatContext;
+struct AVFrame;
+struct AVPacket;
+struct SwsContext;
+
+enum class DecodeMode
+{
+    AllFrames,
+    // Only keyframes are sent to the decoder, the others are dropped as packets
+    Keyframes,
+    // Frames whose index is a multiple of every_nth; the others are still
+    // decoded when later frames reference them, but never converted
+    EveryNth
+};
+
+struct VideoSourceConfig
+{
+    DecodeMode mode = DecodeMode::AllFrames;
+    int every_nth = 1;
+
+    // Decoder threads, 0 for one per core. Frame threading decodes several
+    // frames at once at the cost of a few frames of latency; slice
+    // threading splits each frame for codecs that support it.
+    int threads = 0;
+    bool frame_threads = true;
+    bool slice_threads = true;
+};
+
+
+// A decoded frame. The pixels belong to the source and stay valid until its
+// next read or seek.
+struct VideoFrame
+{
+    // Frame number in presentation order and time since the start of the stream
+    int64_t index = 0;
+    double timestamp_ms = 0.0;
+    bool keyframe = false;
+
+    // Decoder output in a layout preprocessYuv takes, when has_yuv is set;
+    // otherwise the frame was converted to bgr
+    bool has_yuv = false;
+    YuvFrame yuv{};
+    cv::Mat bgr;
+
+    int width() const;
+    int height() const;
+    cv::Mat toBgr() const;
+};
+
+
+// Video file or stream decoded with libavcodec. Frames come out as the
+// decoder's own YUV planes, so they can go to the fused preprocessing
+// without a full resolution color conversion, and frames that are not
+// wanted are skipped before decoding where the bitstream allows it.
+class VideoSource
+{
+public:
+    explicit VideoSource(const std::string &url, const VideoSourceConfig &config = VideoSourceConfig());
+    ~VideoSource();
+
+    VideoSource(const VideoSource &) = delete;
+    VideoSource &operator=(const VideoSource &) = delete;
+
+    bool read(VideoFrame &output);
+    bool seek(double timestamp_ms);
+
+    int width() const;
+    int height() const;
+    double frameRate() const;
+    double durationMs() const;
+
+    uint64_t decodedFrames() const;
+    uint64_t skippedPackets() const;
+
+private:
+    VideoSourceConfig config;
+    AVFormatContext *format_context;
+    AVCodecContext *codec_context;
+    AVPacket *packet;
+    AVFrame *frame;
+    SwsContext *sws_context;
+    int stream_index;
+    double time_base_ms;
+    double frame_rate;
+    int64_t start_pts;
+    int64_t last_index;
+    bool draining;
+    cv::Mat converted;
+    uint64_t decoded_count;
+    uint64_t skipped_count;
+
+    int64_t frameIndex(int64_t pts) const;
+    bool wanted(int64_t index) const;
+    bool needsDecoding(const AVPacket &candidate) const;
+    void sendNextPacket();
+    void exportFrame(VideoFrame &output);
+    void close();
+};
+
+
+#endif // VIDEO_SOURCE_H
@@ -1,211 +1,543 @@
-#include <onnxruntime_cxx_api.h>
+#include "ia/cascade.h"
+#include "ia/detection_cache.h"
+#include "ia/inference.h"
+#include "ia/resolution_controller.h"
+#include "ia/roi.h"
+#include "io/detection_sink.h"
+#include "io/image_encoder.h"
+#ifdef YOLOV10_WITH_FFMPEG
+#include "ia/temporal_smoother.h"
+#include "io/video_source.h"
+#endif
+#include "memory/frame_pool.h"
+#include "metrics/metrics.h"
+#include "metrics/trace.h"
+#include "system/cpu_topology.h"
 #include <iostream>
+#include <memory>
 #include <vector>
 #include <opencv2/opencv.hpp>
 #include <algorithm>
 
-using namespace cv;
-
-const std::vector<std::string> CLASS_NAMES = {
-    "person", "bicycle", "car", "motorcycle", "airplane", "bus", "train", "truck", "boat", "traffic light",
-    "fire hydrant", "stop sign", "parking meter", "bench", "bird", "cat", "dog", "horse", "sheep", "cow",
-    "elephant", "bear", "zebra", "giraffe", "backpack", "umbrella", "handbag", "tie", "suitcase", "frisbee",
-    "skis", "snowboard", "sports ball", "kite", "baseball bat", "baseball glove", "skateboard", "surfboard",
-    "tennis racket", "bottle", "wine glass", "cup", "fork", "knife", "spoon", "bowl", "banana", "apple",
-    "sandwich", "orange", "broccoli", "carrot", "hot dog", "pizza", "donut", "cake", "chair", "couch",
-    "potted plant", "bed", "dining table", "toilet", "tv", "laptop", "mouse", "remote", "keyboard",
-    "cell phone", "microwave", "oven", "toaster", "sink", "refrigerator", "book", "clock", "vase",
-    "scissors", "teddy bear", "hair drier", "toothbrush"};
-
-// Function to load and preprocess the image
-std::vector<float> preprocessImage(const std::string &image_path, const std::vector<int64_t> &input_shape, int &orig_width, int &orig_height)
+void printUsage(const char *program)
 {
-    cv::Mat image = cv::imread(image_path);
-    if (image.empty())
+    std::cerr << "Usage: " << program << " <model_path> <image_path>... [--roi <config_path>] [--source <name>] [--headless]"
+              << " [--output <path>] [--output-format <text|jsonl|csv|binary>]"
+              << " [--jpeg-quality <1-100>] [--output-scale <factor>] [--metrics-file <path>]"
+              << " [--cpus <list>] [--numa-node <n>] [--topology <path>] [--trace <path>]"
+              << " [--cascade <large_model_path>] [--cascade-band <low>,<high>] [--audit-period <n>] [--escalate <crop|full>]"
+              << " [--adaptive-resolution] [--latency-slo-ms <n>]"
+              << " [--cache <entries>] [--cache-distance <bits>] [--cache-store <path>]"
+#ifdef YOLOV10_WITH_FFMPEG
+              << " [--video <path|url>] [--decode-threads <n>] [--keyframes-only] [--every-nth <n>]"
+              << " [--infer-every <n>] [--interpolate]"
+#endif
+              << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    // Check for the correct number of arguments
+    if (argc < 3)
     {
-        throw std::runtime_error("Could not read the image: " + image_path);
+        printUsage(argv[0]);
+        return 1;
     }
 
-    // Save the original dimensions
-    orig_width = image.cols;
-    orig_height = image.rows;
-
-    cv::Mat resized_image;
-    cv::resize(image, resized_image, cv::Size(input_shape[2], input_shape[3]));
-
-    resized_image.convertTo(resized_image, CV_32F, 1.0 / 255);
-
-    std::vector<cv::Mat> channels(3);
-    cv::split(resized_image, channels);
-
-    std::vector<float> input_tensor_values;
-    for (int c = 0; c < 3; ++c)
+    std::string model_path = argv[1];
+    std::vector<std::string> image_paths;
+    std::string roi_path;
+    std::string source_name;
+    std::string output_path = "-";
+    std::string output_format;
+    bool headless = false;
+    EncoderOptions encoder_options;
+    std::string metrics_path;
+    std::string trace_path;
+    std::string cpu_list;
+    int numa_node = -1;
+    std::string topology_path;
+    std::string cascade_model_path;
+    CascadeConfig cascade_config;
+    bool adaptive_resolution = false;
+    ResolutionConfig resolution_config;
+    bool use_cache = false;
+    DetectionCacheConfig cache_config;
+#ifdef YOLOV10_WITH_FFMPEG
+    std::vector<std::string> video_paths;
+    VideoSourceConfig video_config;
+    int infer_every = 1;
+    bool interpolate = false;
+    SmootherConfig smoother_config;
+#endif
+
+    for (int i = 2; i < argc; ++i)
     {
-        input_tensor_values.insert(input_tensor_values.end(), (float *)channels[c].data, (float *)channels[c].data + input_shape[2] * input_shape[3]);
+        std::string option = argv[i];
+        if (option == "--roi" && i + 1 < argc)
+        {
+            roi_path = argv[++i];
+        }
+        else if (option == "--source" && i + 1 < argc)
+        {
+            source_name = argv[++i];
+        }
+        else if (option == "--headless")
+        {
+            headless = true;
+        }
+        else if (option == "--output" && i + 1 < argc)
+        {
+            output_path = argv[++i];
+        }
+        else if (option == "--output-format" && i + 1 < argc)
+        {
+            output_format = argv[++i];
+        }
+        else if (option == "--jpeg-quality" && i + 1 < argc)
+        {
+            encoder_options.jpeg_quality = std::stoi(argv[++i]);
+        }
+        else if (option == "--output-scale" && i + 1 < argc)
+        {
+            encoder_options.scale = std::stod(argv[++i]);
+        }
+        else if (option == "--metrics-file" && i + 1 < argc)
+        {
+            metrics_path = argv[++i];
+        }
+        else if (option == "--trace" && i + 1 < argc)
+        {
+            trace_path = argv[++i];
+        }
+        else if (option == "--cpus" && i + 1 < argc)
+        {
+            cpu_list = argv[++i];
+        }
+        else if (option == "--numa-node" && i + 1 < argc)
+        {
+            numa_node = std::stoi(argv[++i]);
+        }
+        else if (option == "--topology" && i + 1 < argc)
+        {
+            topology_path = argv[++i];
+        }
+        else if (option == "--cascade" && i + 1 < argc)
+        {
+            cascade_model_path = argv[++i];
+        }
+        else if (option == "--cascade-band" && i + 1 < argc)
+        {
+            std::string band = argv[++i];
+            size_t comma = band.find(',');
+            if (comma == std::string::npos)
+            {
+                printUsage(argv[0]);
+                return 1;
+            }
+            cascade_config.uncertain_low = std::stof(band.substr(0, comma));
+            cascade_config.uncertain_high = std::stof(band.substr(comma + 1));
+        }
+        else if (option == "--audit-period" && i + 1 < argc)
+        {
+            cascade_config.audit_period = std::stoi(argv[++i]);
+        }
+        else if (option == "--escalate" && i + 1 < argc)
+        {
+            std::string mode = argv[++i];
+            if (mode != "crop" && mode != "full")
+            {
+                printUsage(argv[0]);
+                return 1;
+            }
+            cascade_config.escalation = mode == "crop" ? Escalation::Crop : Escalation::FullFrame;
+        }
+        else if (option == "--adaptive-resolution")
+        {
+            adaptive_resolution = true;
+        }
+        else if (option == "--latency-slo-ms" && i + 1 < argc)
+        {
+            resolution_config.latency_slo = std::chrono::microseconds(static_cast<int64_t>(std::stod(argv[++i]) * 1000));
+        }
+        else if (option == "--cache" && i + 1 < argc)
+        {
+            use_cache = true;
+            cache_config.capacity = std::stoul(argv[++i]);
+        }
+        else if (option == "--cache-distance" && i + 1 < argc)
+        {
+            cache_config.max_distance = std::stoi(argv[++i]);
+        }
+        else if (option == "--cache-store" && i + 1 < argc)
+        {
+            use_cache = true;
+            cache_config.store_path = argv[++i];
+        }
+#ifdef YOLOV10_WITH_FFMPEG
+        else if (option == "--video" && i + 1 < argc)
+        {
+            video_paths.push_back(argv[++i]);
+        }
+        else if (option == "--decode-threads" && i + 1 < argc)
+        {
+            video_config.threads = std::stoi(argv[++i]);
+        }
+        else if (option == "--keyframes-only")
+        {
+            video_config.mode = DecodeMode::Keyframes;
+        }
+        else if (option == "--every-nth" && i + 1 < argc)
+        {
+            video_config.mode = DecodeMode::EveryNth;
+            video_config.every_nth = std::stoi(argv[++i]);
+        }
+        else if (option == "--infer-every" && i + 1 < argc)
+        {
+            infer_every = std::max(1, std::stoi(argv[++i]));
+        }
+        else if (option == "--interpolate")
+        {
+            interpolate = true;
+        }
+#endif
+        else if (option.rfind("--", 0) != 0)
+        {
+            image_paths.push_back(option);
+        }
+        else
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
     }
 
-    return input_tensor_values;
-}
-
-// Function to load the ONNX model and create a session
-Ort::Session loadModel(Ort::Env &env, const std::string &model_path, Ort::SessionOptions &session_options)
-{
-    return Ort::Session(env, model_path.c_str(), session_options);
-}
-
-// Function to get the input name of the model
-std::string getInputName(Ort::Session &session, Ort::AllocatorWithDefaultOptions &allocator)
-{
-    Ort::AllocatedStringPtr name_allocator = session.GetInputNameAllocated(0, allocator);
-    return std::string(name_allocator.get());
-}
-
-// Function to get the output name of the model
-std::string getOutputName(Ort::Session &session, Ort::AllocatorWithDefaultOptions &allocator)
-{
-    Ort::AllocatedStringPtr name_allocator = session.GetOutputNameAllocated(0, allocator);
-    return std::string(name_allocator.get());
-}
+    bool has_input = !image_paths.empty();
+#ifdef YOLOV10_WITH_FFMPEG
+    has_input = has_input || !video_paths.empty();
+#endif
+    if (!has_input)
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+#ifdef YOLOV10_WITH_FFMPEG
+    if (infer_every > 1 && video_config.mode != DecodeMode::AllFrames)
+    {
+        std::cerr << "--infer-every needs every frame and cannot be combined with --keyframes-only or --every-nth" << std::endl;
+        return 1;
+    }
+#endif
 
-// Struct to hold detection results
-struct Detection
-{
-    float confidence;
-    cv::Rect bbox;
-    int class_id;
-    std::string class_name;
-};
-
-// Function to filter and post-process the results based on a confidence threshold
-std::vector<Detection> filterDetections(const std::vector<float> &results, float confidence_threshold, int img_width, int img_height, int orig_width, int orig_height)
-{
-    std::vector<Detection> detections;
-    const int num_detections = results.size() / 6;
+    // The cascade and the resolution controller pick their own input, regions would fight over it
+    if ((!cascade_model_path.empty() || adaptive_resolution) && !roi_path.empty())
+    {
+        std::cerr << (adaptive_resolution ? "--adaptive-resolution" : "--cascade") << " cannot be combined with --roi" << std::endl;
+        return 1;
+    }
+    if (!cascade_model_path.empty() && adaptive_resolution)
+    {
+        std::cerr << "--cascade cannot be combined with --adaptive-resolution" << std::endl;
+        return 1;
+    }
+    if (use_cache && adaptive_resolution)
+    {
+        std::cerr << "--cache cannot be combined with --adaptive-resolution, whose detections depend on the frames before" << std::endl;
+        return 1;
+    }
 
-    for (int i = 0; i < num_detections; ++i)
+    // Record a timeline of every stage and of the ONNX Runtime session
+    EngineConfig engine_config;
+    if (!trace_path.empty())
     {
-        float left = results[i * 6 + 0];
-        float top = results[i * 6 + 1];
-        float right = results[i * 6 + 2];
-        float bottom = results[i * 6 + 3];
-        float confidence = results[i * 6 + 4];
-        int class_id = results[i * 6 + 5];
+        Tracer::global().enable();
+        Tracer::global().setThreadName("main");
+        engine_config.profile_prefix = trace_path + ".ort";
+    }
 
-        if (confidence >= confidence_threshold)
+    // Plan every resolution the controller may pick before the first frame
+    if (adaptive_resolution)
+    {
+        engine_config.warmup_iterations = std::max(engine_config.warmup_iterations, 1);
+        engine_config.warmup_resolutions.clear();
+        for (int resolution : resolution_config.resolutions)
         {
-            int x = static_cast<int>(left * orig_width / img_width);
-            int y = static_cast<int>(top * orig_height / img_height);
-            int width = static_cast<int>((right - left) * orig_width / img_width);
-            int height = static_cast<int>((bottom - top) * orig_height / img_height);
-
-            detections.push_back(
-                {
-                    confidence,
-                    cv::Rect(x, y, width, height),
-                    class_id,
-                    CLASS_NAMES[class_id]
-                }
-            );
+            engine_config.warmup_resolutions.emplace_back(resolution, resolution);
         }
     }
 
-    return detections;
-}
-
-// Function to run inference on the model
-std::vector<float> runInference(Ort::Session &session, const std::vector<float> &input_tensor_values, const std::vector<int64_t> &input_shape)
-{
-    Ort::AllocatorWithDefaultOptions allocator;
-
-    std::string input_name = getInputName(session, allocator);
-    std::string output_name = getOutputName(session, allocator);
+    // Every cv::Mat of the pipeline recycles its buffer through the frame pool
+    PooledMatAllocator::install();
 
-    const char *input_name_ptr = input_name.c_str();
-    const char *output_name_ptr = output_name.c_str();
+    try
+    {
+        // Keep decode, preprocessing, the ORT pool and encoding on one set of CPUs
+        std::vector<int> cpus = parseCpuList(cpu_list);
+        if (numa_node >= 0)
+        {
+            CpuTopology topology = topology_path.empty() ? CpuTopology::detect() : CpuTopology::load(topology_path);
+            if (cpus.empty())
+            {
+                cpus = topology.node(numa_node).cpus;
+            }
+            preferNodeMemory(numa_node);
+        }
+        if (!cpus.empty())
+        {
+            pinCurrentThread(cpus);
+            engine_config.cpus = cpus;
+            encoder_options.cpus = cpus;
+        }
 
-    Ort::MemoryInfo memory_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
-    Ort::Value input_tensor = Ort::Value::CreateTensor<float>(memory_info, const_cast<float *>(input_tensor_values.data()), input_tensor_values.size(), input_shape.data(), input_shape.size());
+        // Load model
+        InferenceEngine engine(model_path, engine_config);
 
-    auto output_tensors = session.Run(Ort::RunOptions{nullptr}, &input_name_ptr, &input_tensor, 1, &output_name_ptr, 1);
+        // With --cascade the command line model is the small one, run on every frame
+        std::unique_ptr<InferenceEngine> large_engine;
+        std::unique_ptr<CascadeDetector> cascade;
+        if (!cascade_model_path.empty())
+        {
+            EngineConfig large_config = engine_config;
+            if (!large_config.profile_prefix.empty())
+            {
+                large_config.profile_prefix += ".large";
+            }
+            large_engine = std::make_unique<InferenceEngine>(cascade_model_path, large_config);
+            cascade = std::make_unique<CascadeDetector>(engine, *large_engine, cascade_config);
+        }
 
-    float *floatarr = output_tensors[0].GetTensorMutableData<float>();
-    size_t output_tensor_size = output_tensors[0].GetTensorTypeAndShapeInfo().GetElementCount();
+        // With --adaptive-resolution the network resolution follows the objects and the latency
+        std::unique_ptr<ResolutionController> resolution_controller;
+        if (adaptive_resolution)
+        {
+            resolution_controller = std::make_unique<ResolutionController>(resolution_config);
+        }
 
-    return std::vector<float>(floatarr, floatarr + output_tensor_size);
-}
+        // Regions of interest per source, whole frame if none
+        RoiConfig roi_config;
+        if (!roi_path.empty())
+        {
+            roi_config = RoiConfig::load(roi_path);
+        }
 
-int main(int argc, char *argv[])
-{
-    // Check for the correct number of arguments
-    if (argc != 3)
-    {
-        std::cerr << "Usage: " << argv[0] << " <model_path> <image_path>" << std::endl;
-        return 1;
-    }
+        // Detections are formatted and written by a background thread
+        AsyncSinkWriter sink(createDetectionSink(output_path, output_format));
 
-    std::string model_path = argv[1];
-    std::string image_path = argv[2];
+        // Annotated images are encoded and written by a background pool
+        AsyncImageEncoder encoder(encoder_options);
 
-    // Initialize ONNX Runtime environment
-    Ort::Env env(ORT_LOGGING_LEVEL_WARNING, "ONNXRuntime");
+        // Define confidence threshold
+        float confidence_threshold = cascade_config.confidence_threshold;
 
-    // Create session options
-    Ort::SessionOptions session_options;
-    session_options.SetIntraOpNumThreads(1);
-    session_options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_BASIC);
+        // Run inference and filter results
+        auto detect = [&](const cv::Mat &image, const std::vector<RegionOfInterest> &regions)
+        {
+            if (cascade)
+            {
+                return cascade->detect(image);
+            }
+            if (resolution_controller)
+            {
+                return resolution_controller->detect(engine, image, confidence_threshold);
+            }
+            return detectRegions(engine, image, regions, confidence_threshold);
+        };
+
+        // Repeated images reuse the detections of their first occurrence. The
+        // context covers every option the detections depend on.
+        std::unique_ptr<DetectionCache> cache;
+        std::string cache_pipeline;
+        if (use_cache)
+        {
+            cache = std::make_unique<DetectionCache>(cache_config);
+            cache_pipeline = modelIdentity(model_path);
+            if (cascade)
+            {
+                cache_pipeline += "|cascade:" + modelIdentity(cascade_model_path) + ":" + std::to_string(cascade_config.uncertain_low) + ":" +
+                                  std::to_string(cascade_config.uncertain_high) + ":" + std::to_string(cascade_config.audit_period) + ":" +
+                                  (cascade_config.escalation == Escalation::Crop ? "crop" : "full");
+            }
+        }
 
-    try
-    {
-        // Load model
-        Ort::Session session = loadModel(env, model_path, session_options);
+        // Draw bounding boxes, labels and the processed regions, then save the image and the detections
+        auto publish = [&](cv::Mat &image, const std::vector<RegionOfInterest> &regions, DetectionRecord record, const std::string &image_name)
+        {
+            if (!headless)
+            {
+                engine.drawLabels(image, record.detections);
+                for (const auto &region : regions)
+                {
+                    cv::polylines(image, region.polygon, true, cv::Scalar(255, 0, 0), 2);
+                }
+                encoder.submit(image, image_name);
+            }
 
-        // Define input shape (e.g., {1, 3, 640, 640})
-        std::vector<int64_t> input_shape = {1, 3, 640, 640};
+            sink.write(std::move(record));
+        };
 
-        // Save original image dimensions
-        int orig_width, orig_height;
+        for (size_t index = 0; index < image_paths.size(); ++index)
+        {
+            const std::string &image_path = image_paths[index];
+            std::string source = source_name.empty() ? image_path : source_name;
+            Tracer::global().setFrame(static_cast<int64_t>(index));
+
+            // Load the image
+            cv::Mat image;
+            {
+                static Histogram &decode_seconds = stageHistogram("decode");
+                ScopedTimer timer(decode_seconds, "decode");
+                image = cv::imread(image_path);
+            }
+            if (image.empty())
+            {
+                throw std::runtime_error("Could not read the image: " + image_path);
+            }
+
+            const std::vector<RegionOfInterest> &regions = roi_config.regionsFor(source);
+            std::vector<Detection> detections;
+            uint64_t frame_hash = 0;
+            uint64_t context = 0;
+            if (cache)
+            {
+                frame_hash = frameHash(image);
+                context = cacheContext(regions.empty() ? cache_pipeline : cache_pipeline + "|roi:" + roi_path + ":" + source, confidence_threshold);
+            }
+            if (!cache || !cache->lookup(frame_hash, context, image.size(), detections))
+            {
+                detections = detect(image, regions);
+                if (cache)
+                {
+                    cache->insert(frame_hash, context, image.size(), detections);
+                }
+            }
+            publish(image, regions, DetectionRecord{source, static_cast<int64_t>(index), 0.0, image.cols, image.rows, std::move(detections)},
+                    image_paths.size() == 1 ? "result.jpg" : "result_" + std::to_string(index) + ".jpg");
+        }
 
-        // Preprocess image
-        std::vector<float> input_tensor_values = preprocessImage(image_path, input_shape, orig_width, orig_height);
+#ifdef YOLOV10_WITH_FFMPEG
+        std::vector<float> input_tensor_values;
+        std::vector<float> results;
+        for (size_t video = 0; video < video_paths.size(); ++video)
+        {
+            std::string source = source_name.empty() ? video_paths[video] : source_name;
+            const std::vector<RegionOfInterest> &regions = roi_config.regionsFor(source);
+
+            // Whole frame detection takes the decoder's YUV planes straight into the tensor
+            const bool fused = !cascade && !resolution_controller && regions.empty();
+
+            auto resultName = [&](int64_t index)
+            {
+                return "result_" + std::to_string(video) + "_" + std::to_string(index) + ".jpg";
+            };
+
+            // Frames between two inferences are filled in from the tracks of the smoother
+            TemporalSmoother smoother(smoother_config);
+            struct HeldFrame
+            {
+                int64_t index;
+                double timestamp_ms;
+                int width;
+                int height;
+                cv::Mat image;
+            };
+            std::vector<HeldFrame> held;
+
+            VideoSource video_source(video_paths[video], video_config);
+            VideoFrame frame;
+            while (video_source.read(frame))
+            {
+                Tracer::global().setFrame(frame.index);
+
+                if (frame.index % infer_every != 0)
+                {
+                    // The pixels are reused by the next read, only a drawn frame needs a copy
+                    cv::Mat image = headless ? cv::Mat() : frame.has_yuv ? frame.toBgr()
+                                                                           : frame.bgr.clone();
+                    if (interpolate)
+                    {
+                        held.push_back({frame.index, frame.timestamp_ms, frame.width(), frame.height(), image});
+                    }
+                    else
+                    {
+                        publish(image, regions, DetectionRecord{source, frame.index, frame.timestamp_ms, frame.width(), frame.height(), smoother.predict(frame.timestamp_ms)},
+                                resultName(frame.index));
+                    }
+                    continue;
+                }
 
-        // Run inference
-        std::vector<float> results = runInference(session, input_tensor_values, input_shape);
+                std::vector<Detection> detections;
+                cv::Mat image;
+                if (fused && frame.has_yuv)
+                {
+                    engine.preprocessImage(frame.yuv, input_tensor_values);
+                    engine.runInference(input_tensor_values, results);
+                    const cv::Size input_size = engine.inputSize();
+                    detections = engine.filterDetections(results, confidence_threshold, input_size.width, input_size.height, frame.width(), frame.height());
+                    if (!headless)
+                    {
+                        image = frame.toBgr();
+                    }
+                }
+                else
+                {
+                    // A converted frame is already a copy, only the decoder's BGR buffer needs one
+                    image = frame.has_yuv ? frame.toBgr() : frame.bgr.clone();
+                    detections = detect(image, regions);
+                }
 
-        // Define confidence threshold
-        float confidence_threshold = 0.5;
+                if (infer_every > 1)
+                {
+                    smoother.update(detections, frame.timestamp_ms);
+                    for (HeldFrame &previous : held)
+                    {
+                        publish(previous.image, regions, DetectionRecord{source, previous.index, previous.timestamp_ms, previous.width, previous.height, smoother.predict(previous.timestamp_ms)},
+                                resultName(previous.index));
+                    }
+                    held.clear();
+                }
 
-        // Load the image to get its dimensions
-        cv::Mat image = cv::imread(image_path);
-        int img_width = image.cols;
-        int img_height = image.rows;
+                publish(image, regions, DetectionRecord{source, frame.index, frame.timestamp_ms, frame.width(), frame.height(), std::move(detections)},
+                        resultName(frame.index));
+            }
+
+            // Frames after the last inference can only be extrapolated
+            for (HeldFrame &previous : held)
+            {
+                publish(previous.image, regions, DetectionRecord{source, previous.index, previous.timestamp_ms, previous.width, previous.height, smoother.predict(previous.timestamp_ms)},
+                        resultName(previous.index));
+            }
+            std::cerr << source << ": decoded " << video_source.decodedFrames() << " frames, skipped "
+                      << video_source.skippedPackets() << " packets undecoded" << std::endl;
+        }
+#endif
 
-        // Filter results
-        std::vector<Detection> detections = filterDetections(results, confidence_threshold, input_shape[2], input_shape[3], orig_width, orig_height);
+        encoder.close();
+        sink.close();
 
-        // Print detections and draw bounding boxes
-        for (const auto &detection : detections)
+        if (cache)
         {
-            std::cout << "Class ID: " << detection.class_id << " Confidence: " << detection.confidence
-                      << " BBox: [" << detection.bbox.x << ", " << detection.bbox.y << ", "
-                      << detection.bbox.width << ", " << detection.bbox.height << "]"
-                      << " Class Name: " << detection.class_name << std::endl;
+            std::cerr << "Cache answered " << cache->hits() << " of " << cache->hits() + cache->misses() << " images" << std::endl;
+        }
 
-            // Draw the bounding box on the image
-            cv::rectangle(image, detection.bbox, cv::Scalar(0, 255, 0), 2);
+        if (cascade)
+        {
+            std::cerr << "Cascade escalated " << cascade->escalations() << " of " << cascade->frames() << " frames" << std::endl;
+        }
 
-            // Put the class name and confidence on the image
-            std::string label = detection.class_name + ": " + std::to_string(detection.confidence);
-            int baseLine;
-            cv::Size labelSize = cv::getTextSize(label, cv::FONT_HERSHEY_SIMPLEX, 0.5, 1, &baseLine);
-            cv::rectangle(image, cv::Point(detection.bbox.x, detection.bbox.y - labelSize.height),
-                          cv::Point(detection.bbox.x + labelSize.width, detection.bbox.y + baseLine),
-                          cv::Scalar(255, 255, 255), cv::FILLED);
-            cv::putText(image, label, cv::Point(detection.bbox.x, detection.bbox.y),
-                        cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0, 0, 0), 1);
+        if (!metrics_path.empty())
+        {
+            MetricsRegistry::global().writeToFile(metrics_path);
         }
 
-        // Save the resulting image
-        cv::imwrite("result.jpg", image);
+        if (!trace_path.empty())
+        {
+            std::vector<OrtProfile> ort_profiles = {{engine.endProfiling(), engine.profilingStartNs()}};
+            if (large_engine)
+            {
+                ort_profiles.push_back({large_engine->endProfiling(), large_engine->profilingStartNs()});
+            }
+            Tracer::global().writeChromeTrace(trace_path, ort_profiles);
+        }
     }
     catch (const std::exception &e)
     {
@@ -0,0 +1,297 @@
+#include "frame_pool.h"
+#include "metrics/metrics.h"
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    const size_t SMALL_GRANULARITY = FramePool::ALIGNMENT;
+    const size_t PAGE_GRANULARITY = 4096;
+    const size_t SMALL_LIMIT = 64 * 1024;
+}
+
+FramePool::FramePool(size_t max_cached_bytes)
+    : max_cached_bytes(max_cached_bytes),
+      cached_bytes(0),
+      heap_allocations(bufferAllocations()),
+      cached_gauge(MetricsRegistry::global().gauge("yolov10_frame_pool_cached_bytes", "Bytes held in the free lists of the frame pool"))
+{
+}
+
+FramePool::~FramePool()
+{
+    trim();
+}
+
+/*
+ * Function to get the process wide pool
+ *
+ * The pool is never destroyed, since cv::Mat objects with static storage can
+ * release their buffers after the end of main.
+ *
+ * @return: the shared pool
+ */
+FramePool &FramePool::global()
+{
+    static FramePool *pool = new FramePool();
+    return *pool;
+}
+
+/*
+ * Function to get a block from the pool
+ *
+ * @param size: number of bytes needed
+ *
+ * @return: cache line aligned buffer of at least size bytes, with one reference
+ */
+void *FramePool::allocate(size_t size)
+{
+    const size_t block_capacity = sizeClass(size);
+    Block *block = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = free_blocks.find(block_capacity);
+        if (it != free_blocks.end() && !it->second.empty())
+        {
+            block = it->second.back();
+            it->second.pop_back();
+            cached_bytes -= block_capacity;
+            cached_gauge.set(static_cast<int64_t>(cached_bytes));
+        }
+    }
+
+    if (!block)
+    {
+        void *memory = std::aligned_alloc(ALIGNMENT, sizeof(Block) + block_capacity);
+        if (!memory)
+        {
+            throw std::bad_alloc();
+        }
+        block = new (memory) Block;
+        block->capacity = block_capacity;
+        heap_allocations.increment();
+    }
+
+    block->references.store(1, std::memory_order_relaxed);
+    return block + 1;
+}
+
+/*
+ * Function to add a reference to a block
+ *
+ * @param data: pointer returned by allocate
+ */
+void FramePool::retain(void *data)
+{
+    blockOf(data)->references.fetch_add(1, std::memory_order_relaxed);
+}
+
+/*
+ * Function to drop a reference to a block, recycling it with the last one
+ *
+ * @param data: pointer returned by allocate
+ */
+void FramePool::release(void *data)
+{
+    if (!data)
+    {
+        return;
+    }
+
+    Block *block = blockOf(data);
+    if (block->references.fetch_sub(1, std::memory_order_acq_rel) != 1)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (cached_bytes + block->capacity <= max_cached_bytes)
+        {
+            free_blocks[block->capacity].push_back(block);
+            cached_bytes += block->capacity;
+            cached_gauge.set(static_cast<int64_t>(cached_bytes));
+            return;
+        }
+    }
+
+    block->~Block();
+    std::free(block);
+}
+
+/*
+ * Function to return every free block to the heap
+ */
+void FramePool::trim()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &entry : free_blocks)
+    {
+        for (Block *block : entry.second)
+        {
+            block->~Block();
+            std::free(block);
+        }
+    }
+    free_blocks.clear();
+    cached_bytes = 0;
+    cached_gauge.set(0);
+}
+
+size_t FramePool::cachedBytes()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return cached_bytes;
+}
+
+/*
+ * Function to get the usable size of a block
+ *
+ * @param data: pointer returned by allocate
+ *
+ * @return: size class of the block, at least the requested size
+ */
+size_t FramePool::capacity(const void *data)
+{
+    return blockOf(data)->capacity;
+}
+
+/*
+ * Function to round a size up to its size class
+ *
+ * Small buffers are rounded to a cache line and frame sized ones to a page,
+ * so frames of one stream share a class without wasting much memory.
+ *
+ * @param size: requested number of bytes
+ *
+ * @return: capacity of the class
+ */
+size_t FramePool::sizeClass(size_t size)
+{
+    const size_t granularity = size < SMALL_LIMIT ? SMALL_GRANULARITY : PAGE_GRANULARITY;
+    return std::max(granularity, (size + granularity - 1) / granularity * granularity);
+}
+
+FramePool::Block *FramePool::blockOf(const void *data)
+{
+    return const_cast<Block *>(static_cast<const Block *>(data) - 1);
+}
+
+PooledMatAllocator::PooledMatAllocator(FramePool &pool)
+    : pool(pool)
+{
+}
+
+PooledMatAllocator::~PooledMatAllocator()
+{
+    for (void *header : free_headers)
+    {
+        ::operator delete(header);
+    }
+}
+
+/*
+ * Function to get the allocator over the global pool
+ *
+ * Like the pool, it lives until the process exits so that late cv::Mat
+ * releases still find it.
+ *
+ * @return: the shared allocator
+ */
+PooledMatAllocator &PooledMatAllocator::global()
+{
+    static PooledMatAllocator *allocator = new PooledMatAllocator(FramePool::global());
+    return *allocator;
+}
+
+/*
+ * Function to make the pooled allocator the default of every new cv::Mat
+ */
+void PooledMatAllocator::install()
+{
+    cv::Mat::setDefaultAllocator(&global());
+}
+
+/*
+ * Function to allocate the buffer of a cv::Mat
+ *
+ * Same layout rules as the standard OpenCV allocator: continuous rows unless
+ * the caller passes its own data and steps.
+ *
+ * @return: header describing the buffer
+ */
+cv::UMatData *PooledMatAllocator::allocate(int dims, const int *sizes, int type, void *data, size_t *step, cv::AccessFlag, cv::UMatUsageFlags) const
+{
+    size_t total = CV_ELEM_SIZE(type);
+    for (int i = dims - 1; i >= 0; --i)
+    {
+        if (step)
+        {
+            if (data && step[i] != CV_AUTOSTEP)
+            {
+                total = step[i];
+            }
+            else
+            {
+                step[i] = total;
+            }
+        }
+        total *= sizes[i];
+    }
+
+    void *header = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(header_mutex);
+        if (!free_headers.empty())
+        {
+            header = free_headers.back();
+            free_headers.pop_back();
+        }
+    }
+    if (!header)
+    {
+        header = ::operator new(sizeof(cv::UMatData));
+    }
+
+    cv::UMatData *u = new (header) cv::UMatData(this);
+    u->data = u->origdata = static_cast<uchar *>(data ? data : pool.allocate(total));
+    u->size = total;
+    if (data)
+    {
+        u->flags |= cv::UMatData::USER_ALLOCATED;
+    }
+
+    return u;
+}
+
+bool PooledMatAllocator::allocate(cv::UMatData *data, cv::AccessFlag, cv::UMatUsageFlags) const
+{
+    return data != nullptr;
+}
+
+/*
+ * Function to give the buffer of a cv::Mat back to the pool
+ *
+ * @param u: header of the buffer, no longer referenced by any cv::Mat
+ */
+void PooledMatAllocator::deallocate(cv::UMatData *u) const
+{
+    if (!u)
+    {
+        return;
+    }
+
+    CV_Assert(u->urefcount == 0);
+    CV_Assert(u->refcount == 0);
+    if (!(u->flags & cv::UMatData::USER_ALLOCATED))
+    {
+        pool.release(u->origdata);
+        u->origdata = nullptr;
+    }
+
+    u->~UMatData();
+    std::lock_guard<std::mutex> lock(header_mutex);
+    free_headers.push_back(u);
+}
@@ -0,0 +1,84 @@
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+class Counter;
+class Gauge;
+
+// Recycles frame sized buffers. Blocks are rounded up to a size class,
+// aligned to a cache line and carry a reference count; when the last
+// reference is released they go back to the free list of their class instead
+// of the heap, so a stream of equally sized frames stops calling malloc once
+// every stage has seen a frame. Free blocks beyond max_cached_bytes are
+// returned to the heap to keep the resident size bounded.
+class FramePool
+{
+public:
+    static constexpr size_t ALIGNMENT = 64;
+
+    explicit FramePool(size_t max_cached_bytes = size_t(256) << 20);
+    ~FramePool();
+
+    FramePool(const FramePool &) = delete;
+    FramePool &operator=(const FramePool &) = delete;
+
+    static FramePool &global();
+
+    void *allocate(size_t size);
+    void retain(void *data);
+    void release(void *data);
+    void trim();
+
+    size_t cachedBytes();
+    static size_t capacity(const void *data);
+
+private:
+    struct alignas(ALIGNMENT) Block
+    {
+        size_t capacity;
+        std::atomic<int> references;
+    };
+
+    size_t max_cached_bytes;
+    size_t cached_bytes;
+    std::mutex mutex;
+    std::unordered_map<size_t, std::vector<Block *>> free_blocks;
+    Counter &heap_allocations;
+    Gauge &cached_gauge;
+
+    static size_t sizeClass(size_t size);
+    static Block *blockOf(const void *data);
+};
+
+
+// cv::MatAllocator backed by a FramePool. Installed as the default allocator,
+// it covers every cv::Mat of the pipeline: decode, resize, float conversion,
+// annotated copies and the images queued for encoding. The UMatData headers
+// are recycled as well.
+class PooledMatAllocator : public cv::MatAllocator
+{
+public:
+    explicit PooledMatAllocator(FramePool &pool = FramePool::global());
+    ~PooledMatAllocator() override;
+
+    static PooledMatAllocator &global();
+    static void install();
+
+    cv::UMatData *allocate(int dims, const int *sizes, int type, void *data, size_t *step, cv::AccessFlag flags, cv::UMatUsageFlags usage_flags) const override;
+    bool allocate(cv::UMatData *data, cv::AccessFlag access_flags, cv::UMatUsageFlags usage_flags) const override;
+    void deallocate(cv::UMatData *data) const override;
+
+private:
+    FramePool &pool;
+    mutable std::mutex header_mutex;
+    mutable std::vector<void *> free_headers;
+};
+
+
+#endif // FRAME_POOL_H
@@ -0,0 +1,136 @@
+#ifndef RCU_POINTER_H
+#define RCU_POINTER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Pointer that readers dereference without locks while a writer replaces it.
+// Readers register in the counter of the current epoch; a writer publishes
+// the new object, flips the epoch and waits until the old epoch has no
+// readers left before handing the old object back. Reads are two atomic
+// increments, so they suit per-request paths; writes are rare and may block
+// for as long as the slowest reader holds its guard.
+template <typename T>
+class RcuPointer
+{
+public:
+    class ReadGuard
+    {
+    public:
+        ReadGuard(ReadGuard &&other) noexcept
+            : readers(other.readers), object(other.object)
+        {
+            other.readers = nullptr;
+            other.object = nullptr;
+        }
+
+        ReadGuard(const ReadGuard &) = delete;
+        ReadGuard &operator=(const ReadGuard &) = delete;
+        ReadGuard &operator=(ReadGuard &&) = delete;
+
+        ~ReadGuard()
+        {
+            if (readers)
+            {
+                readers->fetch_sub(1, std::memory_order_release);
+            }
+        }
+
+        T *get() const { return object; }
+        T &operator*() const { return *object; }
+        T *operator->() const { return object; }
+
+    private:
+        friend class RcuPointer;
+
+        ReadGuard(std::atomic<int64_t> *readers, T *object)
+            : readers(readers), object(object)
+        {
+        }
+
+        std::atomic<int64_t> *readers;
+        T *object;
+    };
+
+    explicit RcuPointer(std::unique_ptr<T> initial = nullptr)
+        : current(initial.release()), epoch(0)
+    {
+        counters[0].readers.store(0);
+        counters[1].readers.store(0);
+    }
+
+    ~RcuPointer()
+    {
+        delete current.load();
+    }
+
+    RcuPointer(const RcuPointer &) = delete;
+    RcuPointer &operator=(const RcuPointer &) = delete;
+
+    /*
+     * Function to pin the current object for the lifetime of the guard
+     *
+     * @return: guard giving access to the object, never blocks
+     */
+    ReadGuard read() const
+    {
+        while (true)
+        {
+            const unsigned int observed = epoch.load(std::memory_order_seq_cst);
+            std::atomic<int64_t> &readers = counters[observed].readers;
+            readers.fetch_add(1, std::memory_order_seq_cst);
+
+            // A writer flipped the epoch in between and may not wait for this counter
+            if (epoch.load(std::memory_order_seq_cst) == observed)
+            {
+                return ReadGuard(&readers, current.load(std::memory_order_seq_cst));
+            }
+            readers.fetch_sub(1, std::memory_order_release);
+        }
+    }
+
+    /*
+     * Function to publish a new object
+     *
+     * Returns once no reader can still see the old object.
+     *
+     * @param replacement: object to publish
+     *
+     * @return: the previous object, safe to destroy
+     */
+    std::unique_ptr<T> exchange(std::unique_ptr<T> replacement)
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+
+        T *previous = current.exchange(replacement.release(), std::memory_order_seq_cst);
+        const unsigned int old_epoch = epoch.load(std::memory_order_seq_cst);
+        epoch.store(old_epoch ^ 1u, std::memory_order_seq_cst);
+
+        // Readers of the new epoch can only have seen the new object
+        std::atomic<int64_t> &readers = counters[old_epoch].readers;
+        while (readers.load(std::memory_order_acquire) != 0)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+
+        return std::unique_ptr<T>(previous);
+    }
+
+private:
+    struct alignas(64) Counter
+    {
+        std::atomic<int64_t> readers;
+    };
+
+    std::atomic<T *> current;
+    std::atomic<unsigned int> epoch;
+    mutable Counter counters[2];
+    std::mutex writer_mutex;
+};
+
+
+#endif // RCU_POINTER_H
@@ -0,0 +1,361 @@
+#include "metrics.h"
+#include "trace.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+
+namespace
+{
+    double bitsToDouble(uint64_t bits)
+    {
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    uint64_t doubleToBits(double value)
+    {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    std::string formatNumber(double value)
+    {
+        if (std::isinf(value))
+        {
+            return value > 0 ? "+Inf" : "-Inf";
+        }
+
+        char text[32];
+        std::snprintf(text, sizeof(text), "%.9g", value);
+        return text;
+    }
+
+    std::string withLabels(const std::string &name, const std::string &labels, const std::string &extra = "")
+    {
+        if (labels.empty() && extra.empty())
+        {
+            return name;
+        }
+        return name + "{" + labels + (labels.empty() || extra.empty() ? "" : ",") + extra + "}";
+    }
+}
+
+/*
+ * Function to get the shard of the calling thread
+ *
+ * @return: index in [0, METRIC_SHARDS), fixed for the lifetime of the thread
+ */
+size_t metricShardIndex()
+{
+    static std::atomic<size_t> next_index{0};
+    thread_local size_t index = next_index.fetch_add(1, std::memory_order_relaxed) % METRIC_SHARDS;
+    return index;
+}
+
+void Counter::increment(uint64_t amount)
+{
+    shards[metricShardIndex()].value.fetch_add(amount, std::memory_order_relaxed);
+}
+
+uint64_t Counter::value() const
+{
+    uint64_t total = 0;
+    for (const auto &shard : shards)
+    {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void Gauge::set(int64_t value)
+{
+    current.store(value, std::memory_order_relaxed);
+}
+
+void Gauge::add(int64_t amount)
+{
+    current.fetch_add(amount, std::memory_order_relaxed);
+}
+
+int64_t Gauge::value() const
+{
+    return current.load(std::memory_order_relaxed);
+}
+
+/*
+ * Function to create a histogram
+ *
+ * @param bounds: upper bounds of the buckets, an implicit +Inf bucket is added
+ */
+Histogram::Histogram(std::vector<double> bounds)
+    : upper_bounds(std::move(bounds))
+{
+    std::sort(upper_bounds.begin(), upper_bounds.end());
+    for (auto &shard : shards)
+    {
+        shard.counts.reset(new std::atomic<uint64_t>[upper_bounds.size() + 1]);
+        for (size_t i = 0; i <= upper_bounds.size(); ++i)
+        {
+            shard.counts[i].store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+void Histogram::observe(double value)
+{
+    size_t bucket = std::lower_bound(upper_bounds.begin(), upper_bounds.end(), value) - upper_bounds.begin();
+    Shard &shard = shards[metricShardIndex()];
+    shard.counts[bucket].fetch_add(1, std::memory_order_relaxed);
+
+    // Only threads mapped to the same shard can race here
+    uint64_t expected = shard.sum_bits.load(std::memory_order_relaxed);
+    while (!shard.sum_bits.compare_exchange_weak(expected, doubleToBits(bitsToDouble(expected) + value), std::memory_order_relaxed))
+    {
+    }
+}
+
+const std::vector<double> &Histogram::bounds() const
+{
+    return upper_bounds;
+}
+
+/*
+ * Function to get the Prometheus style cumulative bucket counts
+ *
+ * @return: one count per bound followed by the +Inf count
+ */
+std::vector<uint64_t> Histogram::cumulativeCounts() const
+{
+    std::vector<uint64_t> counts(upper_bounds.size() + 1, 0);
+    for (const auto &shard : shards)
+    {
+        for (size_t i = 0; i < counts.size(); ++i)
+        {
+            counts[i] += shard.counts[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    for (size_t i = 1; i < counts.size(); ++i)
+    {
+        counts[i] += counts[i - 1];
+    }
+    return counts;
+}
+
+double Histogram::sum() const
+{
+    double total = 0;
+    for (const auto &shard : shards)
+    {
+        total += bitsToDouble(shard.sum_bits.load(std::memory_order_relaxed));
+    }
+    return total;
+}
+
+uint64_t Histogram::count() const
+{
+    return cumulativeCounts().back();
+}
+
+MetricsRegistry &MetricsRegistry::global()
+{
+    static MetricsRegistry registry;
+    return registry;
+}
+
+MetricsRegistry::Family &MetricsRegistry::family(const std::string &name, const std::string &help, const std::string &type)
+{
+    Family &entry = families[name];
+    if (entry.type.empty())
+    {
+        entry.help = help;
+        entry.type = type;
+    }
+    else if (entry.type != type)
+    {
+        throw std::runtime_error("Metric " + name + " is already registered as a " + entry.type);
+    }
+    return entry;
+}
+
+/*
+ * Function to get or register a counter
+ *
+ * Registration takes a lock, so callers keep the returned reference (for
+ * example in a function local static) instead of looking it up per event.
+ *
+ * @param name: metric name
+ * @param help: description exported with the metric
+ * @param labels: Prometheus label set without braces, e.g. stage="decode"
+ *
+ * @return: the counter, valid for the lifetime of the registry
+ */
+Counter &MetricsRegistry::counter(const std::string &name, const std::string &help, const std::string &labels)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto &slot = family(name, help, "counter").counters[labels];
+    if (!slot)
+    {
+        slot = std::make_unique<Counter>();
+    }
+    return *slot;
+}
+
+Gauge &MetricsRegistry::gauge(const std::string &name, const std::string &help, const std::string &labels)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto &slot = family(name, help, "gauge").gauges[labels];
+    if (!slot)
+    {
+        slot = std::make_unique<Gauge>();
+    }
+    return *slot;
+}
+
+Histogram &MetricsRegistry::histogram(const std::string &name, const std::string &help, const std::string &labels, const std::vector<double> &bounds)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto &slot = family(name, help, "histogram").histograms[labels];
+    if (!slot)
+    {
+        slot = std::make_unique<Histogram>(bounds);
+    }
+    return *slot;
+}
+
+/*
+ * Function to render every metric in the Prometheus text exposition format
+ *
+ * @return: text suitable for a /metrics endpoint or a textfile collector
+ */
+std::string MetricsRegistry::renderPrometheus()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::string out;
+
+    for (const auto &entry : families)
+    {
+        const std::string &name = entry.first;
+        const Family &family = entry.second;
+        out += "# HELP " + name + " " + family.help + "\n";
+        out += "# TYPE " + name + " " + family.type + "\n";
+
+        for (const auto &counter : family.counters)
+        {
+            out += withLabels(name, counter.first) + " " + std::to_string(counter.second->value()) + "\n";
+        }
+        for (const auto &gauge : family.gauges)
+        {
+            out += withLabels(name, gauge.first) + " " + std::to_string(gauge.second->value()) + "\n";
+        }
+        for (const auto &histogram : family.histograms)
+        {
+            const std::string &labels = histogram.first;
+            const std::vector<double> &bounds = histogram.second->bounds();
+            std::vector<uint64_t> counts = histogram.second->cumulativeCounts();
+
+            for (size_t i = 0; i < counts.size(); ++i)
+            {
+                double bound = i < bounds.size() ? bounds[i] : INFINITY;
+                out += withLabels(name + "_bucket", labels, "le=\"" + formatNumber(bound) + "\"") + " " + std::to_string(counts[i]) + "\n";
+            }
+            out += withLabels(name + "_sum", labels) + " " + formatNumber(histogram.second->sum()) + "\n";
+            out += withLabels(name + "_count", labels) + " " + std::to_string(counts.back()) + "\n";
+        }
+    }
+
+    return out;
+}
+
+/*
+ * Function to dump the metrics to a file
+ *
+ * The file is written next to the target and renamed over it, so a
+ * collector never reads a partial dump.
+ *
+ * @param path: output file
+ */
+void MetricsRegistry::writeToFile(const std::string &path)
+{
+    std::string text = renderPrometheus();
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::trunc);
+        file << text;
+        if (!file)
+        {
+            throw std::runtime_error("Could not write metrics to: " + temporary);
+        }
+    }
+
+    if (std::rename(temporary.c_str(), path.c_str()) != 0)
+    {
+        throw std::runtime_error("Could not write metrics to: " + path);
+    }
+}
+
+/*
+ * Function to get the default latency buckets
+ *
+ * @return: 50us to about 13s in factor two steps, in seconds
+ */
+std::vector<double> MetricsRegistry::latencyBounds()
+{
+    std::vector<double> bounds;
+    for (double bound = 50e-6; bound < 15.0; bound *= 2)
+    {
+        bounds.push_back(bound);
+    }
+    return bounds;
+}
+
+std::vector<double> MetricsRegistry::linearBounds(double start, double width, int count)
+{
+    std::vector<double> bounds;
+    for (int i = 0; i < count; ++i)
+    {
+        bounds.push_back(start + width * i);
+    }
+    return bounds;
+}
+
+ScopedTimer::ScopedTimer(Histogram &histogram, const char *trace_name)
+    : histogram(histogram),
+      start(std::chrono::steady_clock::now()),
+      trace_name(trace_name),
+      trace_begin_us(trace_name && Tracer::global().enabled() ? Tracer::global().nowMicros() : -1)
+{
+}
+
+ScopedTimer::~ScopedTimer()
+{
+    histogram.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+    if (trace_begin_us >= 0)
+    {
+        Tracer &tracer = Tracer::global();
+        tracer.record(trace_name, trace_begin_us, tracer.nowMicros());
+    }
+}
+
+Histogram &stageHistogram(const std::string &stage)
+{
+    return MetricsRegistry::global().histogram("yolov10_stage_duration_seconds", "Time spent in each pipeline stage", "stage=\"" + stage + "\"");
+}
+
+Counter &bufferAllocations()
+{
+    return MetricsRegistry::global().counter("yolov10_buffer_allocations_total", "Heap allocations of per-frame tensor and image buffers");
+}
+
+Gauge &queueDepthGauge(const std::string &queue)
+{
+    return MetricsRegistry::global().gauge("yolov10_queue_depth", "Number of items waiting in a queue", "queue=\"" + queue + "\"");
+}
@@ -0,0 +1,132 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Lock-free counters, gauges and histograms. Every metric is split into
+// cache line sized shards and each thread updates its own shard, so hot
+// paths never contend; shards are only summed when the metrics are read.
+
+const size_t METRIC_SHARDS = 16;
+
+size_t metricShardIndex();
+
+
+class Counter
+{
+public:
+    void increment(uint64_t amount = 1);
+    uint64_t value() const;
+
+private:
+    struct alignas(64) Shard
+    {
+        std::atomic<uint64_t> value{0};
+    };
+
+    Shard shards[METRIC_SHARDS];
+};
+
+
+class Gauge
+{
+public:
+    void set(int64_t value);
+    void add(int64_t amount);
+    int64_t value() const;
+
+private:
+    std::atomic<int64_t> current{0};
+};
+
+
+class Histogram
+{
+public:
+    explicit Histogram(std::vector<double> bounds);
+
+    void observe(double value);
+
+    const std::vector<double> &bounds() const;
+    std::vector<uint64_t> cumulativeCounts() const;
+    double sum() const;
+    uint64_t count() const;
+
+private:
+    struct alignas(64) Shard
+    {
+        std::unique_ptr<std::atomic<uint64_t>[]> counts;
+        std::atomic<uint64_t> sum_bits{0};
+    };
+
+    std::vector<double> upper_bounds;
+    Shard shards[METRIC_SHARDS];
+};
+
+
+class MetricsRegistry
+{
+public:
+    static MetricsRegistry &global();
+
+    Counter &counter(const std::string &name, const std::string &help, const std::string &labels = "");
+    Gauge &gauge(const std::string &name, const std::string &help, const std::string &labels = "");
+    Histogram &histogram(const std::string &name, const std::string &help, const std::string &labels = "", const std::vector<double> &bounds = latencyBounds());
+
+    std::string renderPrometheus();
+    void writeToFile(const std::string &path);
+
+    static std::vector<double> latencyBounds();
+    static std::vector<double> linearBounds(double start, double width, int count);
+
+private:
+    struct Family
+    {
+        std::string help;
+        std::string type;
+        std::map<std::string, std::unique_ptr<Counter>> counters;
+        std::map<std::string, std::unique_ptr<Gauge>> gauges;
+        std::map<std::string, std::unique_ptr<Histogram>> histograms;
+    };
+
+    std::mutex mutex;
+    std::map<std::string, Family> families;
+
+    Family &family(const std::string &name, const std::string &help, const std::string &type);
+};
+
+
+// Observes the lifetime of the scope, in seconds, into a histogram and,
+// when tracing is enabled, records it as a named event in the timeline
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(Histogram &histogram, const char *trace_name = nullptr);
+    ~ScopedTimer();
+
+private:
+    Histogram &histogram;
+    std::chrono::steady_clock::time_point start;
+    const char *trace_name;
+    int64_t trace_begin_us;
+};
+
+
+// Latency histogram of one pipeline stage (decode, preprocess, inference, ...)
+Histogram &stageHistogram(const std::string &stage);
+
+// Per-frame heap allocations of tensor and frame buffers
+Counter &bufferAllocations();
+
+// Current length of a named queue (batch, encoder, ...)
+Gauge &queueDepthGauge(const std::string &queue);
+
+
+#endif // METRICS_H
@@ -0,0 +1,252 @@
+#include "trace.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace
+{
+    void appendJsonString(std::string &out, const std::string &value)
+    {
+        out += '"';
+        for (char c : value)
+        {
+            if (c == '"' || c == '\\')
+            {
+                out += '\\';
+            }
+            out += static_cast<unsigned char>(c) < 0x20 ? ' ' : c;
+        }
+        out += '"';
+    }
+
+    /*
+     * Function to append the events of an ONNX Runtime profile
+     *
+     * The profile is a JSON array with one event per line whose "ts" is
+     * relative to the start of the session's profiling; it is shifted onto
+     * the tracer's clock so both end up in one timeline.
+     */
+    void appendOrtProfile(std::string &out, const std::string &path, int64_t offset_us)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            throw std::runtime_error("Could not read ONNX Runtime profile: " + path);
+        }
+
+        std::string line;
+        while (std::getline(file, line))
+        {
+            size_t open = line.find('{');
+            size_t close = line.rfind('}');
+            if (open == std::string::npos || close == std::string::npos)
+            {
+                continue;
+            }
+            std::string event = line.substr(open, close - open + 1);
+
+            size_t key = event.find("\"ts\"");
+            size_t colon = key == std::string::npos ? key : event.find(':', key);
+            if (colon != std::string::npos)
+            {
+                size_t digits = event.find_first_of("-0123456789", colon);
+                if (digits != std::string::npos)
+                {
+                    size_t end = event.find_first_not_of("0123456789", digits + 1);
+                    long long ts = std::atoll(event.substr(digits, end - digits).c_str());
+                    event.replace(digits, end - digits, std::to_string(ts + offset_us));
+                }
+            }
+
+            out += ",\n";
+            out += event;
+        }
+    }
+}
+
+Tracer &Tracer::global()
+{
+    static Tracer tracer;
+    return tracer;
+}
+
+Tracer::Tracer()
+    : active(false),
+      start(std::chrono::steady_clock::now()),
+      start_system_ns(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count())
+{
+}
+
+Tracer::~Tracer()
+{
+    for (auto &buffer : buffers)
+    {
+        Chunk *chunk = buffer->head.release();
+        while (chunk)
+        {
+            Chunk *next = chunk->next.load();
+            delete chunk;
+            chunk = next;
+        }
+    }
+}
+
+void Tracer::enable()
+{
+    active.store(true);
+}
+
+bool Tracer::enabled() const
+{
+    return active.load(std::memory_order_relaxed);
+}
+
+int64_t Tracer::nowMicros() const
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+/*
+ * Function to get the buffer of the calling thread, creating it on first use
+ */
+Tracer::ThreadBuffer &Tracer::threadBuffer()
+{
+    thread_local ThreadBuffer *buffer = nullptr;
+    if (!buffer)
+    {
+        auto created = std::make_unique<ThreadBuffer>();
+        created->head = std::make_unique<Chunk>();
+        created->tail = created->head.get();
+        created->frame = -1;
+
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+        created->tid = static_cast<int>(buffers.size()) + 1;
+        buffer = created.get();
+        buffers.push_back(std::move(created));
+    }
+    return *buffer;
+}
+
+/*
+ * Function to append a complete event to the calling thread's buffer
+ *
+ * @param name: stage name, must outlive the tracer (a string literal)
+ * @param begin_us: start time from nowMicros
+ * @param end_us: end time from nowMicros
+ */
+void Tracer::record(const char *name, int64_t begin_us, int64_t end_us)
+{
+    ThreadBuffer &buffer = threadBuffer();
+    Chunk *chunk = buffer.tail;
+
+    size_t index = chunk->count.load(std::memory_order_relaxed);
+    if (index == Chunk::CAPACITY)
+    {
+        Chunk *next = new Chunk();
+        chunk->next.store(next, std::memory_order_release);
+        buffer.tail = chunk = next;
+        index = 0;
+    }
+
+    chunk->events[index] = {name, begin_us, end_us, buffer.frame};
+    chunk->count.store(index + 1, std::memory_order_release);
+}
+
+void Tracer::setThreadName(const std::string &name)
+{
+    if (!enabled())
+    {
+        return;
+    }
+
+    ThreadBuffer &buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    buffer.name = name;
+}
+
+/*
+ * Function to tag the following events of the calling thread with a frame
+ *
+ * @param frame: frame index, -1 to clear it
+ */
+void Tracer::setFrame(int64_t frame)
+{
+    if (enabled())
+    {
+        threadBuffer().frame = frame;
+    }
+}
+
+/*
+ * Function to write every recorded event as a Chrome trace JSON file
+ *
+ * @param path: output file
+ * @param ort_profiles: ONNX Runtime profiles to merge into the timeline, each
+ *                      shifted by the profiling start time of its own session
+ */
+void Tracer::writeChromeTrace(const std::string &path, const std::vector<OrtProfile> &ort_profiles)
+{
+    const int pid = static_cast<int>(getpid());
+    std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" + std::to_string(pid) + ",\"tid\":0,\"args\":{\"name\":\"yolov10_cpp\"}}";
+
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    char line[256];
+    for (const auto &buffer : buffers)
+    {
+        if (!buffer->name.empty())
+        {
+            out += ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + std::to_string(pid) + ",\"tid\":" + std::to_string(buffer->tid) + ",\"args\":{\"name\":";
+            appendJsonString(out, buffer->name);
+            out += "}}";
+        }
+
+        for (const Chunk *chunk = buffer->head.get(); chunk; chunk = chunk->next.load(std::memory_order_acquire))
+        {
+            const size_t count = chunk->count.load(std::memory_order_acquire);
+            for (size_t i = 0; i < count; ++i)
+            {
+                const Event &event = chunk->events[i];
+                std::snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"cat\":\"pipeline\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%lld,\"dur\":%lld",
+                              event.name, pid, buffer->tid, static_cast<long long>(event.begin_us), static_cast<long long>(event.end_us - event.begin_us));
+                out += line;
+                if (event.frame >= 0)
+                {
+                    std::snprintf(line, sizeof(line), ",\"args\":{\"frame\":%lld}", static_cast<long long>(event.frame));
+                    out += line;
+                }
+                out += "}";
+            }
+        }
+    }
+
+    for (const auto &profile : ort_profiles)
+    {
+        appendOrtProfile(out, profile.path, (static_cast<int64_t>(profile.start_ns) - start_system_ns) / 1000);
+    }
+    out += "\n]}\n";
+
+    std::ofstream file(path, std::ios::trunc);
+    file << out;
+    if (!file)
+    {
+        throw std::runtime_error("Could not write trace to: " + path);
+    }
+}
+
+TraceScope::TraceScope(const char *name)
+    : name(name),
+      begin_us(Tracer::global().enabled() ? Tracer::global().nowMicros() : -1)
+{
+}
+
+TraceScope::~TraceScope()
+{
+    if (begin_us >= 0)
+    {
+        Tracer &tracer = Tracer::global();
+        tracer.record(name, begin_us, tracer.nowMicros());
+    }
+}
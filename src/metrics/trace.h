@@ -0,0 +1,95 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Profile file of one ONNX Runtime session and the time its profiler started,
+// which differs from session to session
+struct OrtProfile
+{
+    std::string path;
+    uint64_t start_ns;
+};
+
+
+// Opt-in timeline of the pipeline stages in the Chrome trace event format
+// (chrome://tracing, ui.perfetto.dev). Every thread appends to its own
+// chunked buffer without locks; the buffers are only read when the trace
+// is written, usually at exit.
+class Tracer
+{
+public:
+    static Tracer &global();
+
+    void enable();
+    bool enabled() const;
+
+    void record(const char *name, int64_t begin_us, int64_t end_us);
+    int64_t nowMicros() const;
+
+    void setThreadName(const std::string &name);
+    void setFrame(int64_t frame);
+
+    void writeChromeTrace(const std::string &path, const std::vector<OrtProfile> &ort_profiles = {});
+
+private:
+    struct Event
+    {
+        const char *name;
+        int64_t begin_us;
+        int64_t end_us;
+        int64_t frame;
+    };
+
+    struct Chunk
+    {
+        static constexpr size_t CAPACITY = 4096;
+
+        Event events[CAPACITY];
+        std::atomic<size_t> count{0};
+        std::atomic<Chunk *> next{nullptr};
+    };
+
+    struct ThreadBuffer
+    {
+        int tid;
+        std::string name;
+        std::unique_ptr<Chunk> head;
+        Chunk *tail;
+        int64_t frame;
+    };
+
+    Tracer();
+    ~Tracer();
+
+    ThreadBuffer &threadBuffer();
+
+    std::atomic<bool> active;
+    std::chrono::steady_clock::time_point start;
+    int64_t start_system_ns;
+
+    std::mutex buffers_mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+};
+
+
+// Records the lifetime of the scope as one complete event when tracing is on
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name);
+    ~TraceScope();
+
+private:
+    const char *name;
+    int64_t begin_us;
+};
+
+
+#endif // TRACE_H
@@ -0,0 +1,454 @@
+#include "http_server.h"
+#include "uds_protocol.h"
+#include <algorithm>
+#include <chrono>
+#include <arpa/inet.h>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdexcept>
+#include <system_error>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+    const size_t MAX_HEADER_SIZE = 16 << 10;
+
+    const char *statusText(int status)
+    {
+        switch (status)
+        {
+        case 200:
+            return "OK";
+        case 400:
+            return "Bad Request";
+        case 404:
+            return "Not Found";
+        case 411:
+            return "Length Required";
+        case 413:
+            return "Payload Too Large";
+        case 431:
+            return "Request Header Fields Too Large";
+        case 500:
+            return "Internal Server Error";
+        case 503:
+            return "Service Unavailable";
+        default:
+            return "Unknown";
+        }
+    }
+
+    std::string lowercase(std::string value)
+    {
+        std::transform(value.begin(), value.end(), value.begin(), [](unsigned char c)
+                       { return static_cast<char>(std::tolower(c)); });
+        return value;
+    }
+
+    std::string trim(const std::string &value)
+    {
+        size_t begin = value.find_first_not_of(" \t");
+        size_t end = value.find_last_not_of(" \t\r");
+        return begin == std::string::npos ? "" : value.substr(begin, end - begin + 1);
+    }
+
+    /*
+     * Function to parse the request line and headers
+     *
+     * @return: false if the header block is malformed
+     */
+    bool parseHeader(const char *data, size_t size, HttpRequest &request)
+    {
+        std::string header(data, size);
+        size_t line_end = header.find("\r\n");
+        std::string request_line = header.substr(0, line_end);
+
+        size_t first_space = request_line.find(' ');
+        size_t second_space = request_line.find(' ', first_space + 1);
+        if (first_space == std::string::npos || second_space == std::string::npos)
+        {
+            return false;
+        }
+
+        request.method = request_line.substr(0, first_space);
+        std::string target = request_line.substr(first_space + 1, second_space - first_space - 1);
+        std::string version = request_line.substr(second_space + 1);
+
+        size_t question = target.find('?');
+        request.path = target.substr(0, question);
+        request.query = question == std::string::npos ? "" : target.substr(question + 1);
+        request.headers.clear();
+        request.headers[":version"] = version;
+
+        size_t position = line_end == std::string::npos ? header.size() : line_end + 2;
+        while (position < header.size())
+        {
+            size_t next = header.find("\r\n", position);
+            if (next == std::string::npos)
+            {
+                next = header.size();
+            }
+
+            std::string line = header.substr(position, next - position);
+            size_t colon = line.find(':');
+            if (colon != std::string::npos)
+            {
+                request.headers[lowercase(trim(line.substr(0, colon)))] = trim(line.substr(colon + 1));
+            }
+            position = next + 2;
+        }
+
+        return true;
+    }
+
+    bool wantsKeepAlive(const HttpRequest &request)
+    {
+        auto it = request.headers.find("connection");
+        std::string connection = it == request.headers.end() ? "" : lowercase(it->second);
+
+        if (request.headers.at(":version") == "HTTP/1.0")
+        {
+            return connection == "keep-alive";
+        }
+        return connection != "close";
+    }
+}
+
+std::string HttpRequest::queryParameter(const std::string &name, const std::string &fallback) const
+{
+    size_t position = 0;
+    while (position <= query.size())
+    {
+        size_t end = query.find('&', position);
+        if (end == std::string::npos)
+        {
+            end = query.size();
+        }
+
+        std::string pair = query.substr(position, end - position);
+        size_t equals = pair.find('=');
+        if (pair.substr(0, equals) == name)
+        {
+            return equals == std::string::npos ? "" : pair.substr(equals + 1);
+        }
+        position = end + 1;
+    }
+
+    return fallback;
+}
+
+/*
+ * Function to open the listening socket
+ *
+ * @param host: IPv4 address to bind, e.g. "127.0.0.1"
+ * @param port: TCP port
+ * @param max_body_size: largest accepted request body in bytes
+ * @param max_connections: connections served at once, each by its own thread
+ */
+HttpServer::HttpServer(const std::string &host, int port, size_t max_body_size, size_t max_connections)
+    : listen_fd(-1),
+      max_body_size(max_body_size),
+      max_connections(std::max<size_t>(1, max_connections))
+{
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1)
+    {
+        throw std::runtime_error("Invalid listen address: " + host);
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int enable = 1;
+    if (fd < 0 ||
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable)) != 0 ||
+        bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+        listen(fd, 512) != 0)
+    {
+        int error = errno;
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        throw std::runtime_error("Could not listen on " + host + ":" + std::to_string(port) + ": " + std::strerror(error));
+    }
+    listen_fd = fd;
+}
+
+HttpServer::~HttpServer()
+{
+    stop();
+}
+
+void HttpServer::route(const std::string &method, const std::string &path, Handler handler)
+{
+    routes[method + " " + path] = std::move(handler);
+}
+
+/*
+ * Function to accept connections until stop is called
+ *
+ * Running out of descriptors or memory only pauses accepting; any other
+ * accept error is thrown once the open connections are done.
+ */
+void HttpServer::run()
+{
+    std::string failure;
+    while (listen_fd >= 0)
+    {
+        // At the limit further connections wait in the listen backlog
+        {
+            std::unique_lock<std::mutex> lock(connections_mutex);
+            if (!connections_cv.wait_for(lock, std::chrono::milliseconds(200), [this]
+                                         { return connections.size() < max_connections; }))
+            {
+                continue;
+            }
+        }
+
+        int client = accept(listen_fd, nullptr, nullptr);
+        if (client < 0)
+        {
+            if (listen_fd < 0)
+            {
+                break;
+            }
+            if (errno == EINTR || errno == ECONNABORTED)
+            {
+                continue;
+            }
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM)
+            {
+                // Give the open connections time to finish
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                continue;
+            }
+            failure = std::string("accept failed: ") + std::strerror(errno);
+            break;
+        }
+
+        int enable = 1;
+        setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        timeval timeout{30, 0};
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        std::lock_guard<std::mutex> lock(connections_mutex);
+        connections.insert(client);
+        try
+        {
+            std::thread([this, client]
+                        {
+                            serve(client);
+
+                            std::lock_guard<std::mutex> lock(connections_mutex);
+                            connections.erase(client);
+                            close(client);
+                            connections_cv.notify_all(); })
+                .detach();
+        }
+        catch (const std::system_error &e)
+        {
+            // No thread to serve it, the client sees the connection close
+            std::cerr << "Error: " << e.what() << std::endl;
+            connections.erase(client);
+            close(client);
+        }
+    }
+
+    // Wake up idle keep-alive connections and wait for their threads
+    {
+        std::unique_lock<std::mutex> lock(connections_mutex);
+        for (int client : connections)
+        {
+            shutdown(client, SHUT_RDWR);
+        }
+        connections_cv.wait(lock, [this]
+                            { return connections.empty(); });
+    }
+
+    if (!failure.empty())
+    {
+        throw std::runtime_error(failure);
+    }
+}
+
+/*
+ * Function to make run return; safe to call from a signal handler
+ */
+void HttpServer::stop()
+{
+    int fd = listen_fd.exchange(-1);
+    if (fd >= 0)
+    {
+        shutdown(fd, SHUT_RDWR);
+        close(fd);
+    }
+}
+
+/*
+ * Function to serve the requests of one connection
+ *
+ * Pipelined requests are handled in order; bytes belonging to the next
+ * request stay in the buffer.
+ */
+void HttpServer::serve(int fd)
+{
+    std::vector<char> buffer(64 << 10);
+    size_t used = 0;
+    HttpRequest request;
+    HttpResponse response;
+    std::string output;
+
+    while (true)
+    {
+        // Read until the end of the header block
+        size_t header_end = std::string::npos;
+        while (true)
+        {
+            const char *end = std::search(buffer.data(), buffer.data() + used, "\r\n\r\n", "\r\n\r\n" + 4);
+            if (end != buffer.data() + used)
+            {
+                header_end = static_cast<size_t>(end - buffer.data());
+                break;
+            }
+            if (used >= MAX_HEADER_SIZE)
+            {
+                break;
+            }
+            if (used == buffer.size())
+            {
+                buffer.resize(buffer.size() * 2);
+            }
+
+            ssize_t received = recv(fd, buffer.data() + used, buffer.size() - used, 0);
+            if (received < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (received <= 0)
+            {
+                return;
+            }
+            used += static_cast<size_t>(received);
+        }
+
+        response = HttpResponse();
+        bool keep_alive = false;
+        size_t body_size = 0;
+
+        if (header_end == std::string::npos)
+        {
+            response.status = 431;
+        }
+        else if (!parseHeader(buffer.data(), header_end, request))
+        {
+            response.status = 400;
+        }
+        else
+        {
+            keep_alive = wantsKeepAlive(request);
+            auto length = request.headers.find("content-length");
+            if (request.headers.count("transfer-encoding"))
+            {
+                response.status = 411;
+                keep_alive = false;
+            }
+            else if (length != request.headers.end())
+            {
+                try
+                {
+                    body_size = std::stoul(length->second);
+                }
+                catch (const std::exception &)
+                {
+                    response.status = 400;
+                    keep_alive = false;
+                }
+            }
+        }
+
+        if (response.status == 200 && body_size > max_body_size)
+        {
+            response.status = 413;
+            keep_alive = false;
+        }
+
+        if (response.status == 200)
+        {
+            // Read the rest of the body into the same buffer
+            const size_t total = header_end + 4 + body_size;
+            if (buffer.size() < total)
+            {
+                buffer.resize(total);
+            }
+            while (used < total)
+            {
+                ssize_t received = recv(fd, buffer.data() + used, buffer.size() - used, 0);
+                if (received < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (received <= 0)
+                {
+                    return;
+                }
+                used += static_cast<size_t>(received);
+            }
+
+            request.body = buffer.data() + header_end + 4;
+            request.body_size = body_size;
+            dispatch(request, response);
+
+            used -= total;
+            std::memmove(buffer.data(), buffer.data() + total, used);
+        }
+        else
+        {
+            response.content_type = "text/plain";
+            response.body = statusText(response.status);
+        }
+
+        output.clear();
+        output += "HTTP/1.1 " + std::to_string(response.status) + " " + statusText(response.status) + "\r\n";
+        output += "Content-Type: " + response.content_type + "\r\n";
+        output += "Content-Length: " + std::to_string(response.body.size()) + "\r\n";
+        output += keep_alive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+        output += response.body;
+
+        if (!writeFully(fd, output.data(), output.size()) || !keep_alive)
+        {
+            return;
+        }
+    }
+}
+
+void HttpServer::dispatch(const HttpRequest &request, HttpResponse &response)
+{
+    auto it = routes.find(request.method + " " + request.path);
+    if (it == routes.end())
+    {
+        response.status = 404;
+        response.content_type = "text/plain";
+        response.body = statusText(404);
+        return;
+    }
+
+    try
+    {
+        it->second(request, response);
+    }
+    catch (const std::exception &e)
+    {
+        response.status = 500;
+        response.content_type = "text/plain";
+        response.body = e.what();
+    }
+}
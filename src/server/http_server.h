@@ -0,0 +1,64 @@
+#ifndef HTTP_SERVER_H
+#define HTTP_SERVER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+
+struct HttpRequest
+{
+    std::string method;
+    std::string path;
+    std::string query;
+    std::map<std::string, std::string> headers;
+    const char *body;
+    size_t body_size;
+
+    std::string queryParameter(const std::string &name, const std::string &fallback = "") const;
+};
+
+
+struct HttpResponse
+{
+    int status = 200;
+    std::string content_type = "application/json";
+    std::string body;
+};
+
+
+// Small HTTP/1.1 server with keep-alive and one thread per connection, up to
+// max_connections at once; further connections wait in the listen backlog.
+// Request bodies stay in the connection's receive buffer and are handed to
+// the handler by pointer, so an uploaded image is never copied or spooled.
+class HttpServer
+{
+public:
+    using Handler = std::function<void(const HttpRequest &request, HttpResponse &response)>;
+
+    HttpServer(const std::string &host, int port, size_t max_body_size = 64 << 20, size_t max_connections = 256);
+    ~HttpServer();
+
+    void route(const std::string &method, const std::string &path, Handler handler);
+    void run();
+    void stop();
+
+private:
+    std::atomic<int> listen_fd;
+    size_t max_body_size;
+    size_t max_connections;
+    std::map<std::string, Handler> routes;
+
+    std::mutex connections_mutex;
+    std::condition_variable connections_cv;
+    std::set<int> connections;
+
+    void serve(int fd);
+    void dispatch(const HttpRequest &request, HttpResponse &response);
+};
+
+
+#endif // HTTP_SERVER_H
@@ -0,0 +1,210 @@
+#include "shm_ring.h"
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    // Anonymous shared memory of the given size, resizable by nobody afterwards
+    int createSharedMemory(size_t size)
+    {
+#ifdef __linux__
+        int fd = memfd_create("yolov10-ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+        if (fd < 0)
+        {
+            throw std::runtime_error(std::string("Could not create shared memory: ") + std::strerror(errno));
+        }
+#else
+        static std::atomic<unsigned> counter{0};
+        const std::string name = "/yolov10-" + std::to_string(getpid()) + "-" + std::to_string(counter++);
+        int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0)
+        {
+            throw std::runtime_error("Could not create shared memory " + name + ": " + std::strerror(errno));
+        }
+        // Only the descriptor is handed out, nobody else can open it by name
+        shm_unlink(name.c_str());
+#endif
+
+        if (ftruncate(fd, static_cast<off_t>(size)) != 0)
+        {
+            int error = errno;
+            close(fd);
+            throw std::runtime_error(std::string("Could not size shared memory: ") + std::strerror(error));
+        }
+
+#ifdef __linux__
+        if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) != 0)
+        {
+            int error = errno;
+            close(fd);
+            throw std::runtime_error(std::string("Could not seal shared memory: ") + std::strerror(error));
+        }
+#endif
+
+        return fd;
+    }
+}
+
+/*
+ * Function to create a new ring
+ *
+ * @param slot_count: number of frames that can be in flight
+ * @param slot_size: bytes per slot, rounded up to a cache line
+ */
+SharedFrameRing::SharedFrameRing(uint32_t slot_count, uint64_t slot_size)
+    : fd(-1),
+      base(nullptr),
+      mapped_size(0),
+      header(nullptr),
+      slot_count(slot_count),
+      slot_size((slot_size + 63) & ~static_cast<uint64_t>(63))
+{
+    if (slot_count == 0 || slot_size == 0)
+    {
+        throw std::runtime_error("Shared memory ring needs at least one non empty slot");
+    }
+
+    const size_t size = DATA_OFFSET + static_cast<size_t>(this->slot_count) * this->slot_size;
+
+    fd = createSharedMemory(size);
+    try
+    {
+        map(size, fd);
+    }
+    catch (...)
+    {
+        close(fd);
+        throw;
+    }
+
+    header->slot_count = this->slot_count;
+    header->slot_size = this->slot_size;
+    header->magic = RING_MAGIC;
+}
+
+/*
+ * Function to map a ring created by another process
+ *
+ * @param ring_fd: descriptor of the ring received from its creator, closed by this
+ */
+SharedFrameRing::SharedFrameRing(int ring_fd)
+    : fd(-1),
+      base(nullptr),
+      mapped_size(0),
+      header(nullptr),
+      slot_count(0),
+      slot_size(0)
+{
+    struct stat info;
+    bool valid = fstat(ring_fd, &info) == 0 && static_cast<size_t>(info.st_size) >= DATA_OFFSET;
+#ifdef __linux__
+    // Without the seal the creator could shrink the ring under our mapping
+    const int seals = fcntl(ring_fd, F_GET_SEALS);
+    valid = valid && seals >= 0 && (seals & F_SEAL_SHRINK);
+#endif
+    if (!valid)
+    {
+        close(ring_fd);
+        throw std::runtime_error("Shared memory is not a sealed frame ring");
+    }
+
+    // The descriptor is not needed once mapped
+    try
+    {
+        map(static_cast<size_t>(info.st_size), ring_fd);
+    }
+    catch (...)
+    {
+        close(ring_fd);
+        throw;
+    }
+    close(ring_fd);
+
+    slot_count = header->slot_count;
+    slot_size = header->slot_size;
+
+    if (header->magic != RING_MAGIC || slot_size == 0 ||
+        slot_count > (mapped_size - DATA_OFFSET) / slot_size)
+    {
+        munmap(base, mapped_size);
+        throw std::runtime_error("Shared memory is not a frame ring");
+    }
+}
+
+SharedFrameRing::~SharedFrameRing()
+{
+    if (base)
+    {
+        munmap(base, mapped_size);
+    }
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+void SharedFrameRing::map(size_t size, int descriptor)
+{
+    void *address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+    if (address == MAP_FAILED)
+    {
+        throw std::runtime_error(std::string("Could not map shared memory: ") + std::strerror(errno));
+    }
+
+    base = static_cast<uint8_t *>(address);
+    mapped_size = size;
+    header = reinterpret_cast<Header *>(base);
+}
+
+int SharedFrameRing::descriptor() const
+{
+    return fd;
+}
+
+uint32_t SharedFrameRing::slotCount() const
+{
+    return slot_count;
+}
+
+uint64_t SharedFrameRing::slotSize() const
+{
+    return slot_size;
+}
+
+uint8_t *SharedFrameRing::slot(uint32_t index) const
+{
+    if (index >= slot_count)
+    {
+        throw std::runtime_error("Shared memory slot out of range");
+    }
+
+    return base + DATA_OFFSET + static_cast<size_t>(index) * slot_size;
+}
+
+/*
+ * Function to view a slot as a BGR image without copying it
+ *
+ * @param index: slot index
+ * @param width: width of the frame
+ * @param height: height of the frame
+ * @param stride: bytes per row, at least width * 3
+ *
+ * @return: cv::Mat header over the shared memory
+ */
+cv::Mat SharedFrameRing::frame(uint32_t index, int width, int height, size_t stride) const
+{
+    if (width <= 0 || height <= 0 || stride < static_cast<size_t>(width) * 3 ||
+        stride * static_cast<size_t>(height) > slot_size)
+    {
+        throw std::runtime_error("Frame does not fit in a shared memory slot");
+    }
+
+    return cv::Mat(height, width, CV_8UC3, slot(index), stride);
+}
@@ -0,0 +1,59 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+
+// Fixed size frame slots in shared memory. The client creates the ring and
+// writes (or decodes) frames straight into a slot, then passes its file
+// descriptor to the server over the socket; the server maps the same ring
+// and wraps the slot in a cv::Mat header without copying it.
+//
+// On Linux the ring is a memfd sealed against resizing, and the server only
+// maps rings that carry the seal: a client truncating a ring the server has
+// mapped would otherwise crash the server with SIGBUS. Elsewhere it is an
+// unlinked POSIX shared memory object, which macOS refuses to resize
+// once it has a size.
+class SharedFrameRing
+{
+public:
+    SharedFrameRing(uint32_t slot_count, uint64_t slot_size);
+    explicit SharedFrameRing(int ring_fd);
+    ~SharedFrameRing();
+
+    SharedFrameRing(const SharedFrameRing &) = delete;
+    SharedFrameRing &operator=(const SharedFrameRing &) = delete;
+
+    int descriptor() const;
+    uint32_t slotCount() const;
+    uint64_t slotSize() const;
+
+    uint8_t *slot(uint32_t index) const;
+    cv::Mat frame(uint32_t index, int width, int height, size_t stride) const;
+
+private:
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t slot_count;
+        uint64_t slot_size;
+    };
+
+    // Kept open by the creator so it can be passed on, -1 otherwise
+    int fd;
+    uint8_t *base;
+    size_t mapped_size;
+    Header *header;
+
+    // Copied out of the header so a misbehaving peer cannot change them
+    uint32_t slot_count;
+    uint64_t slot_size;
+
+    void map(size_t size, int descriptor);
+
+    static constexpr uint32_t RING_MAGIC = 0x474e4952; // "RING"
+    static constexpr size_t DATA_OFFSET = 4096;
+};
+
+
+#endif // SHM_RING_H
@@ -0,0 +1,174 @@
+#include "uds_client.h"
+#include "uds_protocol.h"
+#include "ia/batch_scheduler.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/*
+ * Function to connect to the server and share a new frame ring with it
+ *
+ * @param socket_path: path of the server's Unix domain socket
+ * @param slot_count: number of frame slots
+ * @param slot_size: bytes per slot, 4K BGR by default
+ */
+UdsDetectorClient::UdsDetectorClient(const std::string &socket_path, uint32_t slot_count, uint64_t slot_size)
+    : fd(-1),
+      next_request_id(0)
+{
+    ring = std::make_unique<SharedFrameRing>(slot_count, slot_size);
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path))
+    {
+        throw std::runtime_error("Socket path is too long: " + socket_path);
+    }
+    std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)
+    {
+        int error = errno;
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        throw std::runtime_error("Could not connect to " + socket_path + ": " + std::strerror(error));
+    }
+
+    UdsHelloRequest hello{};
+    hello.magic = UDS_PROTOCOL_MAGIC;
+    hello.version = UDS_PROTOCOL_VERSION;
+
+    UdsHelloResponse response{};
+    if (!writeWithDescriptor(fd, &hello, sizeof(hello), ring->descriptor()) || !readFully(fd, &response, sizeof(response)) || response.status != UDS_STATUS_OK)
+    {
+        close(fd);
+        throw std::runtime_error("Server rejected the connection: " + socket_path);
+    }
+
+    std::string names(response.class_names_size, '\0');
+    if (!readFully(fd, &names[0], names.size()))
+    {
+        close(fd);
+        throw std::runtime_error("Could not read the class names from " + socket_path);
+    }
+
+    std::istringstream stream(names);
+    for (std::string name; std::getline(stream, name);)
+    {
+        class_names.push_back(name);
+    }
+}
+
+UdsDetectorClient::~UdsDetectorClient()
+{
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+/*
+ * Function to get an image backed by a slot of the ring
+ *
+ * Decoding or drawing the frame into this buffer makes it visible to the
+ * server without any further copy.
+ *
+ * @param slot: slot index
+ * @param width: width of the frame
+ * @param height: height of the frame
+ *
+ * @return: BGR cv::Mat over the shared memory
+ */
+cv::Mat UdsDetectorClient::frameBuffer(uint32_t slot, int width, int height)
+{
+    return ring->frame(slot, width, height, static_cast<size_t>(width) * 3);
+}
+
+/*
+ * Function to run detection on a frame already stored in the ring
+ *
+ * @param slot: slot holding the frame written through frameBuffer
+ * @param width: width of the frame
+ * @param height: height of the frame
+ * @param confidence_threshold: minimum confidence threshold
+ * @param deadline: time the response is needed within, 0 for no deadline
+ *
+ * @return: vector of Detection objects, or a DeadlineExceeded error if the
+ *          server shed the request
+ */
+std::vector<Detection> UdsDetectorClient::detect(uint32_t slot, int width, int height, float confidence_threshold, std::chrono::microseconds deadline)
+{
+    UdsDetectRequest request{};
+    request.request_id = next_request_id++;
+    request.slot = slot;
+    request.width = static_cast<uint32_t>(width);
+    request.height = static_cast<uint32_t>(height);
+    request.stride = static_cast<uint32_t>(width) * 3;
+    request.confidence_threshold = confidence_threshold;
+    request.deadline_us = static_cast<uint32_t>(std::min<int64_t>(std::max<int64_t>(deadline.count(), 0), UINT32_MAX));
+
+    UdsDetectResponse response{};
+    if (!writeFully(fd, &request, sizeof(request)) || !readFully(fd, &response, sizeof(response)))
+    {
+        throw std::runtime_error("Lost the connection to the inference server");
+    }
+
+    std::vector<UdsDetection> wire(response.count);
+    if (!readFully(fd, wire.data(), wire.size() * sizeof(UdsDetection)))
+    {
+        throw std::runtime_error("Lost the connection to the inference server");
+    }
+    if (response.status == UDS_STATUS_DEADLINE_EXCEEDED)
+    {
+        throw DeadlineExceeded("Inference server shed the request to keep up");
+    }
+    if (response.status != UDS_STATUS_OK || response.request_id != request.request_id)
+    {
+        throw std::runtime_error("Inference server failed with status " + std::to_string(response.status));
+    }
+
+    std::vector<Detection> detections;
+    detections.reserve(wire.size());
+    for (const auto &entry : wire)
+    {
+        std::string class_name = entry.class_id >= 0 && static_cast<size_t>(entry.class_id) < class_names.size() ? class_names[entry.class_id] : std::to_string(entry.class_id);
+        detections.push_back({entry.confidence, cv::Rect(entry.x, entry.y, entry.width, entry.height), entry.class_id, class_name});
+    }
+
+    return detections;
+}
+
+/*
+ * Function to copy an image into the first slot and run detection on it
+ *
+ * @param image: BGR image
+ * @param confidence_threshold: minimum confidence threshold
+ * @param deadline: time the response is needed within, 0 for no deadline
+ *
+ * @return: vector of Detection objects
+ */
+std::vector<Detection> UdsDetectorClient::detect(const cv::Mat &image, float confidence_threshold, std::chrono::microseconds deadline)
+{
+    if (image.type() != CV_8UC3)
+    {
+        throw std::runtime_error("The inference server expects 8-bit BGR images");
+    }
+
+    cv::Mat buffer = frameBuffer(0, image.cols, image.rows);
+    image.copyTo(buffer);
+
+    return detect(0, image.cols, image.rows, confidence_threshold, deadline);
+}
+
+uint32_t UdsDetectorClient::slotCount() const
+{
+    return ring->slotCount();
+}
@@ -0,0 +1,37 @@
+#ifndef UDS_CLIENT_H
+#define UDS_CLIENT_H
+
+#include "ia/inference.h"
+#include "shm_ring.h"
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Client side of yolov10_uds_server. Frames are written into a shared memory
+// ring owned by the client; only slot descriptors travel over the socket.
+class UdsDetectorClient
+{
+public:
+    UdsDetectorClient(const std::string &socket_path, uint32_t slot_count = 4, uint64_t slot_size = 3840 * 2160 * 3);
+    ~UdsDetectorClient();
+
+    UdsDetectorClient(const UdsDetectorClient &) = delete;
+    UdsDetectorClient &operator=(const UdsDetectorClient &) = delete;
+
+    cv::Mat frameBuffer(uint32_t slot, int width, int height);
+    std::vector<Detection> detect(uint32_t slot, int width, int height, float confidence_threshold, std::chrono::microseconds deadline = std::chrono::microseconds(0));
+    std::vector<Detection> detect(const cv::Mat &image, float confidence_threshold, std::chrono::microseconds deadline = std::chrono::microseconds(0));
+
+    uint32_t slotCount() const;
+
+private:
+    int fd;
+    std::unique_ptr<SharedFrameRing> ring;
+    std::vector<std::string> class_names;
+    uint64_t next_request_id;
+};
+
+
+#endif // UDS_CLIENT_H
@@ -0,0 +1,180 @@
+#include "uds_protocol.h"
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+/*
+ * Function to read exactly size bytes from a socket
+ *
+ * @return: false on error or if the peer closed the connection
+ */
+bool readFully(int fd, void *buffer, size_t size)
+{
+    char *data = static_cast<char *>(buffer);
+    while (size > 0)
+    {
+        ssize_t received = ::read(fd, data, size);
+        if (received < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (received <= 0)
+        {
+            return false;
+        }
+        data += received;
+        size -= static_cast<size_t>(received);
+    }
+
+    return true;
+}
+
+/*
+ * Function to write exactly size bytes to a socket
+ *
+ * @return: false on error, a closed peer does not raise SIGPIPE
+ */
+bool writeFully(int fd, const void *buffer, size_t size)
+{
+    const char *data = static_cast<const char *>(buffer);
+    while (size > 0)
+    {
+        ssize_t sent = ::send(fd, data, size, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (sent <= 0)
+        {
+            return false;
+        }
+        data += sent;
+        size -= static_cast<size_t>(sent);
+    }
+
+    return true;
+}
+
+/*
+ * Function to read exactly size bytes and the file descriptor sent with them
+ *
+ * @param descriptor: set to the received descriptor, or -1 if none came
+ *
+ * @return: false on error or if the peer closed the connection
+ */
+bool readWithDescriptor(int fd, void *buffer, size_t size, int &descriptor)
+{
+    descriptor = -1;
+    if (size == 0)
+    {
+        return true;
+    }
+
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+    iovec data{buffer, size};
+    msghdr message{};
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    ssize_t received;
+    do
+    {
+        received = recvmsg(fd, &message, 0);
+    } while (received < 0 && errno == EINTR);
+    if (received <= 0)
+    {
+        return false;
+    }
+
+    // Keep the first descriptor, close any extra ones the peer sent
+    for (cmsghdr *header = CMSG_FIRSTHDR(&message); header; header = CMSG_NXTHDR(&message, header))
+    {
+        if (header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS)
+        {
+            continue;
+        }
+        const size_t count = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (size_t i = 0; i < count; ++i)
+        {
+            int received_fd;
+            std::memcpy(&received_fd, CMSG_DATA(header) + i * sizeof(int), sizeof(int));
+            if (descriptor < 0)
+            {
+                descriptor = received_fd;
+            }
+            else
+            {
+                close(received_fd);
+            }
+        }
+    }
+    if (message.msg_flags & MSG_CTRUNC)
+    {
+        if (descriptor >= 0)
+        {
+            close(descriptor);
+            descriptor = -1;
+        }
+        return false;
+    }
+
+    const size_t rest = size - static_cast<size_t>(received);
+    if (!readFully(fd, static_cast<char *>(buffer) + received, rest))
+    {
+        if (descriptor >= 0)
+        {
+            close(descriptor);
+            descriptor = -1;
+        }
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ * Function to write exactly size bytes with a file descriptor attached
+ *
+ * @return: false on error, a closed peer does not raise SIGPIPE
+ */
+bool writeWithDescriptor(int fd, const void *buffer, size_t size, int descriptor)
+{
+    if (size == 0)
+    {
+        return false;
+    }
+
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+    iovec data{const_cast<void *>(buffer), size};
+    msghdr message{};
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    cmsghdr *header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(int));
+    std::memcpy(CMSG_DATA(header), &descriptor, sizeof(int));
+
+    // The descriptor goes with the first byte, the rest is plain data
+    ssize_t sent;
+    do
+    {
+        sent = sendmsg(fd, &message, MSG_NOSIGNAL);
+    } while (sent < 0 && errno == EINTR);
+    if (sent <= 0)
+    {
+        return false;
+    }
+
+    return writeFully(fd, static_cast<const char *>(buffer) + sent, size - static_cast<size_t>(sent));
+}
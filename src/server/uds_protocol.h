@@ -0,0 +1,75 @@
+#ifndef UDS_PROTOCOL_H
+#define UDS_PROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Wire format shared by yolov10_uds_server and UdsDetectorClient. Every
+// message is a fixed size struct in host byte order; both ends always run on
+// the same machine. Pixels never cross the socket, only slot descriptors of
+// the client's shared memory ring, whose file descriptor comes along with
+// the hello as SCM_RIGHTS ancillary data.
+
+const uint32_t UDS_PROTOCOL_MAGIC = 0x30315659; // "YV10"
+const uint32_t UDS_PROTOCOL_VERSION = 2;
+
+enum UdsStatus : int32_t
+{
+    UDS_STATUS_OK = 0,
+    UDS_STATUS_BAD_REQUEST = 1,
+    UDS_STATUS_INFERENCE_ERROR = 2,
+    UDS_STATUS_DEADLINE_EXCEEDED = 3
+};
+
+// Sent once by the client after connecting, with the ring's descriptor
+struct UdsHelloRequest
+{
+    uint32_t magic;
+    uint32_t version;
+};
+
+// Followed by class_names_size bytes of '\n' separated class names
+struct UdsHelloResponse
+{
+    int32_t status;
+    uint32_t class_names_size;
+};
+
+// The frame is a BGR image stored in the given slot of the ring
+struct UdsDetectRequest
+{
+    uint64_t request_id;
+    uint32_t slot;
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;
+    float confidence_threshold;
+    // Time the client can wait for the response, 0 for no deadline
+    uint32_t deadline_us;
+};
+
+// Followed by count UdsDetection entries
+struct UdsDetectResponse
+{
+    uint64_t request_id;
+    int32_t status;
+    uint32_t count;
+};
+
+struct UdsDetection
+{
+    int32_t class_id;
+    float confidence;
+    int32_t x;
+    int32_t y;
+    int32_t width;
+    int32_t height;
+};
+
+bool readFully(int fd, void *buffer, size_t size);
+bool writeFully(int fd, const void *buffer, size_t size);
+bool readWithDescriptor(int fd, void *buffer, size_t size, int &descriptor);
+bool writeWithDescriptor(int fd, const void *buffer, size_t size, int descriptor);
+
+
+#endif // UDS_PROTOCOL_H
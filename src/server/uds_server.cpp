@@ -0,0 +1,467 @@
+#include "ia/engine_replicas.h"
+#include "memory/frame_pool.h"
+#include "metrics/metrics.h"
+#include "metrics/trace.h"
+#include "server/shm_ring.h"
+#include "server/uds_protocol.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+namespace
+{
+    std::atomic<int> listen_fd{-1};
+    std::atomic<bool> reload_requested{false};
+
+    // Sockets of the connected clients, shut down when the server stops
+    std::mutex clients_mutex;
+    std::condition_variable clients_cv;
+    std::set<int> client_fds;
+
+    void handleSignal(int)
+    {
+        int fd = listen_fd.exchange(-1);
+        if (fd >= 0)
+        {
+            shutdown(fd, SHUT_RDWR);
+            close(fd);
+        }
+    }
+
+    // Loading a model is not async-signal-safe, the reloader thread does it
+    void handleReload(int)
+    {
+        reload_requested = true;
+    }
+
+    // State shared between a connection's reader thread and the callbacks
+    // that write its responses from the scheduler's workers
+    struct Connection
+    {
+        int fd;
+        std::mutex write_mutex;
+        std::mutex pending_mutex;
+        std::condition_variable pending_cv;
+        int pending = 0;
+
+        void send(const UdsDetectResponse &response, const std::vector<UdsDetection> &detections)
+        {
+            std::lock_guard<std::mutex> lock(write_mutex);
+            if (writeFully(fd, &response, sizeof(response)))
+            {
+                writeFully(fd, detections.data(), detections.size() * sizeof(UdsDetection));
+            }
+        }
+
+        void finishRequest()
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex);
+            --pending;
+            pending_cv.notify_all();
+        }
+    };
+
+    bool sendHello(int fd, int32_t status, const std::string &class_names)
+    {
+        UdsHelloResponse response{status, static_cast<uint32_t>(class_names.size())};
+        return writeFully(fd, &response, sizeof(response)) && writeFully(fd, class_names.data(), class_names.size());
+    }
+
+    /*
+     * Function to serve one client until it disconnects
+     *
+     * Requests are handed to the batch scheduler as soon as they arrive, so a
+     * client may pipeline several frames; responses carry the request id.
+     */
+    void serveClient(int fd, InferenceEngine &engine, BatchScheduler &scheduler)
+    {
+        UdsHelloRequest hello{};
+        int ring_fd = -1;
+        if (!readWithDescriptor(fd, &hello, sizeof(hello), ring_fd))
+        {
+            close(fd);
+            return;
+        }
+
+        std::unique_ptr<SharedFrameRing> ring;
+        try
+        {
+            if (hello.magic != UDS_PROTOCOL_MAGIC || hello.version != UDS_PROTOCOL_VERSION)
+            {
+                if (ring_fd >= 0)
+                {
+                    close(ring_fd);
+                }
+                throw std::runtime_error("Unsupported protocol version");
+            }
+            if (ring_fd < 0)
+            {
+                throw std::runtime_error("Client did not send its frame ring");
+            }
+            ring = std::make_unique<SharedFrameRing>(ring_fd);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Error: " << e.what() << std::endl;
+            sendHello(fd, UDS_STATUS_BAD_REQUEST, "");
+            close(fd);
+            return;
+        }
+
+        std::string class_names;
+        for (const auto &name : engine.classNames())
+        {
+            class_names += name + "\n";
+        }
+
+        auto connection = std::make_shared<Connection>();
+        connection->fd = fd;
+
+        UdsDetectRequest request{};
+        bool connected = sendHello(fd, UDS_STATUS_OK, class_names);
+        while (connected && readFully(fd, &request, sizeof(request)))
+        {
+            UdsDetectResponse response{request.request_id, UDS_STATUS_OK, 0};
+
+            cv::Mat frame;
+            try
+            {
+                frame = ring->frame(request.slot, static_cast<int>(request.width), static_cast<int>(request.height), request.stride);
+            }
+            catch (const std::exception &)
+            {
+                response.status = UDS_STATUS_BAD_REQUEST;
+                connection->send(response, {});
+                continue;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(connection->pending_mutex);
+                ++connection->pending;
+            }
+
+            // The deadline is relative, so it counts from when the request arrived
+            const auto deadline = request.deadline_us ? BatchScheduler::Clock::now() + std::chrono::microseconds(request.deadline_us) : BatchScheduler::Clock::time_point::max();
+
+            // The frame is preprocessed straight from shared memory inside submit
+            scheduler.submit(frame, request.confidence_threshold, deadline, [connection, response](std::vector<Detection> detections, std::exception_ptr error) mutable
+                             {
+                                 std::vector<UdsDetection> wire;
+                                 if (error)
+                                 {
+                                     try
+                                     {
+                                         std::rethrow_exception(error);
+                                     }
+                                     catch (const DeadlineExceeded &)
+                                     {
+                                         response.status = UDS_STATUS_DEADLINE_EXCEEDED;
+                                     }
+                                     catch (...)
+                                     {
+                                         response.status = UDS_STATUS_INFERENCE_ERROR;
+                                     }
+                                 }
+                                 else
+                                 {
+                                     wire.reserve(detections.size());
+                                     for (const auto &detection : detections)
+                                     {
+                                         wire.push_back({detection.class_id, detection.confidence, detection.bbox.x, detection.bbox.y, detection.bbox.width, detection.bbox.height});
+                                     }
+                                     response.count = static_cast<uint32_t>(wire.size());
+                                 }
+                                 connection->send(response, wire);
+                                 connection->finishRequest(); });
+        }
+
+        // Callbacks still write to the socket, so wait for them before closing it
+        {
+            std::unique_lock<std::mutex> lock(connection->pending_mutex);
+            connection->pending_cv.wait(lock, [&connection]
+                                        { return connection->pending == 0; });
+        }
+        close(fd);
+    }
+
+    void runClient(int fd, InferenceEngine &engine, BatchScheduler &scheduler)
+    {
+        serveClient(fd, engine, scheduler);
+
+        std::lock_guard<std::mutex> lock(clients_mutex);
+        client_fds.erase(fd);
+        clients_cv.notify_all();
+    }
+
+    void printUsage(const char *program)
+    {
+        std::cerr << "Usage: " << program << " <model_path> <socket_path> [--threads <n>] [--max-batch <n>] [--max-wait-us <n>]"
+                  << " [--max-clients <n>] [--numa] [--topology <path>] [--warmup <n>] [--metrics-file <path>] [--trace <path>]" << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::string model_path = argv[1];
+    std::string socket_path = argv[2];
+    EngineConfig engine_config;
+    engine_config.warmup_iterations = 2;
+    BatchConfig batch_config;
+    size_t max_clients = 256;
+    bool threads_set = false;
+    bool numa = false;
+    std::string topology_path;
+    std::string trace_path;
+    std::string metrics_path;
+
+    for (int i = 3; i < argc; ++i)
+    {
+        std::string option = argv[i];
+        if (option == "--threads" && i + 1 < argc)
+        {
+            engine_config.intra_op_threads = std::stoi(argv[++i]);
+            threads_set = true;
+        }
+        else if (option == "--max-batch" && i + 1 < argc)
+        {
+            batch_config.max_batch_size = std::stoul(argv[++i]);
+        }
+        else if (option == "--max-wait-us" && i + 1 < argc)
+        {
+            batch_config.max_wait = std::chrono::microseconds(std::stol(argv[++i]));
+        }
+        else if (option == "--max-clients" && i + 1 < argc)
+        {
+            max_clients = std::max<size_t>(std::stoul(argv[++i]), 1);
+        }
+        else if (option == "--metrics-file" && i + 1 < argc)
+        {
+            metrics_path = argv[++i];
+        }
+        else if (option == "--numa")
+        {
+            numa = true;
+        }
+        else if (option == "--topology" && i + 1 < argc)
+        {
+            topology_path = argv[++i];
+            numa = true;
+        }
+        else if (option == "--warmup" && i + 1 < argc)
+        {
+            engine_config.warmup_iterations = std::stoi(argv[++i]);
+        }
+        else if (option == "--trace" && i + 1 < argc)
+        {
+            trace_path = argv[++i];
+        }
+        else
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    // Warm up the single image shape and the largest batch the scheduler forms
+    engine_config.warmup_batch_sizes = {1, batch_config.max_batch_size};
+
+    if (!trace_path.empty())
+    {
+        Tracer::global().enable();
+        engine_config.profile_prefix = trace_path + ".ort";
+    }
+
+    // Every cv::Mat of the pipeline recycles its buffer through the frame pool
+    PooledMatAllocator::install();
+
+    try
+    {
+        // One replica per NUMA node, or a single unpinned one
+        CpuTopology topology;
+        if (numa)
+        {
+            topology = topology_path.empty() ? CpuTopology::detect() : CpuTopology::load(topology_path);
+            if (!threads_set)
+            {
+                engine_config.intra_op_threads = 0;
+            }
+            for (const auto &node : topology.nodes())
+            {
+                std::cout << "NUMA node " << node.id << ": CPUs " << formatCpuList(node.cpus) << std::endl;
+            }
+        }
+        EngineReplicas replicas(model_path, engine_config, batch_config, topology);
+        if (engine_config.warmup_iterations > 0)
+        {
+            std::cout << "Warm-up took " << replicas.warmupDuration().count() << " ms" << std::endl;
+        }
+
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (socket_path.size() >= sizeof(address.sun_path))
+        {
+            throw std::runtime_error("Socket path is too long: " + socket_path);
+        }
+        std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+        unlink(socket_path.c_str());
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 || bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || listen(fd, 128) != 0)
+        {
+            throw std::runtime_error("Could not listen on " + socket_path + ": " + std::strerror(errno));
+        }
+        listen_fd = fd;
+
+        std::signal(SIGPIPE, SIG_IGN);
+        std::signal(SIGINT, handleSignal);
+        std::signal(SIGTERM, handleSignal);
+        std::signal(SIGHUP, handleReload);
+        std::cout << "Listening on " << socket_path << std::endl;
+
+        // Refresh the metrics dump for a node exporter textfile collector
+        std::mutex metrics_mutex;
+        std::condition_variable metrics_cv;
+        bool metrics_stopping = false;
+        std::thread metrics_writer;
+        if (!metrics_path.empty())
+        {
+            metrics_writer = std::thread([&]
+                                         {
+                                             std::unique_lock<std::mutex> lock(metrics_mutex);
+                                             do
+                                             {
+                                                 try
+                                                 {
+                                                     MetricsRegistry::global().writeToFile(metrics_path);
+                                                 }
+                                                 catch (const std::exception &e)
+                                                 {
+                                                     std::cerr << "Error: " << e.what() << std::endl;
+                                                 }
+                                             } while (!metrics_cv.wait_for(lock, std::chrono::seconds(10), [&]
+                                                                           { return metrics_stopping; })); });
+        }
+
+        // SIGHUP swaps in the model file found at the startup path, clients stay connected
+        std::atomic<bool> reloader_stopping{false};
+        std::thread reloader([&]
+                             {
+                                 while (!reloader_stopping)
+                                 {
+                                     std::this_thread::sleep_for(std::chrono::milliseconds(500));
+                                     if (!reload_requested.exchange(false))
+                                     {
+                                         continue;
+                                     }
+                                     try
+                                     {
+                                         replicas.reload(model_path);
+                                         std::cout << "Reloaded " << model_path << ", generation " << replicas.engine(0).generation() << std::endl;
+                                     }
+                                     catch (const std::exception &e)
+                                     {
+                                         std::cerr << "Error: " << e.what() << std::endl;
+                                     }
+                                 } });
+
+        while (listen_fd >= 0)
+        {
+            // At the limit further clients wait in the listen backlog
+            {
+                std::unique_lock<std::mutex> lock(clients_mutex);
+                if (!clients_cv.wait_for(lock, std::chrono::milliseconds(200), [max_clients]
+                                         { return client_fds.size() < max_clients; }))
+                {
+                    continue;
+                }
+            }
+
+            int client = accept(fd, nullptr, nullptr);
+            if (client < 0)
+            {
+                if (listen_fd < 0)
+                {
+                    break;
+                }
+                if (errno == EINTR || errno == ECONNABORTED)
+                {
+                    continue;
+                }
+                if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM)
+                {
+                    // Out of descriptors or memory, give the clients time to disconnect
+                    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                    continue;
+                }
+                std::cerr << "Error: accept failed: " << std::strerror(errno) << std::endl;
+                break;
+            }
+
+            std::lock_guard<std::mutex> lock(clients_mutex);
+            client_fds.insert(client);
+            // Each client stays on one replica, so its frames are processed on one node
+            size_t replica = replicas.nextIndex();
+            std::thread(runClient, client, std::ref(replicas.engine(replica)), std::ref(replicas.scheduler(replica))).detach();
+        }
+
+        // Disconnect the clients and let their threads drain before the engine goes away
+        unlink(socket_path.c_str());
+        {
+            std::unique_lock<std::mutex> lock(clients_mutex);
+            for (int client : client_fds)
+            {
+                shutdown(client, SHUT_RDWR);
+            }
+            clients_cv.wait(lock, []
+                            { return client_fds.empty(); });
+        }
+        reloader_stopping = true;
+        reloader.join();
+        replicas.stop();
+
+        if (!trace_path.empty())
+        {
+            std::vector<OrtProfile> ort_profiles;
+            for (size_t i = 0; i < replicas.size(); ++i)
+            {
+                ort_profiles.push_back({replicas.engine(i).endProfiling(), replicas.engine(i).profilingStartNs()});
+            }
+            Tracer::global().writeChromeTrace(trace_path, ort_profiles);
+        }
+
+        if (metrics_writer.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(metrics_mutex);
+                metrics_stopping = true;
+            }
+            metrics_cv.notify_one();
+            metrics_writer.join();
+            MetricsRegistry::global().writeToFile(metrics_path);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,378 @@
+#include "ia/engine_replicas.h"
+#include "ia/model_registry.h"
+#include "io/detection_sink.h"
+#include "memory/frame_pool.h"
+#include "metrics/metrics.h"
+#include "metrics/trace.h"
+#include "server/http_server.h"
+#include <cmath>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+    HttpServer *running_server = nullptr;
+
+    void handleSignal(int)
+    {
+        if (running_server)
+        {
+            running_server->stop();
+        }
+    }
+
+    // Whole string as a finite number, unlike std::stof which throws or stops at junk
+    bool parseNumber(const std::string &text, double &value)
+    {
+        char *end = nullptr;
+        value = std::strtod(text.c_str(), &end);
+        return !text.empty() && end == text.c_str() + text.size() && std::isfinite(value);
+    }
+
+    void printUsage(const char *program)
+    {
+        std::cerr << "Usage: " << program << " <model_path> [--host <address>] [--port <n>] [--threads <n>]"
+                  << " [--max-batch <n>] [--max-wait-us <n>] [--workers <n>] [--max-connections <n>] [--numa] [--topology <path>]"
+                  << " [--warmup <n>] [--models <path>] [--trace <path>]" << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::string model_path = argv[1];
+    std::string host = "127.0.0.1";
+    int port = 8080;
+    EngineConfig engine_config;
+    engine_config.warmup_iterations = 2;
+    BatchConfig batch_config;
+    size_t max_connections = 256;
+    bool threads_set = false;
+    bool numa = false;
+    std::string topology_path;
+    std::string models_path;
+    std::string trace_path;
+
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string option = argv[i];
+        if (option == "--host" && i + 1 < argc)
+        {
+            host = argv[++i];
+        }
+        else if (option == "--port" && i + 1 < argc)
+        {
+            port = std::stoi(argv[++i]);
+        }
+        else if (option == "--threads" && i + 1 < argc)
+        {
+            engine_config.intra_op_threads = std::stoi(argv[++i]);
+            threads_set = true;
+        }
+        else if (option == "--max-batch" && i + 1 < argc)
+        {
+            batch_config.max_batch_size = std::stoul(argv[++i]);
+        }
+        else if (option == "--max-wait-us" && i + 1 < argc)
+        {
+            batch_config.max_wait = std::chrono::microseconds(std::stol(argv[++i]));
+        }
+        else if (option == "--workers" && i + 1 < argc)
+        {
+            batch_config.workers = std::stoi(argv[++i]);
+        }
+        else if (option == "--max-connections" && i + 1 < argc)
+        {
+            max_connections = std::stoul(argv[++i]);
+        }
+        else if (option == "--numa")
+        {
+            numa = true;
+        }
+        else if (option == "--topology" && i + 1 < argc)
+        {
+            topology_path = argv[++i];
+            numa = true;
+        }
+        else if (option == "--warmup" && i + 1 < argc)
+        {
+            engine_config.warmup_iterations = std::stoi(argv[++i]);
+        }
+        else if (option == "--models" && i + 1 < argc)
+        {
+            models_path = argv[++i];
+        }
+        else if (option == "--trace" && i + 1 < argc)
+        {
+            trace_path = argv[++i];
+        }
+        else
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    // Registry models share one environment and thread pool, which NUMA replicas do not
+    if (numa && !models_path.empty())
+    {
+        std::cerr << "--numa cannot be combined with --models" << std::endl;
+        return 1;
+    }
+
+    // Warm up the single image shape and the largest batch the scheduler forms
+    engine_config.warmup_batch_sizes = {1, batch_config.max_batch_size};
+
+    if (!trace_path.empty())
+    {
+        Tracer::global().enable();
+        engine_config.profile_prefix = trace_path + ".ort";
+    }
+
+    // Every cv::Mat of the pipeline recycles its buffer through the frame pool
+    PooledMatAllocator::install();
+
+    try
+    {
+        // Either several models chosen per request, the command line one being
+        // "default", or one model with one replica per NUMA node
+        std::unique_ptr<ModelRegistry> registry;
+        std::unique_ptr<EngineReplicas> replicas;
+        if (!models_path.empty())
+        {
+            RegistryConfig registry_config = RegistryConfig::load(models_path);
+            if (threads_set)
+            {
+                registry_config.intra_op_threads = engine_config.intra_op_threads;
+            }
+            registry = std::make_unique<ModelRegistry>(registry_config);
+            if (!registry->contains("default"))
+            {
+                ModelSpec spec;
+                spec.name = "default";
+                spec.path = model_path;
+                spec.engine = engine_config;
+                spec.batch = batch_config;
+                spec.pinned = true;
+                registry->add(spec);
+            }
+
+            auto default_model = registry->acquire("default");
+            std::cout << "Models: ";
+            for (const auto &name : registry->names())
+            {
+                std::cout << name << " ";
+            }
+            std::cout << std::endl;
+            if (engine_config.warmup_iterations > 0)
+            {
+                std::cout << "Warm-up took " << default_model->engine->warmupDuration().count() << " ms" << std::endl;
+            }
+        }
+        else
+        {
+            // One replica per NUMA node, or a single unpinned one
+            CpuTopology topology;
+            if (numa)
+            {
+                topology = topology_path.empty() ? CpuTopology::detect() : CpuTopology::load(topology_path);
+                if (!threads_set)
+                {
+                    engine_config.intra_op_threads = 0;
+                }
+                for (const auto &node : topology.nodes())
+                {
+                    std::cout << "NUMA node " << node.id << ": CPUs " << formatCpuList(node.cpus) << std::endl;
+                }
+            }
+            replicas = std::make_unique<EngineReplicas>(model_path, engine_config, batch_config, topology);
+            if (engine_config.warmup_iterations > 0)
+            {
+                std::cout << "Warm-up took " << replicas->warmupDuration().count() << " ms" << std::endl;
+            }
+        }
+        HttpServer server(host, port, 64 << 20, max_connections);
+
+        // POST /detect?conf=0.5[&model=name][&deadline_ms=n] with an encoded image as the body.
+        // A request that cannot be answered within deadline_ms is shed with a 503.
+        server.route("POST", "/detect", [&replicas, &registry](const HttpRequest &request, HttpResponse &response)
+                     {
+                         // The handle keeps a registry model loaded until the results are in
+                         std::string model_name = request.queryParameter("model", "default");
+                         std::shared_ptr<ModelRegistry::LoadedModel> model;
+                         if (registry ? !registry->contains(model_name) : model_name != "default")
+                         {
+                             response.status = 404;
+                             response.content_type = "text/plain";
+                             response.body = "Unknown model: " + model_name;
+                             return;
+                         }
+
+                         double confidence_threshold = 0.0;
+                         if (!parseNumber(request.queryParameter("conf", "0.5"), confidence_threshold) ||
+                             confidence_threshold < 0.0 || confidence_threshold > 1.0)
+                         {
+                             response.status = 400;
+                             response.content_type = "text/plain";
+                             response.body = "conf must be a number between 0 and 1";
+                             return;
+                         }
+                         // Whole milliseconds up to a day, 0 for no deadline
+                         double deadline_ms = 0.0;
+                         if (!parseNumber(request.queryParameter("deadline_ms", "0"), deadline_ms) ||
+                             deadline_ms < 0.0 || deadline_ms > 86400000.0 || deadline_ms != std::floor(deadline_ms))
+                         {
+                             response.status = 400;
+                             response.content_type = "text/plain";
+                             response.body = "deadline_ms must be a whole number of milliseconds between 0 and 86400000";
+                             return;
+                         }
+
+                         // Decode straight from the receive buffer, no temporary file or copy
+                         static Histogram &decode_seconds = stageHistogram("decode");
+                         cv::Mat image;
+                         if (request.body_size)
+                         {
+                             ScopedTimer timer(decode_seconds, "decode");
+                             cv::Mat encoded(1, static_cast<int>(request.body_size), CV_8U, const_cast<char *>(request.body));
+                             image = cv::imdecode(encoded, cv::IMREAD_COLOR);
+                         }
+                         if (image.empty())
+                         {
+                             response.status = 400;
+                             response.content_type = "text/plain";
+                             response.body = "Could not decode the image";
+                             return;
+                         }
+
+                         if (registry)
+                         {
+                             model = registry->acquire(model_name);
+                         }
+                         const auto deadline = deadline_ms > 0 ? BatchScheduler::Clock::now() + std::chrono::milliseconds(static_cast<int64_t>(deadline_ms)) : BatchScheduler::Clock::time_point::max();
+
+                         BatchScheduler &scheduler = model ? *model->scheduler : replicas->next();
+                         DetectionRecord record{"", 0, 0.0, image.cols, image.rows, {}};
+                         try
+                         {
+                             record.detections = scheduler.submit(image, static_cast<float>(confidence_threshold), deadline).get();
+                         }
+                         catch (const DeadlineExceeded &e)
+                         {
+                             response.status = 503;
+                             response.content_type = "text/plain";
+                             response.body = e.what();
+                             return;
+                         }
+                         formatJson(record, response.body); });
+
+        // Prometheus scrape endpoint
+        server.route("GET", "/metrics", [](const HttpRequest &, HttpResponse &response)
+                     {
+                         response.content_type = "text/plain; version=0.0.4";
+                         response.body = MetricsRegistry::global().renderPrometheus(); });
+
+        // POST /reload rereads the configured model file, overwritten in place
+        // beforehand. Requests keep being served by the old model until the new
+        // one is warm. With --models, the name parameter picks the registry model
+        // to reload. Clients never choose the path: the endpoint is unauthenticated.
+        server.route("POST", "/reload", [&replicas, &registry, &model_path](const HttpRequest &request, HttpResponse &response)
+                     {
+                         if (!request.queryParameter("model", "").empty())
+                         {
+                             response.status = 400;
+                             response.content_type = "text/plain";
+                             response.body = "Only the configured model path can be reloaded";
+                             return;
+                         }
+
+                         uint64_t generation = 0;
+                         try
+                         {
+                             if (registry)
+                             {
+                                 auto model = registry->acquire(request.queryParameter("name", "default"));
+                                 model->engine->reload(model->engine->modelPath());
+                                 generation = model->engine->generation();
+                             }
+                             else
+                             {
+                                 replicas->reload(model_path);
+                                 generation = replicas->engine(0).generation();
+                             }
+                         }
+                         catch (const std::exception &e)
+                         {
+                             response.status = 400;
+                             response.content_type = "text/plain";
+                             response.body = e.what();
+                             return;
+                         }
+                         response.body = "{\"status\":\"ok\",\"generation\":" + std::to_string(generation) + "}"; });
+
+        server.route("GET", "/healthz", [&replicas, &registry](const HttpRequest &, HttpResponse &response)
+                     {
+                         if (registry)
+                         {
+                             std::string loaded;
+                             for (const auto &name : registry->loadedNames())
+                             {
+                                 loaded += (loaded.empty() ? "\"" : ",\"") + name + "\"";
+                             }
+                             response.body = "{\"status\":\"ok\",\"loaded\":[" + loaded + "],\"loaded_bytes\":" + std::to_string(registry->loadedBytes()) + "}";
+                             return;
+                         }
+                         if (!replicas->ready())
+                         {
+                             response.status = 503;
+                             response.body = "{\"status\":\"warming up\"}";
+                             return;
+                         }
+                         response.body = "{\"status\":\"ok\",\"warmup_ms\":" + std::to_string(replicas->warmupDuration().count()) + ",\"replicas\":" + std::to_string(replicas->size()) + "}"; });
+
+        running_server = &server;
+        std::signal(SIGPIPE, SIG_IGN);
+        std::signal(SIGINT, handleSignal);
+        std::signal(SIGTERM, handleSignal);
+        std::cout << "Listening on http://" << host << ":" << port << std::endl;
+
+        server.run();
+        running_server = nullptr;
+
+        if (registry)
+        {
+            registry->stop();
+            if (!trace_path.empty())
+            {
+                auto model = registry->acquire("default");
+                Tracer::global().writeChromeTrace(trace_path, {{model->engine->endProfiling(), model->engine->profilingStartNs()}});
+            }
+        }
+        else
+        {
+            replicas->stop();
+            if (!trace_path.empty())
+            {
+                std::vector<OrtProfile> ort_profiles;
+                for (size_t i = 0; i < replicas->size(); ++i)
+                {
+                    ort_profiles.push_back({replicas->engine(i).endProfiling(), replicas->engine(i).profilingStartNs()});
+                }
+                Tracer::global().writeChromeTrace(trace_path, ort_profiles);
+            }
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
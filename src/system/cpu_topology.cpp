@@ -0,0 +1,281 @@
+#include "cpu_topology.h"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    bool readFirstLine(const std::string &path, std::string &line)
+    {
+        std::ifstream file(path);
+        return static_cast<bool>(std::getline(file, line));
+    }
+}
+
+/*
+ * Function to read the NUMA layout of the machine
+ *
+ * Nodes come from /sys/devices/system/node. Machines without NUMA support
+ * get a single node with every online CPU.
+ *
+ * @return: detected topology, never empty
+ */
+CpuTopology CpuTopology::detect()
+{
+    CpuTopology topology;
+
+    // Node ids may have holes after hot unplug, so probe past a missing one
+    int missing = 0;
+    for (int id = 0; missing < 8; ++id)
+    {
+        std::string cpulist;
+        if (!readFirstLine("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist", cpulist))
+        {
+            ++missing;
+            continue;
+        }
+        missing = 0;
+
+        std::vector<int> cpus = parseCpuList(cpulist);
+        if (!cpus.empty())
+        {
+            topology.addNode(id, cpus);
+        }
+    }
+
+    if (topology.empty())
+    {
+        std::string online;
+        std::vector<int> cpus;
+        if (readFirstLine("/sys/devices/system/cpu/online", online))
+        {
+            cpus = parseCpuList(online);
+        }
+        if (cpus.empty())
+        {
+            for (unsigned int cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); ++cpu)
+            {
+                cpus.push_back(static_cast<int>(cpu));
+            }
+        }
+        topology.addNode(0, cpus);
+    }
+
+    return topology;
+}
+
+/*
+ * Function to load the placement from a topology file
+ *
+ * @param path: YAML file with a 'nodes' list of { id, cpus }
+ *
+ * @return: topology described by the file
+ */
+CpuTopology CpuTopology::load(const std::string &path)
+{
+    cv::FileStorage storage(path, cv::FileStorage::READ);
+    if (!storage.isOpened())
+    {
+        throw std::runtime_error("Could not open topology file: " + path);
+    }
+
+    cv::FileNode nodes_node = storage["nodes"];
+    if (!nodes_node.isSeq())
+    {
+        throw std::runtime_error("Topology file has no 'nodes' list: " + path);
+    }
+
+    CpuTopology topology;
+    for (const auto &node : nodes_node)
+    {
+        int id = -1;
+        std::string cpulist;
+        node["id"] >> id;
+        node["cpus"] >> cpulist;
+
+        std::vector<int> cpus = parseCpuList(cpulist);
+        if (id < 0 || cpus.empty())
+        {
+            throw std::runtime_error("Topology node needs an id and a cpus list: " + path);
+        }
+        topology.addNode(id, cpus);
+    }
+
+    return topology;
+}
+
+void CpuTopology::addNode(int id, const std::vector<int> &cpus)
+{
+    numa_nodes.push_back({id, cpus});
+}
+
+const std::vector<NumaNode> &CpuTopology::nodes() const
+{
+    return numa_nodes;
+}
+
+/*
+ * Function to get a node by id
+ *
+ * @param id: NUMA node id
+ *
+ * @return: the node, throws if the topology has no such node
+ */
+const NumaNode &CpuTopology::node(int id) const
+{
+    for (const auto &numa_node : numa_nodes)
+    {
+        if (numa_node.id == id)
+        {
+            return numa_node;
+        }
+    }
+    throw std::runtime_error("No NUMA node " + std::to_string(id));
+}
+
+bool CpuTopology::empty() const
+{
+    return numa_nodes.empty();
+}
+
+/*
+ * Function to parse a kernel style CPU list such as "0-3,8,10-11"
+ *
+ * @param list: comma separated CPU ids and ranges
+ *
+ * @return: sorted CPU ids without duplicates
+ */
+std::vector<int> parseCpuList(const std::string &list)
+{
+    std::vector<int> cpus;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        item.erase(std::remove_if(item.begin(), item.end(), ::isspace), item.end());
+        if (item.empty())
+        {
+            continue;
+        }
+
+        size_t dash = item.find('-');
+        int first = std::stoi(item.substr(0, dash));
+        int last = dash == std::string::npos ? first : std::stoi(item.substr(dash + 1));
+        if (first < 0 || last < first)
+        {
+            throw std::runtime_error("Invalid CPU list: " + list);
+        }
+        for (int cpu = first; cpu <= last; ++cpu)
+        {
+            cpus.push_back(cpu);
+        }
+    }
+
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+/*
+ * Function to format CPU ids as a kernel style CPU list
+ *
+ * @param cpus: sorted CPU ids
+ *
+ * @return: list such as "0-3,8"
+ */
+std::string formatCpuList(const std::vector<int> &cpus)
+{
+    std::string list;
+    for (size_t i = 0; i < cpus.size();)
+    {
+        size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1)
+        {
+            ++j;
+        }
+
+        if (!list.empty())
+        {
+            list += ",";
+        }
+        list += std::to_string(cpus[i]);
+        if (j > i)
+        {
+            list += "-" + std::to_string(cpus[j]);
+        }
+        i = j + 1;
+    }
+    return list;
+}
+
+/*
+ * Function to restrict the calling thread to a set of CPUs
+ *
+ * Threads started afterwards by this thread inherit the set.
+ *
+ * @param cpus: CPU ids, the call does nothing when empty
+ *
+ * @return: false if the platform does not support it or the call failed
+ */
+bool pinCurrentThread(const std::vector<int> &cpus)
+{
+    if (cpus.empty())
+    {
+        return false;
+    }
+
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus)
+    {
+        if (cpu >= 0 && cpu < CPU_SETSIZE)
+        {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+/*
+ * Function to make the calling thread allocate from one NUMA node
+ *
+ * The policy is "preferred", so allocations fall back to other nodes when the
+ * node is full instead of failing. Threads started afterwards inherit it.
+ *
+ * @param node: NUMA node id
+ *
+ * @return: false if the platform does not support it or the call failed
+ */
+bool preferNodeMemory(int node)
+{
+#if defined(__linux__) && defined(SYS_set_mempolicy)
+    const int MPOL_PREFERRED = 1;
+    unsigned long mask[16] = {};
+    const size_t bits_per_word = sizeof(unsigned long) * 8;
+    if (node < 0 || static_cast<size_t>(node) >= sizeof(mask) * 8)
+    {
+        return false;
+    }
+    mask[node / bits_per_word] |= 1UL << (node % bits_per_word);
+
+    // The kernel reads maxnode - 1 bits
+    return syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask, sizeof(mask) * 8 + 1) == 0;
+#else
+    (void)node;
+    return false;
+#endif
+}
@@ -0,0 +1,44 @@
+#ifndef CPU_TOPOLOGY_H
+#define CPU_TOPOLOGY_H
+
+#include <string>
+#include <vector>
+
+struct NumaNode
+{
+    int id;
+    std::vector<int> cpus;
+};
+
+
+// CPUs grouped by NUMA node, either read from /sys or from a YAML file
+// describing the placement explicitly:
+//
+//   %YAML:1.0
+//   nodes:
+//     - { id: 0, cpus: "0-15,32-47" }
+//     - { id: 1, cpus: "16-31,48-63" }
+class CpuTopology
+{
+public:
+    static CpuTopology detect();
+    static CpuTopology load(const std::string &path);
+
+    void addNode(int id, const std::vector<int> &cpus);
+    const std::vector<NumaNode> &nodes() const;
+    const NumaNode &node(int id) const;
+    bool empty() const;
+
+private:
+    std::vector<NumaNode> numa_nodes;
+};
+
+
+std::vector<int> parseCpuList(const std::string &list);
+std::string formatCpuList(const std::vector<int> &cpus);
+
+bool pinCurrentThread(const std::vector<int> &cpus);
+bool preferNodeMemory(int node);
+
+
+#endif // CPU_TOPOLOGY_H
@@ -0,0 +1,120 @@
+#include "ia/inference.h"
+#include "io/detection_sink.h"
+#include "io/video_indexer.h"
+#include "metrics/metrics.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+void printUsage(const char *program)
+{
+    std::cerr << "Usage: " << program << " <model_path> <video_path>... [--output <path>] [--output-format <jsonl|csv|binary>]"
+              << " [--keyframes | --interval <seconds>] [--batch <n>] [--conf <threshold>]"
+              << " [--threads <n>] [--decode-threads <n>] [--metrics-file <path>]" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::string model_path = argv[1];
+    std::vector<std::string> video_paths;
+    std::string output_path = "-";
+    std::string output_format;
+    std::string metrics_path;
+    VideoIndexConfig index_config;
+    EngineConfig engine_config;
+
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string option = argv[i];
+        if (option == "--output" && i + 1 < argc)
+        {
+            output_path = argv[++i];
+        }
+        else if (option == "--output-format" && i + 1 < argc)
+        {
+            output_format = argv[++i];
+        }
+        else if (option == "--keyframes")
+        {
+#ifndef YOLOV10_WITH_FFMPEG
+            std::cerr << "Error: --keyframes needs libavcodec, build with -DYOLOV10_WITH_FFMPEG=ON" << std::endl;
+            return 1;
+#endif
+            index_config.mode = SamplingMode::Keyframes;
+        }
+        else if (option == "--interval" && i + 1 < argc)
+        {
+            index_config.mode = SamplingMode::Interval;
+            index_config.interval_seconds = std::stod(argv[++i]);
+        }
+        else if (option == "--batch" && i + 1 < argc)
+        {
+            index_config.batch_size = std::stoul(argv[++i]);
+        }
+        else if (option == "--conf" && i + 1 < argc)
+        {
+            index_config.confidence_threshold = std::stof(argv[++i]);
+        }
+        else if (option == "--threads" && i + 1 < argc)
+        {
+            engine_config.intra_op_threads = std::stoi(argv[++i]);
+        }
+        else if (option == "--decode-threads" && i + 1 < argc)
+        {
+            index_config.decode_threads = std::stoi(argv[++i]);
+        }
+        else if (option == "--metrics-file" && i + 1 < argc)
+        {
+            metrics_path = argv[++i];
+        }
+        else if (option.rfind("--", 0) != 0)
+        {
+            video_paths.push_back(option);
+        }
+        else
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (video_paths.empty())
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    try
+    {
+        InferenceEngine engine(model_path, engine_config);
+
+        // The index is formatted and written by a background thread
+        AsyncSinkWriter sink(createDetectionSink(output_path, output_format));
+
+        for (const std::string &video_path : video_paths)
+        {
+            VideoIndexStats stats = indexVideo(engine, video_path, video_path, sink, index_config);
+            std::cerr << video_path << ": " << stats.sampled_frames << " frames sampled from " << stats.video_ms / 1000.0
+                      << " s of video in " << stats.elapsed_ms / 1000.0 << " s" << std::endl;
+        }
+        sink.close();
+
+        if (!metrics_path.empty())
+        {
+            MetricsRegistry::global().writeToFile(metrics_path);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
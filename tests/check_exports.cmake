@@ -0,0 +1,28 @@
+# Fails unless every symbol the shared library defines for the dynamic
+# linker is part of the C API. Run with -DNM=<nm> -DLIBRARY=<path>.
+execute_process(COMMAND ${NM} -D --defined-only ${LIBRARY}
+    OUTPUT_VARIABLE symbols
+    RESULT_VARIABLE result
+)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Could not list the symbols of ${LIBRARY}")
+endif()
+
+string(REPLACE "\n" ";" lines "${symbols}")
+set(leaked "")
+foreach(line IN LISTS lines)
+    if(line MATCHES "([A-Za-z]) ([^ ]+)$")
+        set(type ${CMAKE_MATCH_1})
+        set(name ${CMAKE_MATCH_2})
+        # The version node shows up as an absolute symbol
+        if(NOT name MATCHES "^yolov10_" AND NOT type STREQUAL "A")
+            list(APPEND leaked ${name})
+        endif()
+    endif()
+endforeach()
+
+if(leaked)
+    list(LENGTH leaked count)
+    list(GET leaked 0 first)
+    message(FATAL_ERROR "${count} symbols exported besides the C API, first ${first}")
+endif()
@@ -0,0 +1,183 @@
+// Checks of the C interface of libyolov10 on the synthetic model, through
+// the exported functions only.
+#include "yolov10_c.h"
+#include "test_common.h"
+#include "test_model.h"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+extern "C" uint32_t testCApiHeaderVersion(void);
+
+namespace
+{
+    std::string fixedModel()
+    {
+        static const std::string path = writeTestModel("yolov10_c_api_test.onnx", false);
+        return path;
+    }
+
+    // Uniform 640x360 frame with padded rows, as decoders often hand out
+    yolov10_image packedImage(yolov10_pixel_format format, std::vector<uint8_t> &pixels, uint8_t value)
+    {
+        const int32_t stride = 640 * 3 + 64;
+        pixels.assign(static_cast<size_t>(stride) * 360, value);
+
+        yolov10_image image{};
+        image.format = format;
+        image.width = 640;
+        image.height = 360;
+        image.planes[0] = pixels.data();
+        image.strides[0] = stride;
+        return image;
+    }
+
+    // NV12 frame whose Y plane is at the bottom of the video range, black in BGR
+    yolov10_image nv12Image(std::vector<uint8_t> &y_plane, std::vector<uint8_t> &uv_plane)
+    {
+        y_plane.assign(640 * 360, 16);
+        uv_plane.assign(640 * 180, 128);
+
+        yolov10_image image{};
+        image.format = YOLOV10_PIXEL_NV12;
+        image.width = 640;
+        image.height = 360;
+        image.planes[0] = y_plane.data();
+        image.planes[1] = uv_plane.data();
+        image.strides[0] = 640;
+        image.strides[1] = 640;
+        return image;
+    }
+
+    // Black in every format the engine converts itself
+    yolov10_image yuvImage(yolov10_pixel_format format, std::vector<uint8_t> &pixels)
+    {
+        yolov10_image image{};
+        image.format = format;
+        image.width = 640;
+        image.height = 360;
+        if (format == YOLOV10_PIXEL_YUYV)
+        {
+            pixels.resize(640 * 360 * 2);
+            for (size_t i = 0; i < pixels.size(); i += 2)
+            {
+                pixels[i] = 16;
+                pixels[i + 1] = 128;
+            }
+            image.planes[0] = pixels.data();
+            image.strides[0] = 640 * 2;
+            return image;
+        }
+
+        pixels.assign(640 * 360, 16);
+        pixels.resize(640 * 360 * 3 / 2, 128);
+        image.planes[0] = pixels.data();
+        image.planes[1] = pixels.data() + 640 * 360;
+        image.planes[2] = pixels.data() + 640 * 360 + 320 * 180;
+        image.strides[0] = 640;
+        image.strides[1] = 320;
+        image.strides[2] = 320;
+        return image;
+    }
+
+    void checkBlackFrame(const yolov10_detection *detections, size_t count)
+    {
+        CHECK(count == 3);
+        if (count == 3)
+        {
+            // 640x360 frames map x one to one and y by 360 / 640
+            const TestBox &box = testModelBoxes()[0];
+            CHECK(detections[0].class_id == box.class_id);
+            CHECK_NEAR(detections[0].confidence, box.confidence, 1e-4);
+            CHECK(std::abs(detections[0].x - static_cast<int>(box.left)) <= 1);
+            CHECK(std::abs(detections[0].y - static_cast<int>(box.top * 360 / 640)) <= 1);
+        }
+    }
+}
+
+static void testErrors()
+{
+    CHECK(yolov10_abi_version() == YOLOV10_ABI_VERSION);
+    CHECK(testCApiHeaderVersion() == YOLOV10_ABI_VERSION);
+
+    yolov10_engine *engine = reinterpret_cast<yolov10_engine *>(1);
+    CHECK(yolov10_engine_create(nullptr, nullptr, &engine) == YOLOV10_ERROR_INVALID_ARGUMENT);
+    CHECK(engine == nullptr);
+    CHECK(std::strlen(yolov10_last_error()) > 0);
+
+    CHECK(yolov10_engine_create("does_not_exist.onnx", nullptr, &engine) == YOLOV10_ERROR_MODEL);
+    CHECK(engine == nullptr);
+
+    yolov10_engine_options options{};
+    CHECK(yolov10_engine_create(fixedModel().c_str(), &options, &engine) == YOLOV10_ERROR_INVALID_ARGUMENT);
+    options.struct_size = offsetof(yolov10_engine_options, labels_path);
+    CHECK(yolov10_engine_create(fixedModel().c_str(), &options, &engine) == YOLOV10_ERROR_INVALID_ARGUMENT);
+    yolov10_engine_destroy(nullptr);
+}
+
+static void testDetect()
+{
+    yolov10_engine_options options;
+    yolov10_engine_options_init(&options);
+    options.warmup_iterations = 1;
+
+    yolov10_engine *engine = nullptr;
+    CHECK(yolov10_engine_create(fixedModel().c_str(), &options, &engine) == YOLOV10_OK);
+    if (!engine)
+    {
+        return;
+    }
+
+    std::vector<uint8_t> pixels;
+    yolov10_detection detections[16];
+    size_t count = 0;
+
+    yolov10_image bgr = packedImage(YOLOV10_PIXEL_BGR, pixels, 0);
+    CHECK(yolov10_detect(engine, &bgr, 0.5f, detections, 16, &count) == YOLOV10_OK);
+    checkBlackFrame(detections, count);
+
+    yolov10_image rgb = packedImage(YOLOV10_PIXEL_RGB, pixels, 0);
+    CHECK(yolov10_detect(engine, &rgb, 0.5f, detections, 16, &count) == YOLOV10_OK);
+    checkBlackFrame(detections, count);
+
+    std::vector<uint8_t> y_plane;
+    std::vector<uint8_t> uv_plane;
+    yolov10_image nv12 = nv12Image(y_plane, uv_plane);
+    CHECK(yolov10_detect(engine, &nv12, 0.5f, detections, 16, &count) == YOLOV10_OK);
+    checkBlackFrame(detections, count);
+
+    std::vector<uint8_t> yuv_pixels;
+    for (yolov10_pixel_format format : {YOLOV10_PIXEL_I420, YOLOV10_PIXEL_YUYV})
+    {
+        yolov10_image yuv = yuvImage(format, yuv_pixels);
+        CHECK(yolov10_detect(engine, &yuv, 0.5f, detections, 16, &count) == YOLOV10_OK);
+        checkBlackFrame(detections, count);
+    }
+
+    // The buffer gets what fits and the caller learns how much is missing
+    CHECK(yolov10_detect(engine, &bgr, 0.5f, detections, 1, &count) == YOLOV10_ERROR_BUFFER_TOO_SMALL);
+    CHECK(count == 3);
+    CHECK(detections[0].class_id == testModelBoxes()[0].class_id);
+
+    bgr.strides[0] = 100;
+    CHECK(yolov10_detect(engine, &bgr, 0.5f, detections, 16, &count) == YOLOV10_ERROR_INVALID_ARGUMENT);
+    nv12.width = 639;
+    CHECK(yolov10_detect(engine, &nv12, 0.5f, detections, 16, &count) == YOLOV10_ERROR_INVALID_ARGUMENT);
+
+    CHECK(std::string(yolov10_class_name(engine, 0)) == "person");
+    CHECK(yolov10_class_name(engine, -1) == nullptr);
+    CHECK(yolov10_class_name(engine, 80) == nullptr);
+
+    yolov10_engine_destroy(engine);
+}
+
+int main()
+{
+    RUN_TEST(testErrors);
+    RUN_TEST(testDetect);
+
+    return testResult();
+}
@@ -0,0 +1,9 @@
+/* Compiled as C so the public header cannot pick up C++ by accident */
+#include "yolov10_c.h"
+
+uint32_t testCApiHeaderVersion(void)
+{
+    yolov10_engine_options options;
+    yolov10_engine_options_init(&options);
+    return options.struct_size ? yolov10_abi_version() : 0;
+}
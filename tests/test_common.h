@@ -0,0 +1,82 @@
+#ifndef TEST_COMMON_H
+#define TEST_COMMON_H
+
+#include <cmath>
+#include <exception>
+#include <iostream>
+
+// Assert style checks for the CTest executables: a failed check is reported
+// and counted, and the test returns non zero at the end.
+inline int &testFailures()
+{
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(condition)                                                                  \
+    do                                                                                    \
+    {                                                                                     \
+        if (!(condition))                                                                 \
+        {                                                                                 \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed\n"; \
+            ++testFailures();                                                             \
+        }                                                                                 \
+    } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance)                                                 \
+    do                                                                                          \
+    {                                                                                           \
+        const double check_actual = (actual);                                                   \
+        const double check_expected = (expected);                                               \
+        if (!(std::fabs(check_actual - check_expected) <= (tolerance)))                         \
+        {                                                                                       \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": " #actual " = " << check_actual       \
+                      << ", expected " << check_expected << " +/- " << (tolerance) << "\n";     \
+            ++testFailures();                                                                   \
+        }                                                                                       \
+    } while (0)
+
+#define CHECK_THROWS(statement)                                                             \
+    do                                                                                      \
+    {                                                                                       \
+        bool check_thrown = false;                                                          \
+        try                                                                                 \
+        {                                                                                   \
+            statement;                                                                      \
+        }                                                                                   \
+        catch (const std::exception &)                                                      \
+        {                                                                                   \
+            check_thrown = true;                                                            \
+        }                                                                                   \
+        if (!check_thrown)                                                                  \
+        {                                                                                   \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": " #statement " did not throw\n"; \
+            ++testFailures();                                                               \
+        }                                                                                   \
+    } while (0)
+
+#define RUN_TEST(test)                                                         \
+    do                                                                         \
+    {                                                                          \
+        try                                                                    \
+        {                                                                      \
+            test();                                                            \
+        }                                                                      \
+        catch (const std::exception &e)                                        \
+        {                                                                      \
+            std::cerr << #test ": unexpected exception: " << e.what() << "\n"; \
+            ++testFailures();                                                  \
+        }                                                                      \
+    } while (0)
+
+inline int testResult()
+{
+    if (testFailures() > 0)
+    {
+        std::cerr << testFailures() << " check(s) failed\n";
+        return 1;
+    }
+    return 0;
+}
+
+#endif // TEST_COMMON_H
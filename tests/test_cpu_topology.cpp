@@ -0,0 +1,57 @@
+// CPU list parsing, topology files and /sys detection.
+#include "system/cpu_topology.h"
+#include "test_common.h"
+#include <fstream>
+
+static void testParseCpuList()
+{
+    CHECK(parseCpuList("") == std::vector<int>());
+    CHECK(parseCpuList("3") == std::vector<int>({3}));
+    CHECK(parseCpuList("0-3,8, 10-11,2") == std::vector<int>({0, 1, 2, 3, 8, 10, 11}));
+    CHECK_THROWS(parseCpuList("4-2"));
+    CHECK_THROWS(parseCpuList("a"));
+
+    CHECK(formatCpuList({0, 1, 2, 3, 8, 10, 11}) == "0-3,8,10-11");
+    CHECK(formatCpuList({}) == "");
+}
+
+static void testLoadTopology()
+{
+    const std::string path = "test_topology.yml";
+    {
+        std::ofstream file(path);
+        file << "%YAML:1.0\n"
+             << "nodes:\n"
+             << "  - { id: 0, cpus: \"0-3,8-11\" }\n"
+             << "  - { id: 1, cpus: \"4-7,12-15\" }\n";
+    }
+
+    CpuTopology topology = CpuTopology::load(path);
+    CHECK(topology.nodes().size() == 2);
+    CHECK(topology.node(1).cpus == parseCpuList("4-7,12-15"));
+    CHECK_THROWS(topology.node(2));
+    CHECK_THROWS(CpuTopology::load("missing_topology.yml"));
+}
+
+static void testDetect()
+{
+    CpuTopology topology = CpuTopology::detect();
+    CHECK(!topology.empty());
+    for (const auto &node : topology.nodes())
+    {
+        CHECK(!node.cpus.empty());
+    }
+
+    // Pinning to the CPUs of the first node is always allowed
+    CHECK(pinCurrentThread(topology.nodes()[0].cpus));
+    CHECK(!pinCurrentThread({}));
+}
+
+int main()
+{
+    RUN_TEST(testParseCpuList);
+    RUN_TEST(testLoadTopology);
+    RUN_TEST(testDetect);
+
+    return testResult();
+}
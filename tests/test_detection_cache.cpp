@@ -0,0 +1,188 @@
+// Frame hashing, LRU and on-disk store of DetectionCache on synthetic
+// frames, no model involved.
+#include "ia/detection_cache.h"
+#include "test_common.h"
+#include <bitset>
+#include <cstdio>
+#include <fstream>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+namespace
+{
+    const cv::Size FRAME(640, 480);
+
+    // Blocks of random gray levels, so the hash has something to compare
+    cv::Mat pattern(uint64_t seed)
+    {
+        cv::RNG rng(seed);
+        cv::Mat image(FRAME, CV_8UC3, cv::Scalar::all(0));
+        const int columns = 12;
+        const int rows = 10;
+        for (int y = 0; y < rows; ++y)
+        {
+            for (int x = 0; x < columns; ++x)
+            {
+                const cv::Rect block(x * FRAME.width / columns, y * FRAME.height / rows, FRAME.width / columns, FRAME.height / rows);
+                image(block).setTo(cv::Scalar::all(rng.uniform(0, 256)));
+            }
+        }
+        return image;
+    }
+
+    int distance(uint64_t first, uint64_t second)
+    {
+        return static_cast<int>(std::bitset<64>(first ^ second).count());
+    }
+
+    std::vector<Detection> person()
+    {
+        return {{0.9f, cv::Rect(100, 100, 40, 80), 0, "person"}};
+    }
+}
+
+static void testFrameHash()
+{
+    const cv::Mat image = pattern(1);
+    const uint64_t hash = frameHash(image);
+    CHECK(frameHash(image.clone()) == hash);
+
+    // Flat frames have no gradient, only their brightness sets them apart
+    const uint64_t gray = frameHash(cv::Mat(FRAME, CV_8UC3, cv::Scalar::all(90)));
+    CHECK(gray != frameHash(cv::Mat(FRAME, CV_8UC3, cv::Scalar::all(0))));
+    CHECK(gray != frameHash(cv::Mat(FRAME, CV_8UC3, cv::Scalar::all(200))));
+    CHECK(gray == frameHash(cv::Mat(FRAME, CV_8UC3, cv::Scalar::all(92))));
+
+    // A resized re-upload lands close, another frame far
+    cv::Mat resized;
+    cv::resize(image, resized, cv::Size(320, 240), 0, 0, cv::INTER_AREA);
+    CHECK(distance(frameHash(resized), hash) <= 4);
+    CHECK(distance(frameHash(pattern(2)), hash) > 12);
+
+    // The decoder's luma hashes like the BGR frame
+    cv::Mat i420;
+    cv::cvtColor(image, i420, cv::COLOR_BGR2YUV_I420);
+    const int w = FRAME.width;
+    const int h = FRAME.height;
+    const uint8_t *data = i420.ptr<uint8_t>();
+    YuvFrame frame{PixelFormat::I420, w, h, {data, data + w * h, data + w * h + w * h / 4}, {w, w / 2, w / 2}};
+    CHECK(distance(frameHash(frame), hash) <= 4);
+
+    CHECK_THROWS(frameHash(cv::Mat()));
+}
+
+static void testLruAndScaling()
+{
+    DetectionCacheConfig config;
+    config.capacity = 2;
+    DetectionCache cache(config);
+    const uint64_t context = cacheContext("model.onnx", 0.3f);
+
+    std::vector<Detection> detections;
+    CHECK(!cache.lookup(1, context, FRAME, detections));
+
+    cache.insert(1, context, FRAME, person());
+    cache.insert(2, context, FRAME, {});
+    CHECK(cache.lookup(1, context, FRAME, detections));
+    CHECK(detections.size() == 1);
+
+    // 2 is now the least recently used
+    cache.insert(3, context, FRAME, {});
+    CHECK(cache.size() == 2);
+    CHECK(!cache.lookup(2, context, FRAME, detections));
+    CHECK(cache.lookup(3, context, FRAME, detections));
+    CHECK(detections.empty());
+
+    // Boxes follow the size of the frame looked up
+    CHECK(cache.lookup(1, context, cv::Size(320, 240), detections));
+    CHECK(detections.size() == 1);
+    if (detections.size() == 1)
+    {
+        CHECK(detections[0].bbox == cv::Rect(50, 50, 20, 40));
+        CHECK(detections[0].class_name == "person");
+    }
+
+    // Another model or threshold does not share results
+    CHECK(!cache.lookup(1, cacheContext("model.onnx", 0.5f), FRAME, detections));
+    CHECK(!cache.lookup(1, cacheContext("other.onnx", 0.3f), FRAME, detections));
+    CHECK(cacheContext("model.onnx", 0.3f) == context);
+
+    CHECK(cache.hits() == 3);
+    CHECK(cache.misses() == 4);
+
+    config.capacity = 0;
+    CHECK_THROWS(DetectionCache{config});
+}
+
+static void testNearDuplicates()
+{
+    const uint64_t context = cacheContext("model.onnx", 0.3f);
+    const uint64_t hash = 0x0123456789abcdefULL;
+    std::vector<Detection> detections;
+
+    DetectionCache exact;
+    exact.insert(hash, context, FRAME, person());
+    CHECK(!exact.lookup(hash ^ 1, context, FRAME, detections));
+
+    DetectionCacheConfig config;
+    config.max_distance = 2;
+    DetectionCache near(config);
+    near.insert(hash, context, FRAME, person());
+    CHECK(near.lookup(hash ^ 0x3, context, FRAME, detections));
+    CHECK(detections.size() == 1);
+    CHECK(!near.lookup(hash ^ 0x7, context, FRAME, detections));
+    CHECK(!near.lookup(hash ^ 0x3, context + 1, FRAME, detections));
+}
+
+static void testStore()
+{
+#if defined(__unix__) || defined(__APPLE__)
+    const std::string path = "yolov10_test_cache.bin";
+    std::remove(path.c_str());
+    const uint64_t context = cacheContext("model.onnx", 0.3f);
+
+    DetectionCacheConfig config;
+    config.store_path = path;
+    config.store_slots = 64;
+    {
+        DetectionCache cache(config);
+        cache.insert(42, context, FRAME, person());
+
+        // More than a slot holds stays in memory only
+        cache.insert(43, context, FRAME, std::vector<Detection>(40, person()[0]));
+    }
+
+    // A new process starts with an empty memory and finds the stored frame
+    DetectionCache reopened(config);
+    CHECK(reopened.size() == 0);
+    std::vector<Detection> detections;
+    CHECK(reopened.lookup(42, context, FRAME, detections));
+    CHECK(detections.size() == 1);
+    if (detections.size() == 1)
+    {
+        CHECK(detections[0].bbox == cv::Rect(100, 100, 40, 80));
+        CHECK(detections[0].class_id == 0);
+        CHECK(detections[0].class_name == "person");
+        CHECK_NEAR(detections[0].confidence, 0.9, 1e-6);
+    }
+    CHECK(!reopened.lookup(43, context, FRAME, detections));
+    CHECK(!reopened.lookup(42, context + 1, FRAME, detections));
+
+    {
+        std::ofstream garbage("yolov10_test_garbage.bin");
+        garbage << std::string(8192, 'x');
+    }
+    config.store_path = "yolov10_test_garbage.bin";
+    CHECK_THROWS(DetectionCache{config});
+#endif
+}
+
+int main()
+{
+    RUN_TEST(testFrameHash);
+    RUN_TEST(testLruAndScaling);
+    RUN_TEST(testNearDuplicates);
+    RUN_TEST(testStore);
+
+    return testResult();
+}
@@ -0,0 +1,557 @@
+// End to end checks of InferenceEngine and BatchScheduler on the synthetic
+// model from test_model.h, whose output is known for every input.
+#include "ia/batch_scheduler.h"
+#include "ia/cascade.h"
+#include "ia/detect_async.h"
+#include "ia/engine_replicas.h"
+#include "ia/inference.h"
+#include "ia/resolution_controller.h"
+#include "ia/roi.h"
+#include "test_common.h"
+#include "test_model.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <opencv2/opencv.hpp>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    const double TOLERANCE = 1e-4;
+
+    // ReduceMean accumulates 1.2M floats, which drifts by a few hundredths
+    const double SHIFT_TOLERANCE = 0.2;
+
+    std::string fixedModel()
+    {
+        static const std::string path = writeTestModel("yolov10_test_fixed.onnx", false);
+        return path;
+    }
+
+    std::string dynamicModel()
+    {
+        static const std::string path = writeTestModel("yolov10_test_dynamic.onnx", true);
+        return path;
+    }
+
+    std::string dynamicResolutionModel()
+    {
+        static const std::string path = writeTestModel("yolov10_test_dynamic_resolution.onnx", true, true);
+        return path;
+    }
+
+    // Fixed and not square, so a swapped width and height shows in the boxes
+    std::string wideModel()
+    {
+        static const std::string path = writeTestModel("yolov10_test_wide.onnx", false, false, 384, 640);
+        return path;
+    }
+
+    // Left edge of the first box for a uniform image of the given value
+    double shiftedLeft(int value)
+    {
+        return testModelBoxes()[0].left + 100.0 * value / 255.0;
+    }
+
+    // Single threaded loop the completions are posted to, as in an event driven service
+    class EventLoop
+    {
+    public:
+        void post(std::function<void()> task)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                tasks.push_back(std::move(task));
+            }
+            tasks_cv.notify_one();
+        }
+
+        void runUntil(const std::function<bool()> &finished)
+        {
+            while (!finished())
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                tasks_cv.wait(lock, [this]
+                              { return !tasks.empty(); });
+                std::function<void()> task = std::move(tasks.front());
+                tasks.pop_front();
+                lock.unlock();
+                task();
+            }
+        }
+
+        ResumeExecutor executor()
+        {
+            return [this](std::function<void()> resume)
+            { post(std::move(resume)); };
+        }
+
+    private:
+        std::mutex mutex;
+        std::condition_variable tasks_cv;
+        std::deque<std::function<void()>> tasks;
+    };
+
+#ifdef YOLOV10_HAS_COROUTINES
+    // Coroutine that starts at once and frees itself when it returns
+    struct DetachedTask
+    {
+        struct promise_type
+        {
+            DetachedTask get_return_object() { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); }
+        };
+    };
+
+    DetachedTask detectTwice(BatchScheduler &scheduler, cv::Mat frame, EventLoop &loop, std::thread::id loop_thread, int &found, int &finished)
+    {
+        for (int i = 0; i < 2; ++i)
+        {
+            std::vector<Detection> detections = co_await detectAsync(scheduler, frame, 0.5f, BatchScheduler::Clock::time_point::max(), loop.executor());
+            CHECK(std::this_thread::get_id() == loop_thread);
+            found += static_cast<int>(detections.size());
+        }
+        ++finished;
+    }
+#endif
+
+    void checkGoldenRows(const std::vector<float> &output, int value)
+    {
+        CHECK(output.size() == 300 * 6);
+        if (output.size() != 300 * 6)
+        {
+            return;
+        }
+
+        const std::vector<TestBox> &boxes = testModelBoxes();
+        const double shift = 100.0 * value / 255.0;
+        for (size_t i = 0; i < 300; ++i)
+        {
+            const float *row = &output[i * 6];
+            TestBox expected = i < boxes.size() ? boxes[i] : TestBox{0, 0, 0, 0, 0, 0};
+            const double tolerance = i == 0 ? SHIFT_TOLERANCE : TOLERANCE;
+            CHECK_NEAR(row[0], expected.left + (i == 0 ? shift : 0.0), tolerance);
+            CHECK_NEAR(row[1], expected.top, TOLERANCE);
+            CHECK_NEAR(row[2], expected.right + (i == 0 ? shift : 0.0), tolerance);
+            CHECK_NEAR(row[3], expected.bottom, TOLERANCE);
+            CHECK_NEAR(row[4], expected.confidence, TOLERANCE);
+            CHECK_NEAR(row[5], expected.class_id, TOLERANCE);
+        }
+    }
+}
+
+static void testModelShape()
+{
+    InferenceEngine fixed(fixedModel());
+    CHECK(!fixed.supportsBatching());
+    CHECK(fixed.inputSize() == cv::Size(640, 640));
+
+    InferenceEngine dynamic(dynamicModel());
+    CHECK(dynamic.supportsBatching());
+}
+
+static void testGoldenOutput()
+{
+    InferenceEngine engine(fixedModel());
+
+    for (int value : {0, 51, 255})
+    {
+        cv::Mat frame(720, 1280, CV_8UC3, cv::Scalar::all(value));
+        checkGoldenRows(engine.runInference(engine.preprocessImage(frame)), value);
+    }
+}
+
+static void testEndToEnd()
+{
+    InferenceEngine engine(fixedModel());
+    cv::Mat frame(720, 1280, CV_8UC3, cv::Scalar::all(0));
+
+    std::vector<float> output = engine.runInference(engine.preprocessImage(frame));
+    std::vector<Detection> detections = engine.filterDetections(output, 0.5f, 640, 640, frame.cols, frame.rows);
+
+    CHECK(detections.size() == 3);
+    if (detections.size() != 3)
+    {
+        return;
+    }
+    CHECK(detections[0].bbox == cv::Rect(200, 112, 200, 225));
+    CHECK(detections[0].class_name == "person");
+    CHECK(detections[1].bbox == cv::Rect(640, 180, 320, 360));
+    CHECK(detections[1].class_name == "car");
+    CHECK(detections[2].bbox == cv::Rect(0, 0, 1280, 720));
+    CHECK(detections[2].class_name == "bus");
+
+    CHECK(engine.filterDetections(output, 0.0f, 640, 640, frame.cols, frame.rows).size() == 300);
+    CHECK(engine.filterDetections(output, 0.25f, 640, 640, frame.cols, frame.rows).size() == 4);
+    CHECK(engine.filterDetections(output, 0.99f, 640, 640, frame.cols, frame.rows).empty());
+}
+
+static void testRegionPath()
+{
+    InferenceEngine engine(fixedModel());
+    cv::Mat frame(1080, 1920, CV_8UC3, cv::Scalar::all(0));
+
+    LetterboxTransform transform;
+    std::vector<float> output = engine.runInference(engine.preprocessRegion(frame, cv::Rect(960, 540, 640, 320), transform));
+    std::vector<Detection> detections = engine.filterDetections(output, 0.5f, transform);
+
+    // The letterbox padding is grey, so the first box moves with its mean
+    CHECK(detections.size() == 3);
+    for (const Detection &detection : detections)
+    {
+        CHECK((detection.bbox & transform.crop) == detection.bbox);
+    }
+}
+
+static void testBatchMatchesSingle()
+{
+    const std::vector<int> values = {0, 102, 255};
+
+    for (bool dynamic : {false, true})
+    {
+        InferenceEngine engine(dynamic ? dynamicModel() : fixedModel());
+
+        std::vector<float> batch;
+        for (int value : values)
+        {
+            cv::Mat frame(480, 640, CV_8UC3, cv::Scalar::all(value));
+            std::vector<float> tensor = engine.preprocessImage(frame);
+            batch.insert(batch.end(), tensor.begin(), tensor.end());
+        }
+
+        std::vector<std::vector<float>> outputs = engine.runInferenceBatch(batch, values.size());
+        CHECK(outputs.size() == values.size());
+        for (size_t i = 0; i < outputs.size() && i < values.size(); ++i)
+        {
+            checkGoldenRows(outputs[i], values[i]);
+        }
+
+        CHECK_THROWS(engine.runInferenceBatch(batch, values.size() + 1));
+        CHECK_THROWS(engine.runInferenceBatch(batch, 0));
+    }
+}
+
+static void testWarmup()
+{
+    InferenceEngine cold(fixedModel());
+    CHECK(cold.ready());
+    CHECK(cold.warmupDuration().count() == 0);
+
+    EngineConfig config;
+    config.warmup_iterations = 2;
+    config.warmup_batch_sizes = {1, 4};
+    InferenceEngine warm(dynamicModel(), config);
+    CHECK(warm.ready());
+
+    cv::Mat frame(480, 640, CV_8UC3, cv::Scalar::all(0));
+    checkGoldenRows(warm.runInference(warm.preprocessImage(frame)), 0);
+
+    // The test model has a fixed 640x640 input
+    config.warmup_resolutions = {cv::Size(320, 320)};
+    CHECK_THROWS(InferenceEngine(dynamicModel(), config));
+}
+
+static void testNonSquareInput()
+{
+    InferenceEngine engine(wideModel());
+    CHECK(engine.inputSize() == cv::Size(640, 384));
+
+    // Twice the network size on both axes, black so the first box does not move
+    BatchScheduler scheduler(engine);
+    std::vector<Detection> detections = scheduler.submit(cv::Mat(768, 1280, CV_8UC3, cv::Scalar::all(0)), 0.9f).get();
+    CHECK(detections.size() == 1);
+    if (detections.size() == 1)
+    {
+        CHECK(detections[0].bbox == cv::Rect(200, 200, 200, 400));
+    }
+
+    // The whole frame path of the command line
+    detections = detectRegions(engine, cv::Mat(768, 1280, CV_8UC3, cv::Scalar::all(0)), {}, 0.9f);
+    CHECK(detections.size() == 1);
+    if (detections.size() == 1)
+    {
+        CHECK(detections[0].bbox == cv::Rect(200, 200, 200, 400));
+    }
+}
+
+static void testBatchScheduler()
+{
+    InferenceEngine engine(dynamicModel());
+    BatchConfig config;
+    config.max_batch_size = 4;
+    BatchScheduler scheduler(engine, config);
+
+    const std::vector<int> values = {0, 64, 128, 192, 255};
+    std::vector<std::future<std::vector<Detection>>> results;
+    for (int value : values)
+    {
+        results.push_back(scheduler.submit(cv::Mat(360, 640, CV_8UC3, cv::Scalar::all(value)), 0.5f));
+    }
+
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        std::vector<Detection> detections = results[i].get();
+        CHECK(detections.size() == 3);
+        if (!detections.empty())
+        {
+            // 640x360 frames map x one to one
+            CHECK(std::abs(detections[0].bbox.x - static_cast<int>(shiftedLeft(values[i]))) <= 1);
+        }
+    }
+
+    scheduler.stop();
+    CHECK_THROWS(scheduler.submit(cv::Mat(360, 640, CV_8UC3, cv::Scalar::all(0)), 0.5f).get());
+}
+
+static bool shedByDeadline(std::future<std::vector<Detection>> result)
+{
+    try
+    {
+        result.get();
+    }
+    catch (const DeadlineExceeded &)
+    {
+        return true;
+    }
+    return false;
+}
+
+static void testDeadlines()
+{
+    InferenceEngine engine(dynamicModel());
+    InferenceEngine small_engine(fixedModel());
+    BatchScheduler scheduler(engine);
+    BatchScheduler fallback(small_engine);
+    cv::Mat frame(360, 640, CV_8UC3, cv::Scalar::all(0));
+
+    // Without a latency measurement nothing is shed
+    const auto past = BatchScheduler::Clock::now() - std::chrono::milliseconds(1);
+    CHECK(scheduler.submit(frame, 0.5f, past).get().size() == 3);
+    CHECK(scheduler.expectedBatchLatency().count() > 0);
+
+    CHECK(shedByDeadline(scheduler.submit(frame, 0.5f, past)));
+    CHECK(scheduler.submit(frame, 0.5f, BatchScheduler::Clock::now() + std::chrono::seconds(10)).get().size() == 3);
+    CHECK(scheduler.submit(frame, 0.5f).get().size() == 3);
+
+    // A request that cannot make it goes to the cheaper model instead
+    scheduler.setFallback(fallback);
+    CHECK(scheduler.submit(frame, 0.5f, past).get().size() == 3);
+    CHECK_THROWS(fallback.setFallback(scheduler));
+}
+
+static void testDetectAsync()
+{
+    InferenceEngine engine(dynamicModel());
+    BatchScheduler scheduler(engine);
+    cv::Mat frame(360, 640, CV_8UC3, cv::Scalar::all(0));
+    EventLoop loop;
+    const std::thread::id loop_thread = std::this_thread::get_id();
+
+    // One thread keeps many requests in flight and handles every completion
+    const int requests = 32;
+    int found = 0;
+    int finished = 0;
+    for (int i = 0; i < requests; ++i)
+    {
+        detectAsync(scheduler, frame, 0.5f, [&](std::vector<Detection> detections, std::exception_ptr error)
+                    {
+                        CHECK(!error);
+                        CHECK(std::this_thread::get_id() == loop_thread);
+                        found += static_cast<int>(detections.size());
+                        ++finished; },
+                    BatchScheduler::Clock::time_point::max(), loop.executor());
+    }
+    loop.runUntil([&]
+                  { return finished == requests; });
+    CHECK(found == 3 * requests);
+
+#ifdef YOLOV10_HAS_COROUTINES
+    found = 0;
+    finished = 0;
+    for (int i = 0; i < requests; ++i)
+    {
+        detectTwice(scheduler, frame, loop, loop_thread, found, finished);
+    }
+    loop.runUntil([&]
+                  { return finished == requests; });
+    CHECK(found == 2 * 3 * requests);
+#endif
+}
+
+static void testReplicas()
+{
+    // Two replicas placed on the same CPUs, as on a two socket host
+    std::vector<int> cpus = CpuTopology::detect().nodes()[0].cpus;
+    CpuTopology topology;
+    topology.addNode(0, cpus);
+    topology.addNode(1, cpus);
+
+    EngineConfig config;
+    config.intra_op_threads = 2;
+    EngineReplicas replicas(dynamicModel(), config, BatchConfig(), topology);
+    CHECK(replicas.size() == 2);
+    CHECK(replicas.ready());
+    CHECK(replicas.nextIndex() != replicas.nextIndex());
+
+    cv::Mat frame(360, 640, CV_8UC3, cv::Scalar::all(0));
+    for (int i = 0; i < 4; ++i)
+    {
+        CHECK(replicas.next().submit(frame, 0.5f).get().size() == 3);
+    }
+}
+
+static void testReload()
+{
+    EngineConfig config;
+    config.warmup_iterations = 1;
+    InferenceEngine engine(dynamicModel(), config);
+    CHECK(engine.generation() == 1);
+    CHECK(engine.modelPath() == dynamicModel());
+
+    // Requests keep running, and keep getting correct results, while models are swapped
+    std::atomic<bool> stopping{false};
+    std::atomic<int> runs{0};
+    std::thread client([&]
+                       {
+                           cv::Mat frame(640, 640, CV_8UC3, cv::Scalar::all(128));
+                           std::vector<float> input_tensor_values;
+                           std::vector<float> results;
+                           engine.preprocessImage(frame, input_tensor_values);
+                           while (!stopping)
+                           {
+                               engine.runInference(input_tensor_values, results);
+                               checkGoldenRows(results, 128);
+                               ++runs;
+                           } });
+
+    engine.reload(dynamicModel());
+    engine.reload(dynamicModel());
+    stopping = true;
+    client.join();
+    CHECK(runs > 0);
+    CHECK(engine.generation() == 3);
+    CHECK(engine.ready());
+
+    // A fixed batch model cannot replace a dynamic one, the running model stays
+    CHECK_THROWS(engine.reload(fixedModel()));
+    CHECK_THROWS(engine.reload("missing.onnx"));
+    CHECK(engine.generation() == 3);
+    CHECK(engine.modelPath() == dynamicModel());
+    checkGoldenRows(engine.runInference(engine.preprocessImage(cv::Mat(640, 640, CV_8UC3, cv::Scalar::all(0)))), 0);
+}
+
+static void testCascade()
+{
+    InferenceEngine small_engine(fixedModel());
+    InferenceEngine large_engine(dynamicModel());
+    cv::Mat frame(640, 640, CV_8UC3, cv::Scalar::all(0));
+
+    // Rows score .95, .8, .55, .3 and .1: nothing in [.96, .99), only the small model runs
+    CascadeConfig config;
+    config.uncertain_low = 0.96f;
+    config.uncertain_high = 0.99f;
+    config.audit_period = 0;
+    CascadeDetector confident(small_engine, large_engine, config);
+    CHECK(confident.detect(frame).size() == 3);
+    CHECK(confident.escalations() == 0);
+
+    // Every other frame is audited
+    config.audit_period = 2;
+    CascadeDetector audited(small_engine, large_engine, config);
+    for (int i = 0; i < 4; ++i)
+    {
+        CHECK(audited.detect(frame).size() == 3);
+    }
+    CHECK(audited.escalations() == 2);
+    CHECK_NEAR(audited.escalationRate(), 0.5, 1e-9);
+
+    // .55 and .3 are uncertain, the large model sees the same boxes and the duplicates merge
+    config.uncertain_low = 0.25f;
+    config.uncertain_high = 0.6f;
+    config.audit_period = 0;
+    config.escalation = Escalation::FullFrame;
+    CascadeDetector full(small_engine, large_engine, config);
+    CHECK(full.detect(frame).size() == 3);
+    CHECK(full.escalations() == 1);
+
+    // Only the .3 box at (50, 400, 100, 200) is uncertain: the large model sees it
+    // with its margin, (0, 300, 200, 340), and its boxes stay inside that crop
+    config.uncertain_high = 0.5f;
+    config.escalation = Escalation::Crop;
+    CascadeDetector cropped(small_engine, large_engine, config);
+    std::vector<Detection> detections = cropped.detect(frame);
+    CHECK(cropped.escalations() == 1);
+    CHECK(detections.size() == 6);
+    const cv::Rect crop(0, 300, 200, 340);
+    CHECK(std::any_of(detections.begin(), detections.end(), [&crop](const Detection &detection)
+                      { return detection.class_id == 5 && boxIou(detection.bbox, crop) > 0.95f; }));
+    CHECK(std::count_if(detections.begin(), detections.end(), [&crop](const Detection &detection)
+                        { return (detection.bbox & crop) == detection.bbox; }) == 3);
+}
+
+static void testDynamicResolution()
+{
+    InferenceEngine fixed(fixedModel());
+    CHECK(fixed.supportsInputSize(cv::Size(640, 640)));
+    CHECK(!fixed.supportsInputSize(cv::Size(320, 320)));
+
+    EngineConfig config;
+    config.warmup_iterations = 1;
+    config.warmup_resolutions = {cv::Size(320, 320), cv::Size(640, 640), cv::Size(960, 960)};
+    InferenceEngine engine(dynamicResolutionModel(), config);
+    CHECK(engine.ready());
+    CHECK(engine.supportsInputSize(cv::Size(320, 320)));
+    CHECK(engine.inputSize() == cv::Size(640, 640));
+
+    cv::Mat frame(640, 640, CV_8UC3, cv::Scalar::all(128));
+    std::vector<float> input_tensor_values;
+    std::vector<float> results;
+    for (int side : {320, 960})
+    {
+        engine.preprocessImage(frame, cv::Size(side, side), input_tensor_values);
+        CHECK(input_tensor_values.size() == static_cast<size_t>(3 * side * side));
+        engine.runInference(input_tensor_values, cv::Size(side, side), results);
+        checkGoldenRows(results, 128);
+    }
+    CHECK_THROWS(engine.runInference(input_tensor_values, cv::Size(320, 320), results));
+
+    // The model boxes are in 640 px input space, so at 320 they are decoded twice as large
+    ResolutionConfig resolution_config;
+    resolution_config.initial_resolution = 320;
+    ResolutionController controller(resolution_config);
+    std::vector<Detection> detections = controller.detect(engine, cv::Mat(640, 640, CV_8UC3, cv::Scalar::all(0)), 0.5f);
+    CHECK(detections.size() == 3);
+    if (!detections.empty())
+    {
+        CHECK(detections[0].bbox == cv::Rect(200, 200, 200, 400));
+    }
+}
+
+int main()
+{
+    RUN_TEST(testModelShape);
+    RUN_TEST(testGoldenOutput);
+    RUN_TEST(testEndToEnd);
+    RUN_TEST(testRegionPath);
+    RUN_TEST(testBatchMatchesSingle);
+    RUN_TEST(testWarmup);
+    RUN_TEST(testNonSquareInput);
+    RUN_TEST(testBatchScheduler);
+    RUN_TEST(testDeadlines);
+    RUN_TEST(testDetectAsync);
+    RUN_TEST(testReplicas);
+    RUN_TEST(testReload);
+    RUN_TEST(testCascade);
+    RUN_TEST(testDynamicResolution);
+
+    return testResult();
+}
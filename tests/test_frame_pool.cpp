@@ -0,0 +1,102 @@
+// Recycling, alignment and reference counting of the frame pool, and cv::Mat
+// buffers going through PooledMatAllocator.
+#include "memory/frame_pool.h"
+#include "test_common.h"
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+
+static void testRecyclesBySizeClass()
+{
+    FramePool pool;
+
+    void *first = pool.allocate(640 * 480 * 3);
+    CHECK(reinterpret_cast<uintptr_t>(first) % FramePool::ALIGNMENT == 0);
+    CHECK(FramePool::capacity(first) >= 640 * 480 * 3);
+    pool.release(first);
+    CHECK(pool.cachedBytes() == FramePool::capacity(first));
+
+    // Same class, same block
+    void *second = pool.allocate(640 * 480 * 3 - 100);
+    CHECK(second == first);
+    CHECK(pool.cachedBytes() == 0);
+
+    // Different class, new block
+    void *third = pool.allocate(1920 * 1080 * 3);
+    CHECK(third != second);
+
+    pool.release(second);
+    pool.release(third);
+    pool.trim();
+    CHECK(pool.cachedBytes() == 0);
+}
+
+static void testReferenceCount()
+{
+    FramePool pool;
+
+    void *block = pool.allocate(4096);
+    pool.retain(block);
+    pool.release(block);
+    CHECK(pool.cachedBytes() == 0);
+    pool.release(block);
+    CHECK(pool.cachedBytes() == 4096);
+}
+
+static void testCachedBytesCap()
+{
+    FramePool pool(8192);
+
+    void *first = pool.allocate(8192);
+    void *second = pool.allocate(8192);
+    pool.release(first);
+    pool.release(second);
+
+    // The second block does not fit under the cap and goes back to the heap
+    CHECK(pool.cachedBytes() == 8192);
+}
+
+static void testMatAllocator()
+{
+    FramePool pool;
+    PooledMatAllocator allocator(pool);
+
+    const uchar *data = nullptr;
+    {
+        cv::Mat image;
+        image.allocator = &allocator;
+        image.create(480, 640, CV_8UC3);
+        image.setTo(cv::Scalar(1, 2, 3));
+        data = image.data;
+        CHECK(reinterpret_cast<uintptr_t>(data) % FramePool::ALIGNMENT == 0);
+
+        // Shared headers keep the buffer alive
+        cv::Mat alias = image;
+        image.release();
+        CHECK(pool.cachedBytes() == 0);
+        CHECK(alias.at<cv::Vec3b>(10, 10) == cv::Vec3b(1, 2, 3));
+    }
+    CHECK(pool.cachedBytes() > 0);
+
+    cv::Mat next;
+    next.allocator = &allocator;
+    next.create(480, 640, CV_8UC3);
+    CHECK(next.data == data);
+
+    // Buffers owned by the caller are wrapped, never returned to the pool
+    uchar external[16 * 16 * 3];
+    {
+        cv::Mat wrapped(16, 16, CV_8UC3, external);
+        wrapped.setTo(cv::Scalar::all(0));
+    }
+    CHECK(pool.cachedBytes() == 0);
+}
+
+int main()
+{
+    RUN_TEST(testRecyclesBySizeClass);
+    RUN_TEST(testReferenceCount);
+    RUN_TEST(testCachedBytesCap);
+    RUN_TEST(testMatAllocator);
+
+    return testResult();
+}
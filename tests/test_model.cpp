@@ -0,0 +1,233 @@
+#include "test_model.h"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+    // Minimal protobuf writer, just enough to encode onnx.ModelProto
+    enum WireType
+    {
+        VARINT = 0,
+        LENGTH_DELIMITED = 2
+    };
+
+    void writeVarint(std::string &out, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    void writeKey(std::string &out, int field, WireType type)
+    {
+        writeVarint(out, (static_cast<uint64_t>(field) << 3) | type);
+    }
+
+    void writeInt(std::string &out, int field, int64_t value)
+    {
+        writeKey(out, field, VARINT);
+        writeVarint(out, static_cast<uint64_t>(value));
+    }
+
+    void writeBytes(std::string &out, int field, const std::string &bytes)
+    {
+        writeKey(out, field, LENGTH_DELIMITED);
+        writeVarint(out, bytes.size());
+        out += bytes;
+    }
+
+    const int TENSOR_FLOAT = 1;
+    const int TENSOR_INT64 = 7;
+    const int ATTRIBUTE_INT = 2;
+    const int ATTRIBUTE_INTS = 7;
+
+    template <typename T>
+    std::string tensor(const std::string &name, int data_type, const std::vector<int64_t> &dims, const std::vector<T> &values)
+    {
+        std::string out;
+        for (int64_t dim : dims)
+        {
+            writeInt(out, 1, dim);
+        }
+        writeInt(out, 2, data_type);
+        writeBytes(out, 8, name);
+
+        // raw_data is little endian, like every host these tests run on
+        std::string raw(values.size() * sizeof(T), '\0');
+        std::memcpy(&raw[0], values.data(), raw.size());
+        writeBytes(out, 9, raw);
+        return out;
+    }
+
+    // dim_params names the symbolic dimensions, empty names keep the fixed size
+    std::string valueInfo(const std::string &name, const std::vector<int64_t> &dims, const std::vector<std::string> &dim_params)
+    {
+        std::string shape;
+        for (size_t i = 0; i < dims.size(); ++i)
+        {
+            std::string dim;
+            if (i < dim_params.size() && !dim_params[i].empty())
+            {
+                writeBytes(dim, 2, dim_params[i]);
+            }
+            else
+            {
+                writeInt(dim, 1, dims[i]);
+            }
+            writeBytes(shape, 1, dim);
+        }
+
+        std::string tensor_type;
+        writeInt(tensor_type, 1, TENSOR_FLOAT);
+        writeBytes(tensor_type, 2, shape);
+
+        std::string type;
+        writeBytes(type, 1, tensor_type);
+
+        std::string out;
+        writeBytes(out, 1, name);
+        writeBytes(out, 2, type);
+        return out;
+    }
+
+    std::string node(const std::string &op_type, const std::vector<std::string> &inputs, const std::string &output, const std::string &attributes = std::string())
+    {
+        std::string out;
+        for (const std::string &input : inputs)
+        {
+            writeBytes(out, 1, input);
+        }
+        writeBytes(out, 2, output);
+        writeBytes(out, 3, output + "_node");
+        writeBytes(out, 4, op_type);
+        out += attributes;
+        return out;
+    }
+
+    std::string intAttribute(const std::string &name, int64_t value)
+    {
+        std::string attribute;
+        writeBytes(attribute, 1, name);
+        writeInt(attribute, 3, value);
+        writeInt(attribute, 20, ATTRIBUTE_INT);
+
+        std::string out;
+        writeBytes(out, 5, attribute);
+        return out;
+    }
+
+    std::string intsAttribute(const std::string &name, const std::vector<int64_t> &values)
+    {
+        std::string attribute;
+        writeBytes(attribute, 1, name);
+        for (int64_t value : values)
+        {
+            writeInt(attribute, 8, value);
+        }
+        writeInt(attribute, 20, ATTRIBUTE_INTS);
+
+        std::string out;
+        writeBytes(out, 5, attribute);
+        return out;
+    }
+}
+
+const std::vector<TestBox> &testModelBoxes()
+{
+    static const std::vector<TestBox> boxes = {
+        {100.0f, 100.0f, 200.0f, 300.0f, 0.95f, 0},
+        {320.0f, 160.0f, 480.0f, 480.0f, 0.80f, 2},
+        {0.0f, 0.0f, 640.0f, 640.0f, 0.55f, 5},
+        {50.0f, 400.0f, 150.0f, 600.0f, 0.30f, 16},
+        {600.0f, 600.0f, 630.0f, 630.0f, 0.10f, 79}};
+    return boxes;
+}
+
+/*
+ * Function to encode the test model
+ *
+ * output = ReduceMean(input) * shift + boxes, where shift only moves the left
+ * and right edges of the first box
+ *
+ * @param dynamic_batch: whether the batch dimension is symbolic
+ * @param dynamic_resolution: whether the input height and width are symbolic
+ * @param height: input height of the exported model
+ * @param width: input width of the exported model
+ *
+ * @return: serialized onnx.ModelProto
+ */
+std::string buildTestModel(bool dynamic_batch, bool dynamic_resolution, int height, int width)
+{
+    const int rows = 300;
+    std::vector<float> boxes(rows * 6, 0.0f);
+    const std::vector<TestBox> &known = testModelBoxes();
+    for (size_t i = 0; i < known.size(); ++i)
+    {
+        const TestBox &box = known[i];
+        float *row = &boxes[i * 6];
+        row[0] = box.left;
+        row[1] = box.top;
+        row[2] = box.right;
+        row[3] = box.bottom;
+        row[4] = box.confidence;
+        row[5] = static_cast<float>(box.class_id);
+    }
+
+    std::vector<float> shift(rows * 6, 0.0f);
+    shift[0] = 100.0f;
+    shift[2] = 100.0f;
+
+    std::string graph;
+    writeBytes(graph, 1, node("ReduceMean", {"images"}, "mean", intsAttribute("axes", {1, 2, 3}) + intAttribute("keepdims", 1)));
+    writeBytes(graph, 1, node("Reshape", {"mean", "mean_shape"}, "mean_rows"));
+    writeBytes(graph, 1, node("Mul", {"mean_rows", "shift"}, "offsets"));
+    writeBytes(graph, 1, node("Add", {"offsets", "boxes"}, "output0"));
+    writeBytes(graph, 2, "yolov10_test");
+    writeBytes(graph, 5, tensor<int64_t>("mean_shape", TENSOR_INT64, {3}, {-1, 1, 1}));
+    writeBytes(graph, 5, tensor<float>("shift", TENSOR_FLOAT, {1, rows, 6}, shift));
+    writeBytes(graph, 5, tensor<float>("boxes", TENSOR_FLOAT, {1, rows, 6}, boxes));
+    const std::string batch = dynamic_batch ? "batch" : "";
+    const std::string height_name = dynamic_resolution ? "height" : "";
+    const std::string width_name = dynamic_resolution ? "width" : "";
+    writeBytes(graph, 11, valueInfo("images", {1, 3, height, width}, {batch, "", height_name, width_name}));
+    writeBytes(graph, 12, valueInfo("output0", {1, rows, 6}, {batch}));
+
+    std::string opset;
+    writeBytes(opset, 1, "");
+    writeInt(opset, 2, 13);
+
+    std::string model;
+    writeInt(model, 1, 7);
+    writeBytes(model, 2, "yolov10_cpp tests");
+    writeBytes(model, 7, graph);
+    writeBytes(model, 8, opset);
+    return model;
+}
+
+/*
+ * Function to write the test model next to the test binary
+ *
+ * @param path: file to create
+ * @param dynamic_batch: whether the batch dimension is symbolic
+ * @param dynamic_resolution: whether the input height and width are symbolic
+ * @param height: input height of the exported model
+ * @param width: input width of the exported model
+ *
+ * @return: the path, for convenience
+ */
+std::string writeTestModel(const std::string &path, bool dynamic_batch, bool dynamic_resolution, int height, int width)
+{
+    const std::string model = buildTestModel(dynamic_batch, dynamic_resolution, height, width);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(model.data(), model.size());
+    if (!file)
+    {
+        throw std::runtime_error("Could not write " + path);
+    }
+    return path;
+}
@@ -0,0 +1,28 @@
+#ifndef TEST_MODEL_H
+#define TEST_MODEL_H
+
+#include <string>
+#include <vector>
+
+// One row of the model output, in network input coordinates
+struct TestBox
+{
+    float left;
+    float top;
+    float right;
+    float bottom;
+    float confidence;
+    int class_id;
+};
+
+// Tiny ONNX model with the YOLOv10 contract: [N, 3, 640, 640] in, [N, 300, 6]
+// out. Every image yields testModelBoxes() padded with empty rows, except that
+// the left and right edges of the first box move by 100 * mean(input), so a
+// batch can be told apart image by image. With a dynamic resolution the input
+// is [N, 3, H, W] and the boxes do not depend on the size; a fixed input may
+// also be exported at another height and width, with the same boxes.
+const std::vector<TestBox> &testModelBoxes();
+std::string buildTestModel(bool dynamic_batch, bool dynamic_resolution = false, int height = 640, int width = 640);
+std::string writeTestModel(const std::string &path, bool dynamic_batch, bool dynamic_resolution = false, int height = 640, int width = 640);
+
+#endif // TEST_MODEL_H
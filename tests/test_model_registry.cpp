@@ -0,0 +1,165 @@
+// Model selection, label maps and memory budget eviction of ModelRegistry,
+// on two copies of the synthetic model from test_model.h.
+#include "ia/model_registry.h"
+#include "test_common.h"
+#include "test_model.h"
+#include <chrono>
+#include <fstream>
+#include <opencv2/opencv.hpp>
+#include <thread>
+
+namespace
+{
+    std::string fixedModel()
+    {
+        static const std::string path = writeTestModel("yolov10_registry_fixed.onnx", false);
+        return path;
+    }
+
+    std::string dynamicModel()
+    {
+        static const std::string path = writeTestModel("yolov10_registry_dynamic.onnx", true);
+        return path;
+    }
+
+    ModelSpec spec(const std::string &name, const std::string &path)
+    {
+        ModelSpec model;
+        model.name = name;
+        model.path = path;
+        model.memory_bytes = 1000;
+        model.engine.warmup_iterations = 1;
+        return model;
+    }
+
+    std::vector<Detection> detect(ModelRegistry::LoadedModel &model)
+    {
+        return model.scheduler->submit(cv::Mat(360, 640, CV_8UC3, cv::Scalar::all(0)), 0.5f).get();
+    }
+}
+
+static void testSelectionAndLabels()
+{
+    {
+        std::ofstream labels("registry_labels.names");
+        labels << "forklift\npallet\nhelmet\n";
+    }
+
+    RegistryConfig config;
+    config.models.push_back(spec("fixed", fixedModel()));
+    config.models.push_back(spec("dynamic", dynamicModel()));
+    config.models.back().labels_path = "registry_labels.names";
+    ModelRegistry registry(config);
+
+    CHECK(registry.names() == std::vector<std::string>({"dynamic", "fixed"}));
+    CHECK(registry.loadedNames().empty());
+    CHECK_THROWS(registry.acquire("missing"));
+
+    auto fixed = registry.acquire("fixed");
+    auto dynamic = registry.acquire("dynamic");
+    CHECK(!fixed->engine->supportsBatching());
+    CHECK(dynamic->engine->supportsBatching());
+    CHECK(registry.acquire("fixed") == fixed);
+    CHECK(registry.loadedBytes() == 2000);
+
+    // Classes 0, 2 and 5 pass the threshold; ids past the label map keep their number
+    std::vector<Detection> coco = detect(*fixed);
+    std::vector<Detection> custom = detect(*dynamic);
+    CHECK(coco.size() == 3 && custom.size() == 3);
+    if (coco.size() == 3 && custom.size() == 3)
+    {
+        CHECK(coco[0].class_name == "person");
+        CHECK(custom[0].class_name == "forklift");
+        CHECK(custom[1].class_name == "helmet");
+        CHECK(custom[2].class_name == "5");
+    }
+}
+
+static void testMemoryBudget()
+{
+    RegistryConfig config;
+    config.memory_budget_bytes = 2500;
+    config.models.push_back(spec("live", fixedModel()));
+    config.models.back().pinned = true;
+    config.models.push_back(spec("a", dynamicModel()));
+    config.models.push_back(spec("b", dynamicModel()));
+    ModelRegistry registry(config);
+
+    registry.acquire("live");
+    registry.acquire("a");
+    CHECK(registry.loadedNames() == std::vector<std::string>({"a", "live"}));
+
+    // The pinned model stays, the idle one makes room
+    {
+        auto b = registry.acquire("b");
+        CHECK(detect(*b).size() == 3);
+        CHECK(registry.loadedNames() == std::vector<std::string>({"b", "live"}));
+        CHECK(registry.loadedBytes() == 2000);
+
+        // b is in use and live is pinned, nothing can be evicted for a
+        CHECK_THROWS(registry.acquire("a"));
+        CHECK(registry.loadedNames() == std::vector<std::string>({"b", "live"}));
+    }
+
+    auto a = registry.acquire("a");
+    CHECK(detect(*a).size() == 3);
+    CHECK(registry.loadedNames() == std::vector<std::string>({"a", "live"}));
+}
+
+static void testIdleTimeout()
+{
+    RegistryConfig config;
+    config.idle_timeout = std::chrono::seconds(1);
+    config.models.push_back(spec("live", fixedModel()));
+    config.models.back().pinned = true;
+    config.models.push_back(spec("rescan", dynamicModel()));
+    ModelRegistry registry(config);
+
+    registry.acquire("live");
+    auto held = registry.acquire("rescan");
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+
+    // Held models are never unloaded
+    registry.evictIdle();
+    CHECK(registry.loadedNames().size() == 2);
+
+    held.reset();
+    registry.evictIdle();
+    CHECK(registry.loadedNames() == std::vector<std::string>({"live"}));
+}
+
+static void testLoadConfig()
+{
+    {
+        std::ofstream file("registry.yaml");
+        file << "%YAML:1.0\n"
+             << "threads: 2\n"
+             << "memory_budget_mb: 64\n"
+             << "idle_timeout_s: 600\n"
+             << "models:\n"
+             << "  - { name: \"live\", path: \"" << fixedModel() << "\", pinned: 1 }\n"
+             << "  - { name: \"forensic\", path: \"" << dynamicModel() << "\", max_batch: 2, warmup: 0 }\n";
+    }
+
+    RegistryConfig config = RegistryConfig::load("registry.yaml");
+    CHECK(config.intra_op_threads == 2);
+    CHECK(config.memory_budget_bytes == 64u << 20);
+    CHECK(config.idle_timeout.count() == 600);
+    CHECK(config.models.size() == 2);
+    if (config.models.size() == 2)
+    {
+        CHECK(config.models[0].pinned);
+        CHECK(config.models[1].batch.max_batch_size == 2);
+        CHECK(config.models[1].engine.warmup_iterations == 0);
+    }
+}
+
+int main()
+{
+    RUN_TEST(testSelectionAndLabels);
+    RUN_TEST(testMemoryBudget);
+    RUN_TEST(testIdleTimeout);
+    RUN_TEST(testLoadConfig);
+
+    return testResult();
+}
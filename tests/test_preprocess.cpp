@@ -0,0 +1,331 @@
+// Numerics of the preprocessing and decoding kernels, checked against plain
+// per-pixel reference implementations. No model is needed.
+#include "ia/preprocess.h"
+#include "test_common.h"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace
+{
+    const cv::Size INPUT_SIZE(640, 640);
+    const double TOLERANCE = 1e-6;
+
+    cv::Mat testFrame(int width, int height)
+    {
+        cv::Mat frame(height, width, CV_8UC3);
+        cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(256));
+        return frame;
+    }
+
+    // Planar BGR in [0, 1], one pixel at a time
+    std::vector<float> referencePack(const cv::Mat &resized)
+    {
+        const size_t plane_size = static_cast<size_t>(resized.rows) * resized.cols;
+        std::vector<float> tensor(plane_size * 3);
+        for (int y = 0; y < resized.rows; ++y)
+        {
+            for (int x = 0; x < resized.cols; ++x)
+            {
+                const cv::Vec3b &pixel = resized.at<cv::Vec3b>(y, x);
+                for (int c = 0; c < 3; ++c)
+                {
+                    tensor[c * plane_size + static_cast<size_t>(y) * resized.cols + x] = pixel[c] / 255.0f;
+                }
+            }
+        }
+        return tensor;
+    }
+
+    void checkTensor(const std::vector<float> &actual, const std::vector<float> &expected)
+    {
+        CHECK(actual.size() == expected.size());
+        if (actual.size() != expected.size())
+        {
+            return;
+        }
+
+        size_t mismatches = 0;
+        for (size_t i = 0; i < actual.size(); ++i)
+        {
+            if (std::fabs(actual[i] - expected[i]) > TOLERANCE)
+            {
+                ++mismatches;
+            }
+        }
+        CHECK(mismatches == 0);
+    }
+
+    std::vector<std::string> classNames()
+    {
+        std::vector<std::string> names;
+        for (int i = 0; i < 80; ++i)
+        {
+            names.push_back("class " + std::to_string(i));
+        }
+        return names;
+    }
+
+    std::vector<float> outputRows(const std::vector<std::vector<float>> &rows)
+    {
+        std::vector<float> output(300 * 6, 0.0f);
+        for (size_t i = 0; i < rows.size(); ++i)
+        {
+            std::copy(rows[i].begin(), rows[i].end(), output.begin() + i * 6);
+        }
+        return output;
+    }
+}
+
+static void testStretchMatchesReference()
+{
+    for (cv::Size size : {cv::Size(640, 480), cv::Size(1280, 720), cv::Size(640, 640), cv::Size(333, 777)})
+    {
+        cv::Mat frame = testFrame(size.width, size.height);
+
+        cv::Mat resized;
+        cv::resize(frame, resized, INPUT_SIZE);
+
+        checkTensor(preprocessStretch(frame, INPUT_SIZE), referencePack(resized));
+    }
+}
+
+static void testReusedTensor()
+{
+    // Reusing a larger tensor from an earlier frame gives the same values
+    std::vector<float> tensor(4 * 640 * 640, -1.0f);
+    cv::Mat frame = testFrame(1280, 720);
+    preprocessStretch(frame, INPUT_SIZE, tensor);
+    checkTensor(tensor, preprocessStretch(frame, INPUT_SIZE));
+
+    LetterboxTransform transform;
+    preprocessLetterbox(frame, cv::Rect(100, 100, 300, 500), INPUT_SIZE, transform, tensor);
+    checkTensor(tensor, preprocessLetterbox(frame, cv::Rect(100, 100, 300, 500), INPUT_SIZE, transform));
+}
+
+static void testStretchChannelOrder()
+{
+    cv::Mat frame(480, 640, CV_8UC3, cv::Scalar(10, 128, 255));
+    std::vector<float> tensor = preprocessStretch(frame, INPUT_SIZE);
+
+    const size_t plane_size = 640 * 640;
+    CHECK(tensor.size() == plane_size * 3);
+    CHECK_NEAR(tensor[0], 10 / 255.0, TOLERANCE);
+    CHECK_NEAR(tensor[plane_size], 128 / 255.0, TOLERANCE);
+    CHECK_NEAR(tensor[2 * plane_size + plane_size - 1], 1.0, TOLERANCE);
+}
+
+static void testLetterboxMatchesReference()
+{
+    cv::Mat frame = testFrame(1280, 720);
+    LetterboxTransform transform;
+    std::vector<float> tensor = preprocessLetterbox(frame, cv::Rect(0, 0, 1280, 720), INPUT_SIZE, transform);
+
+    CHECK(transform.crop == cv::Rect(0, 0, 1280, 720));
+    CHECK_NEAR(transform.scale, 0.5, TOLERANCE);
+    CHECK(transform.pad_x == 0);
+    CHECK(transform.pad_y == 140);
+
+    cv::Mat expected(640, 640, CV_8UC3, cv::Scalar(114, 114, 114));
+    cv::Mat target = expected(cv::Rect(0, 140, 640, 360));
+    cv::resize(frame, target, cv::Size(640, 360));
+    checkTensor(tensor, referencePack(expected));
+
+    CHECK_NEAR(tensor[0], 114 / 255.0, TOLERANCE);
+}
+
+static void testLetterboxRegion()
+{
+    cv::Mat frame = testFrame(1920, 1080);
+    LetterboxTransform transform;
+
+    // Clipped to the frame, then taller than wide so the padding is horizontal
+    preprocessLetterbox(frame, cv::Rect(1800, 880, 400, 400), INPUT_SIZE, transform);
+    CHECK(transform.crop == cv::Rect(1800, 880, 120, 200));
+    CHECK_NEAR(transform.scale, 3.2, 1e-5);
+    CHECK(transform.pad_y == 0);
+    CHECK(transform.pad_x == (640 - 384) / 2);
+
+    CHECK_THROWS(preprocessLetterbox(frame, cv::Rect(2000, 0, 100, 100), INPUT_SIZE, transform));
+    CHECK_THROWS(preprocessLetterbox(cv::Mat(), cv::Rect(0, 0, 10, 10), INPUT_SIZE, transform));
+    CHECK_THROWS(preprocessStretch(cv::Mat(), INPUT_SIZE));
+}
+
+static void testDecodeThresholds()
+{
+    const std::vector<float> output = outputRows({{10, 10, 20, 20, 0.95f, 0},
+                                                  {10, 10, 20, 20, 0.50f, 1},
+                                                  {10, 10, 20, 20, 0.49f, 2}});
+    const std::vector<std::string> names = classNames();
+
+    CHECK(decodeDetections(output, 0.5f, 640, 640, 640, 640, names).size() == 2);
+    CHECK(decodeDetections(output, 0.96f, 640, 640, 640, 640, names).empty());
+    CHECK(decodeDetections(output, 0.95f, 640, 640, 640, 640, names).size() == 1);
+    CHECK(decodeDetections(output, 0.0f, 640, 640, 640, 640, names).size() == 300);
+}
+
+static void testDecodeStretchMapping()
+{
+    const std::vector<float> output = outputRows({{100, 200, 300, 400, 0.9f, 7},
+                                                  {0, 0, 1, 1, 0.9f, 200}});
+    std::vector<Detection> detections = decodeDetections(output, 0.5f, 640, 640, 1280, 720, classNames());
+
+    CHECK(detections.size() == 2);
+    CHECK(detections[0].bbox == cv::Rect(200, 225, 400, 225));
+    CHECK(detections[0].class_id == 7);
+    CHECK(detections[0].class_name == "class 7");
+    CHECK_NEAR(detections[0].confidence, 0.9, TOLERANCE);
+
+    // Class ids the model knows but the label map does not keep their number
+    CHECK(detections[1].class_name == "200");
+}
+
+static void testDecodeLetterboxMapping()
+{
+    LetterboxTransform transform{cv::Rect(100, 50, 1280, 720), 0.5f, 0, 140};
+    const std::vector<float> output = outputRows({{100, 240, 300, 340, 0.9f, 1},
+                                                  {-20, 100, 700, 600, 0.8f, 2}});
+    std::vector<Detection> detections = decodeDetections(output, 0.5f, transform, classNames());
+
+    CHECK(detections.size() == 2);
+    CHECK(detections[0].bbox == cv::Rect(300, 250, 400, 200));
+
+    // Boxes reaching into the padding are clamped to the crop
+    CHECK(detections[1].bbox == cv::Rect(100, 50, 1280, 720));
+}
+
+static void testRoundTrip()
+{
+    // A box drawn on the frame must come back where it was after letterboxing
+    cv::Mat frame = testFrame(1920, 1080);
+    cv::Rect region(400, 300, 800, 600);
+    LetterboxTransform transform;
+    preprocessLetterbox(frame, region, INPUT_SIZE, transform);
+
+    const cv::Rect box(600, 450, 200, 100);
+    const float left = (box.x - transform.crop.x) * transform.scale + transform.pad_x;
+    const float top = (box.y - transform.crop.y) * transform.scale + transform.pad_y;
+    const float right = (box.x + box.width - transform.crop.x) * transform.scale + transform.pad_x;
+    const float bottom = (box.y + box.height - transform.crop.y) * transform.scale + transform.pad_y;
+
+    std::vector<Detection> detections = decodeDetections(outputRows({{left, top, right, bottom, 0.9f, 0}}), 0.5f, transform, classNames());
+    CHECK(detections.size() == 1);
+    CHECK(std::abs(detections[0].bbox.x - box.x) <= 1);
+    CHECK(std::abs(detections[0].bbox.y - box.y) <= 1);
+    CHECK(std::abs(detections[0].bbox.width - box.width) <= 1);
+    CHECK(std::abs(detections[0].bbox.height - box.height) <= 1);
+}
+
+static void testYuvMatchesConversion()
+{
+    // Smooth content, so chroma subsampling does not push colors out of gamut
+    for (cv::Size size : {cv::Size(640, 480), cv::Size(1920, 1080), cv::Size(334, 778)})
+    {
+        cv::Mat frame = testFrame(size.width, size.height);
+        cv::GaussianBlur(frame, frame, cv::Size(0, 0), 4.0);
+
+        cv::Mat i420;
+        cv::cvtColor(frame, i420, cv::COLOR_BGR2YUV_I420);
+        const int width = size.width;
+        const int height = size.height;
+        const uint8_t *y_plane = i420.ptr<uint8_t>();
+        const uint8_t *u_plane = y_plane + width * height;
+        const uint8_t *v_plane = u_plane + width * height / 4;
+
+        std::vector<uint8_t> nv12(y_plane, u_plane);
+        std::vector<uint8_t> yuyv(static_cast<size_t>(width) * height * 2);
+        for (int i = 0; i < width * height / 4; ++i)
+        {
+            nv12.push_back(u_plane[i]);
+            nv12.push_back(v_plane[i]);
+        }
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; x += 2)
+            {
+                uint8_t *pair = &yuyv[(static_cast<size_t>(y) * width + x) * 2];
+                const int chroma = (y / 2) * (width / 2) + x / 2;
+                pair[0] = y_plane[y * width + x];
+                pair[1] = u_plane[chroma];
+                pair[2] = y_plane[y * width + x + 1];
+                pair[3] = v_plane[chroma];
+            }
+        }
+
+        // Full resolution conversion then the BGR path
+        cv::Mat bgr;
+        cv::Mat resized;
+        cv::cvtColor(i420, bgr, cv::COLOR_YUV2BGR_I420);
+        cv::resize(bgr, resized, INPUT_SIZE);
+        const std::vector<float> expected = referencePack(resized);
+
+        const YuvFrame frames[] = {
+            {PixelFormat::I420, width, height, {y_plane, u_plane, v_plane}, {width, width / 2, width / 2}},
+            {PixelFormat::NV12, width, height, {nv12.data(), nv12.data() + width * height, nullptr}, {width, width, 0}},
+            {PixelFormat::YUYV, width, height, {yuyv.data(), nullptr, nullptr}, {width * 2, 0, 0}}};
+        for (const YuvFrame &yuv : frames)
+        {
+            std::vector<float> tensor;
+            preprocessYuv(yuv, INPUT_SIZE, tensor);
+            CHECK(tensor.size() == expected.size());
+            if (tensor.size() != expected.size())
+            {
+                continue;
+            }
+
+            // Only the rounding of the two 8-bit intermediates differs
+            double worst = 0.0;
+            for (size_t i = 0; i < tensor.size(); ++i)
+            {
+                worst = std::max(worst, static_cast<double>(std::fabs(tensor[i] - expected[i])));
+            }
+            CHECK(worst <= 1.5 / 255.0);
+        }
+    }
+}
+
+static void testYuvChecks()
+{
+    std::vector<uint8_t> pixels(64 * 64 * 2, 128);
+    std::vector<float> tensor;
+
+    CHECK_THROWS(preprocessYuv({PixelFormat::NV12, 63, 64, {pixels.data(), pixels.data(), nullptr}, {64, 64, 0}}, INPUT_SIZE, tensor));
+    CHECK_THROWS(preprocessYuv({PixelFormat::NV12, 64, 64, {pixels.data(), nullptr, nullptr}, {64, 64, 0}}, INPUT_SIZE, tensor));
+    CHECK_THROWS(preprocessYuv({PixelFormat::I420, 64, 64, {pixels.data(), pixels.data(), pixels.data()}, {64, 16, 32}}, INPUT_SIZE, tensor));
+    CHECK_THROWS(preprocessYuv({PixelFormat::YUYV, 64, 64, {pixels.data(), nullptr, nullptr}, {64, 0, 0}}, INPUT_SIZE, tensor));
+
+    // Mid gray in, mid gray out on every channel
+    preprocessYuv({PixelFormat::YUYV, 64, 64, {pixels.data(), nullptr, nullptr}, {128, 0, 0}}, INPUT_SIZE, tensor);
+    CHECK(tensor.size() == 3 * 640 * 640);
+    CHECK_NEAR(tensor[0], 1.164 * (128 - 16) / 255.0, 1e-3);
+    CHECK_NEAR(tensor.back(), 1.164 * (128 - 16) / 255.0, 1e-3);
+}
+
+static void testBoxIou()
+{
+    CHECK_NEAR(boxIou(cv::Rect(0, 0, 10, 10), cv::Rect(0, 0, 10, 10)), 1.0, 1e-6);
+    CHECK_NEAR(boxIou(cv::Rect(0, 0, 10, 10), cv::Rect(5, 0, 10, 10)), 50.0 / 150.0, 1e-6);
+    CHECK_NEAR(boxIou(cv::Rect(0, 0, 10, 10), cv::Rect(20, 20, 10, 10)), 0.0, 1e-6);
+    CHECK_NEAR(boxIou(cv::Rect(), cv::Rect()), 0.0, 1e-6);
+}
+
+int main()
+{
+    RUN_TEST(testStretchMatchesReference);
+    RUN_TEST(testReusedTensor);
+    RUN_TEST(testStretchChannelOrder);
+    RUN_TEST(testLetterboxMatchesReference);
+    RUN_TEST(testLetterboxRegion);
+    RUN_TEST(testDecodeThresholds);
+    RUN_TEST(testDecodeStretchMapping);
+    RUN_TEST(testDecodeLetterboxMapping);
+    RUN_TEST(testRoundTrip);
+    RUN_TEST(testYuvMatchesConversion);
+    RUN_TEST(testYuvChecks);
+    RUN_TEST(testBoxIou);
+
+    return testResult();
+}
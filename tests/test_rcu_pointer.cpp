@@ -0,0 +1,102 @@
+// Readers of RcuPointer never see an object after the writer got it back,
+// and exchange() waits for the readers that pinned the old object.
+#include "memory/rcu_pointer.h"
+#include "test_common.h"
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    struct Versioned
+    {
+        explicit Versioned(int version) : version(version), alive(true) {}
+
+        int version;
+        std::atomic<bool> alive;
+    };
+}
+
+static void testReadAndExchange()
+{
+    RcuPointer<Versioned> pointer(std::make_unique<Versioned>(1));
+    CHECK(pointer.read()->version == 1);
+
+    std::unique_ptr<Versioned> previous = pointer.exchange(std::make_unique<Versioned>(2));
+    CHECK(previous->version == 1);
+    CHECK(pointer.read()->version == 2);
+}
+
+static void testExchangeWaitsForReaders()
+{
+    RcuPointer<Versioned> pointer(std::make_unique<Versioned>(1));
+
+    std::future<std::unique_ptr<Versioned>> swap;
+    {
+        auto guard = pointer.read();
+        swap = std::async(std::launch::async, [&pointer]
+                          { return pointer.exchange(std::make_unique<Versioned>(2)); });
+
+        // The new object is visible to new readers while the old one is pinned
+        CHECK(swap.wait_for(std::chrono::milliseconds(50)) == std::future_status::timeout);
+        CHECK(guard->version == 1);
+        CHECK(pointer.read()->version == 2);
+    }
+
+    CHECK(swap.get()->version == 1);
+}
+
+static void testConcurrentReaders()
+{
+    RcuPointer<Versioned> pointer(std::make_unique<Versioned>(0));
+    std::atomic<bool> stopping{false};
+    std::atomic<int> stale{0};
+    std::atomic<int> backwards{0};
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i)
+    {
+        readers.emplace_back([&]
+                             {
+                                 int last = 0;
+                                 while (!stopping)
+                                 {
+                                     auto guard = pointer.read();
+                                     if (!guard->alive)
+                                     {
+                                         ++stale;
+                                     }
+                                     if (guard->version < last)
+                                     {
+                                         ++backwards;
+                                     }
+                                     last = guard->version;
+                                 } });
+    }
+
+    for (int version = 1; version <= 200; ++version)
+    {
+        std::unique_ptr<Versioned> previous = pointer.exchange(std::make_unique<Versioned>(version));
+        previous->alive = false;
+    }
+    stopping = true;
+    for (auto &reader : readers)
+    {
+        reader.join();
+    }
+
+    CHECK(stale == 0);
+    CHECK(backwards == 0);
+    CHECK(pointer.read()->version == 200);
+}
+
+int main()
+{
+    RUN_TEST(testReadAndExchange);
+    RUN_TEST(testExchangeWaitsForReaders);
+    RUN_TEST(testConcurrentReaders);
+
+    return testResult();
+}
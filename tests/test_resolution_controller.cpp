@@ -0,0 +1,106 @@
+// Decisions of ResolutionController from synthetic latencies and detections,
+// no model involved.
+#include "ia/resolution_controller.h"
+#include "test_common.h"
+#include <chrono>
+#include <vector>
+
+namespace
+{
+    const cv::Size FRAME(1280, 720);
+
+    ResolutionConfig testConfig()
+    {
+        ResolutionConfig config;
+        config.latency_slo = std::chrono::microseconds(30000);
+        config.decision_interval = 10;
+        return config;
+    }
+
+    // One decision window of identical frames
+    void feed(ResolutionController &controller, int latency_us, const std::vector<Detection> &detections)
+    {
+        for (int i = 0; i < 10; ++i)
+        {
+            controller.update(std::chrono::microseconds(latency_us), detections, FRAME);
+        }
+    }
+
+    std::vector<Detection> box(int width, int height)
+    {
+        return {{0.9f, cv::Rect(100, 100, width, height), 0, "person"}};
+    }
+}
+
+static void testStartsAtInitialResolution()
+{
+    ResolutionConfig config = testConfig();
+    CHECK(ResolutionController(config).resolution() == 640);
+    CHECK(ResolutionController(config).inputSize() == cv::Size(640, 640));
+
+    config.initial_resolution = 500;
+    CHECK(ResolutionController(config).resolution() == 480);
+
+    config.resolutions = {640, 320};
+    CHECK_THROWS(ResolutionController{config});
+}
+
+static void testSmallObjectsGoUp()
+{
+    ResolutionController controller(testConfig());
+
+    // 10 px in a 1280 px frame is 5 px at 640, far below 24
+    feed(controller, 5000, box(10, 10));
+    CHECK(controller.resolution() == 960);
+
+    // Nothing above 960
+    feed(controller, 5000, box(10, 10));
+    CHECK(controller.resolution() == 960);
+}
+
+static void testHeadroomBlocksStepUp()
+{
+    ResolutionController controller(testConfig());
+
+    // 960 is expected at 20 ms * 2.25, above 80% of the SLO
+    feed(controller, 20000, box(10, 10));
+    CHECK(controller.resolution() == 640);
+}
+
+static void testOverloadGoesDown()
+{
+    ResolutionController controller(testConfig());
+
+    feed(controller, 45000, box(10, 10));
+    CHECK(controller.resolution() == 480);
+
+    // The measured latency at 640 now blocks going back up
+    feed(controller, 10000, box(10, 10));
+    CHECK(controller.resolution() == 480);
+}
+
+static void testLargeObjectsGoDown()
+{
+    ResolutionController controller(testConfig());
+
+    // 360 of 720 px is half the frame: 160 px at 320, still twice the minimum
+    feed(controller, 10000, box(600, 360));
+    CHECK(controller.resolution() == 480);
+    feed(controller, 10000, box(600, 360));
+    CHECK(controller.resolution() == 320);
+
+    // Empty frames give no reason to move
+    feed(controller, 10000, {});
+    CHECK(controller.resolution() == 320);
+}
+
+int main()
+{
+    RUN_TEST(testStartsAtInitialResolution);
+    RUN_TEST(testSmallObjectsGoUp);
+    RUN_TEST(testHeadroomBlocksStepUp);
+    RUN_TEST(testOverloadGoesDown);
+    RUN_TEST(testLargeObjectsGoDown);
+
+    return testResult();
+}
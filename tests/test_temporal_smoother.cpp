@@ -0,0 +1,133 @@
+// Interpolation and extrapolation of TemporalSmoother on synthetic tracks,
+// no model involved.
+#include "ia/temporal_smoother.h"
+#include "test_common.h"
+#include <vector>
+
+namespace
+{
+    Detection box(int x, int y, int width = 40, int height = 80, int class_id = 0)
+    {
+        return {0.8f, cv::Rect(x, y, width, height), class_id, "person"};
+    }
+}
+
+static void testExtrapolatesVelocity()
+{
+    TemporalSmoother smoother;
+    CHECK(smoother.predict(0.0).empty());
+
+    // 10 pixels right and 5 down every 100 ms, growing by 2 pixels
+    smoother.update({box(100, 100, 40, 80)}, 0.0);
+    smoother.update({box(110, 105, 42, 82)}, 100.0);
+    CHECK(smoother.tracks() == 1);
+
+    std::vector<Detection> predicted = smoother.predict(150.0);
+    CHECK(predicted.size() == 1);
+    if (predicted.size() == 1)
+    {
+        CHECK(predicted[0].bbox.x == 115);
+        CHECK_NEAR(predicted[0].bbox.y, 107.5, 0.5);
+        CHECK(predicted[0].bbox.width == 43);
+        CHECK(predicted[0].bbox.height == 83);
+        CHECK(predicted[0].class_id == 0);
+        CHECK(predicted[0].class_name == "person");
+    }
+
+    // The box stops moving past the extrapolation limit
+    std::vector<Detection> far = smoother.predict(100.0 + 10000.0);
+    CHECK(far.size() == 1);
+    if (far.size() == 1)
+    {
+        CHECK(far[0].bbox.x == 160);
+    }
+}
+
+static void testInterpolatesBetweenInferences()
+{
+    TemporalSmoother smoother;
+    smoother.update({box(100, 100)}, 0.0);
+    smoother.update({box(120, 100), box(500, 300, 40, 80, 2)}, 200.0);
+
+    // Half way: the known object is between its two boxes, the new one is not shown yet
+    std::vector<Detection> middle = smoother.predict(100.0);
+    CHECK(middle.size() == 1);
+    if (middle.size() == 1)
+    {
+        CHECK(middle[0].bbox.x == 110);
+        CHECK(middle[0].bbox.y == 100);
+    }
+
+    // Past the last inference both are there
+    CHECK(smoother.predict(210.0).size() == 2);
+}
+
+static void testMatchingFollowsMotion()
+{
+    TemporalSmoother smoother;
+
+    // Speeds up to 30 pixels per inference, where a 40 pixel wide box only
+    // overlaps its last position by an IoU of 0.14
+    smoother.update({box(100, 100)}, 0.0);
+    smoother.update({box(120, 100)}, 100.0);
+    smoother.update({box(150, 100)}, 200.0);
+    smoother.update({box(180, 100)}, 300.0);
+    CHECK(smoother.tracks() == 1);
+
+    // Another class at the same place starts a track of its own
+    smoother.update({box(210, 100), box(210, 100, 40, 80, 1)}, 400.0);
+    CHECK(smoother.tracks() == 2);
+}
+
+static void testMissedTracksCoast()
+{
+    SmootherConfig config;
+    config.max_missed = 1;
+    TemporalSmoother smoother(config);
+
+    smoother.update({box(100, 100)}, 0.0);
+    smoother.update({box(110, 100)}, 100.0);
+
+    // One missed inference keeps the box moving
+    smoother.update({}, 200.0);
+    std::vector<Detection> coasting = smoother.predict(200.0);
+    CHECK(coasting.size() == 1);
+    if (coasting.size() == 1)
+    {
+        CHECK(coasting[0].bbox.x == 120);
+    }
+
+    // It comes back where expected and keeps its track
+    smoother.update({box(130, 100)}, 300.0);
+    CHECK(smoother.tracks() == 1);
+
+    // Two in a row drop it
+    smoother.update({}, 400.0);
+    smoother.update({}, 500.0);
+    CHECK(smoother.tracks() == 0);
+    CHECK(smoother.predict(550.0).empty());
+}
+
+static void testTimestampsMustIncrease()
+{
+    TemporalSmoother smoother;
+    smoother.update({box(100, 100)}, 100.0);
+    CHECK_THROWS(smoother.update({box(100, 100)}, 100.0));
+    CHECK_THROWS(smoother.update({box(100, 100)}, 50.0));
+
+    smoother.reset();
+    CHECK(smoother.tracks() == 0);
+    smoother.update({box(100, 100)}, 0.0);
+    CHECK(smoother.tracks() == 1);
+}
+
+int main()
+{
+    RUN_TEST(testExtrapolatesVelocity);
+    RUN_TEST(testInterpolatesBetweenInferences);
+    RUN_TEST(testMatchingFollowsMotion);
+    RUN_TEST(testMissedTracksCoast);
+    RUN_TEST(testTimestampsMustIncrease);
+
+    return testResult();
+}
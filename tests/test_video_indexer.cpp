@@ -0,0 +1,162 @@
+// Checks of the offline video indexer on a short MJPEG clip written at test
+// time, whose brightness changes every second so samples can be told apart.
+#include "io/video_indexer.h"
+#include "test_common.h"
+#include "test_model.h"
+#include <cmath>
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+namespace
+{
+    const double FPS = 10.0;
+    const int SECONDS = 4;
+    const int WIDTH = 320;
+    const int HEIGHT = 240;
+
+    std::string dynamicModel()
+    {
+        static const std::string path = writeTestModel("yolov10_test_indexer.onnx", true);
+        return path;
+    }
+
+    int brightness(int second)
+    {
+        return 40 + 60 * second;
+    }
+
+    // Empty when this OpenCV build cannot write MJPEG
+    std::string testClip()
+    {
+        static const std::string path = []()
+        {
+            const std::string clip = "yolov10_test_clip.avi";
+            cv::VideoWriter writer(clip, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), FPS, cv::Size(WIDTH, HEIGHT));
+            if (!writer.isOpened())
+            {
+                return std::string();
+            }
+            for (int i = 0; i < SECONDS * FPS; ++i)
+            {
+                writer.write(cv::Mat(HEIGHT, WIDTH, CV_8UC3, cv::Scalar::all(brightness(static_cast<int>(i / FPS)))));
+            }
+            return clip;
+        }();
+        return path;
+    }
+
+    class MemorySink : public DetectionSink
+    {
+    public:
+        void write(const DetectionRecord &record) override
+        {
+            records.push_back(record);
+        }
+
+        void flush() override
+        {
+        }
+
+        std::vector<DetectionRecord> records;
+    };
+}
+
+static void testInterval()
+{
+    if (testClip().empty())
+    {
+        std::cerr << "testInterval: no MJPEG writer, skipped\n";
+        return;
+    }
+
+    InferenceEngine engine(dynamicModel());
+    VideoIndexConfig config;
+    config.mode = SamplingMode::Interval;
+    config.interval_seconds = 1.0;
+    config.batch_size = 3;
+
+    MemorySink sink;
+    VideoIndexStats stats = indexVideo(engine, testClip(), "clip", sink, config);
+    CHECK(stats.sampled_frames == SECONDS);
+    CHECK(sink.records.size() == static_cast<size_t>(SECONDS));
+    CHECK_NEAR(stats.video_ms, SECONDS * 1000.0, 1000.0 / FPS);
+
+    for (size_t i = 0; i < sink.records.size(); ++i)
+    {
+        const DetectionRecord &record = sink.records[i];
+        CHECK(record.source == "clip");
+        CHECK(record.width == WIDTH && record.height == HEIGHT);
+        CHECK_NEAR(record.timestamp_ms, i * 1000.0, 500.0 / FPS);
+        CHECK(record.frame_index == std::llround(record.timestamp_ms * FPS / 1000.0));
+
+        // The batch of three and the last single frame keep their order
+        cv::Mat frame(HEIGHT, WIDTH, CV_8UC3, cv::Scalar::all(brightness(static_cast<int>(i))));
+        std::vector<Detection> expected = engine.filterDetections(engine.runInference(engine.preprocessImage(frame)), config.confidence_threshold,
+                                                                  engine.inputSize().width, engine.inputSize().height, WIDTH, HEIGHT);
+        CHECK(!expected.empty());
+        CHECK(record.detections.size() == expected.size());
+        if (!record.detections.empty() && !expected.empty())
+        {
+            CHECK_NEAR(record.detections[0].bbox.x, expected[0].bbox.x, 2.0);
+        }
+    }
+}
+
+static void testKeyframes()
+{
+    if (testClip().empty())
+    {
+        std::cerr << "testKeyframes: no MJPEG writer, skipped\n";
+        return;
+    }
+
+    InferenceEngine engine(dynamicModel());
+    VideoIndexConfig config;
+    config.mode = SamplingMode::Keyframes;
+    config.interval_seconds = 1.0;
+
+    MemorySink sink;
+#ifdef YOLOV10_WITH_FFMPEG
+    indexVideo(engine, testClip(), "clip", sink, config);
+
+    // Every MJPEG frame is a keyframe
+    CHECK(sink.records.size() == static_cast<size_t>(SECONDS * FPS));
+    for (size_t i = 1; i < sink.records.size(); ++i)
+    {
+        CHECK(sink.records[i].timestamp_ms > sink.records[i - 1].timestamp_ms);
+    }
+#else
+    // OpenCV cannot see keyframes; interval sampling is the default instead
+    CHECK_THROWS(indexVideo(engine, testClip(), "clip", sink, config));
+    CHECK(sink.records.empty());
+    CHECK(VideoIndexConfig().mode == SamplingMode::Interval);
+#endif
+}
+
+static void testErrors()
+{
+    InferenceEngine engine(dynamicModel());
+    MemorySink sink;
+
+    VideoIndexConfig config;
+    config.batch_size = 0;
+    CHECK_THROWS(indexVideo(engine, testClip(), "clip", sink, config));
+
+    config = VideoIndexConfig();
+    config.mode = SamplingMode::Interval;
+    config.interval_seconds = 0.0;
+    CHECK_THROWS(indexVideo(engine, testClip(), "clip", sink, config));
+
+    CHECK_THROWS(indexVideo(engine, "missing_clip.avi", "clip", sink));
+    CHECK(sink.records.empty());
+}
+
+int main()
+{
+    RUN_TEST(testInterval);
+    RUN_TEST(testKeyframes);
+    RUN_TEST(testErrors);
+
+    return testResult();
+}